@@ -0,0 +1,304 @@
+/*
+ *
+ * alloc.c
+ *
+ * Created at:  Mon Oct 19 03:16:46 2026 03:16:46
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+/*
+ * The pools of the small allocations (see alloc.h).
+ *
+ * There is a class for every 16 bytes, up to POOL_MAX. The cells of a class
+ * are cut off from pages of the class's own, and the pages from one region of
+ * the address space which is reserved up front (the system gives it the
+ * memory once it's touched), so telling whether a pointer is the pools' is a
+ * matter of comparing it with the region's bounds, and the page's number
+ * tells its class.
+ *
+ * Every thread keeps a cache of the free cells of every class, and only goes
+ * for the lock when it runs out of them (taking a batch of them then), or has
+ * too many (giving a batch back). The cells never go back to the system.
+ */
+
+/* for `MAP_ANONYMOUS` and `madvise` */
+#define _DEFAULT_SOURCE
+
+#include "config.h"
+
+#if POOL_ALLOC
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "alloc.h"
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+#define POOL_QUANTUM 16
+#define POOL_CLASSES (POOL_MAX / POOL_QUANTUM)
+#define POOL_PAGE_SIZE (64 << 10)
+/* the most the pools can take (it's only the address space until used) */
+#define POOL_REGION_SIZE (sizeof(void *) >= 8 ? (size_t)1 << 30 : (size_t)64 << 20)
+/* how many cells a thread takes from (or gives back to) the pools at a time,
+ * and how many of a class it can keep */
+#define POOL_BATCH 32
+#define POOL_CACHE_MAX (POOL_BATCH * 4)
+
+enum pool_state {
+  POOL_UNKNOWN,
+  POOL_ON,
+  POOL_OFF
+};
+
+struct pool_class {
+  /* the cells the threads gave back */
+  void *free;
+  /* where the next cell is cut off from, and where the page ends */
+  char *next, *end;
+};
+
+static struct {
+  enum pool_state state;
+  pthread_once_t once;
+  pthread_mutex_t lock;
+  pthread_key_t key;
+  /* the region, and where its next page is taken from */
+  char *base, *top, *end;
+  /* the class of every page of the region */
+  unsigned char *classes;
+  struct pool_class class[POOL_CLASSES];
+} pools = {
+  .once = PTHREAD_ONCE_INIT,
+  .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+/* the calling thread's free cells */
+struct pool_cache {
+  void *free[POOL_CLASSES];
+  unsigned n[POOL_CLASSES];
+  bool registered;
+};
+
+#if defined(__GNUC__)
+/* (see `NM_ctx`) */
+static __thread struct pool_cache cache __attribute__((tls_model("initial-exec")));
+#else
+static _Thread_local struct pool_cache cache;
+#endif
+
+/* gives all of the exiting thread's cells back */
+static void pool_thread_exit(void *arg)
+{
+  /* {{{ */
+  struct pool_cache *c = arg;
+  void *cell, *next;
+  unsigned i;
+
+  pthread_mutex_lock(&pools.lock);
+
+  for (i = 0; i < POOL_CLASSES; i++){
+    for (cell = c->free[i]; cell != NULL; cell = next){
+      next = *(void **)cell;
+      *(void **)cell = pools.class[i].free;
+      pools.class[i].free = cell;
+    }
+
+    c->free[i] = NULL;
+    c->n[i] = 0;
+  }
+
+  pthread_mutex_unlock(&pools.lock);
+  /* }}} */
+}
+
+static void pool_init(void)
+{
+  /* {{{ */
+  const char *env = getenv("NEMO_ALLOC");
+  enum pool_state state = POOL_OFF;
+  void *base;
+
+  if (env != NULL && !strcmp(env, "system"))
+    goto out;
+
+  base = mmap(NULL, POOL_REGION_SIZE, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+  if (base == MAP_FAILED)
+    goto out;
+
+  if ((pools.classes = calloc(POOL_REGION_SIZE / POOL_PAGE_SIZE, 1)) == NULL ||
+      pthread_key_create(&pools.key, pool_thread_exit) != 0){
+    munmap(base, POOL_REGION_SIZE);
+    free(pools.classes);
+    goto out;
+  }
+
+#ifdef MADV_HUGEPAGE
+  if (env != NULL && !strcmp(env, "huge"))
+    madvise(base, POOL_REGION_SIZE, MADV_HUGEPAGE);
+#endif
+
+  pools.base = pools.top = base;
+  pools.end = pools.base + POOL_REGION_SIZE;
+  state = POOL_ON;
+
+out:
+  __atomic_store_n(&pools.state, state, __ATOMIC_RELEASE);
+  /* }}} */
+}
+
+static inline bool pool_on(void)
+{
+  /* {{{ */
+  enum pool_state state = __atomic_load_n(&pools.state, __ATOMIC_ACQUIRE);
+
+  if (state == POOL_UNKNOWN){
+    pthread_once(&pools.once, pool_init);
+    state = __atomic_load_n(&pools.state, __ATOMIC_ACQUIRE);
+  }
+
+  return state == POOL_ON;
+  /* }}} */
+}
+
+/* so that the thread's cells are given back once it's gone */
+static void pool_register(void)
+{
+  cache.registered = true;
+  pthread_setspecific(pools.key, &cache);
+}
+
+/* fills the calling thread's cache of the <class> up, returns NULL if the
+ * pools are used up */
+static void *pool_refill(unsigned class)
+{
+  /* {{{ */
+  struct pool_class *pc = &pools.class[class];
+  size_t size = (class + 1) * POOL_QUANTUM;
+  unsigned n;
+  void *cell;
+
+  if (!cache.registered)
+    pool_register();
+
+  pthread_mutex_lock(&pools.lock);
+
+  for (n = 0; n < POOL_BATCH; n++){
+    if ((cell = pc->free) != NULL)
+      pc->free = *(void **)cell;
+    else {
+      if (pc->next + size > pc->end){
+        if (pools.top == pools.end)
+          break;
+
+        pools.classes[(pools.top - pools.base) / POOL_PAGE_SIZE] = class;
+        pc->next = pools.top;
+        pc->end = pools.top + POOL_PAGE_SIZE;
+        pools.top += POOL_PAGE_SIZE;
+      }
+
+      cell = pc->next;
+      pc->next += size;
+    }
+
+    *(void **)cell = cache.free[class];
+    cache.free[class] = cell;
+  }
+
+  pthread_mutex_unlock(&pools.lock);
+
+  cache.n[class] += n;
+
+  return cache.free[class];
+  /* }}} */
+}
+
+void *pool_alloc(size_t size)
+{
+  /* {{{ */
+  unsigned class;
+  void *cell;
+
+  if (size == 0 || size > POOL_MAX || !pool_on())
+    return NULL;
+
+  class = (size - 1) / POOL_QUANTUM;
+
+  if ((cell = cache.free[class]) == NULL && (cell = pool_refill(class)) == NULL)
+    return NULL;
+
+  cache.free[class] = *(void **)cell;
+  cache.n[class]--;
+
+  return cell;
+  /* }}} */
+}
+
+bool pool_free(void *ptr)
+{
+  /* {{{ */
+  struct pool_class *pc;
+  unsigned class, n;
+  void *cell;
+
+  /* (the region doesn't move, and is there only if the pools are on) */
+  if ((char *)ptr < pools.base || (char *)ptr >= pools.end)
+    return false;
+
+  class = pools.classes[((char *)ptr - pools.base) / POOL_PAGE_SIZE];
+
+  if (!cache.registered)
+    pool_register();
+
+  *(void **)ptr = cache.free[class];
+  cache.free[class] = ptr;
+
+  if (++cache.n[class] <= POOL_CACHE_MAX)
+    return true;
+
+  pc = &pools.class[class];
+
+  pthread_mutex_lock(&pools.lock);
+
+  for (n = 0; n < POOL_BATCH; n++){
+    cell = cache.free[class];
+    cache.free[class] = *(void **)cell;
+    *(void **)cell = pc->free;
+    pc->free = cell;
+  }
+
+  pthread_mutex_unlock(&pools.lock);
+
+  cache.n[class] -= POOL_BATCH;
+
+  return true;
+  /* }}} */
+}
+
+size_t pool_size(void *ptr)
+{
+  if ((char *)ptr < pools.base || (char *)ptr >= pools.end)
+    return 0;
+
+  return (pools.classes[((char *)ptr - pools.base) / POOL_PAGE_SIZE] + 1) * POOL_QUANTUM;
+}
+#endif /* POOL_ALLOC */
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
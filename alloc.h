@@ -0,0 +1,54 @@
+/*
+ *
+ * alloc.h
+ *
+ * Created at:  Mon Oct 19 03:16:46 2026 03:16:46
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include <stddef.h>
+
+#include "config.h"
+#include "nemo.h"
+
+/*
+ * The pools the small allocations (of at most POOL_MAX bytes) are made from,
+ * behind `nmalloc` and friends.
+ *
+ * They're there unless nemo was built with -DPOOL_ALLOC=OFF, and the
+ * environment variable NEMO_ALLOC can choose at run time:
+ *
+ *   NEMO_ALLOC=system  everything comes from the system's malloc
+ *   NEMO_ALLOC=pools   the small allocations come from the pools (the default)
+ *   NEMO_ALLOC=huge    the same, with the pools backed by huge pages (where
+ *                      the system can do that)
+ */
+#define POOL_MAX 256
+
+#if POOL_ALLOC
+/* returns <size> bytes from the pools, NULL if they're not for the <size> (or
+ * are used up, or off) */
+void *pool_alloc(size_t size);
+/* gives the <ptr> back to the pools, returns false if it's not theirs */
+bool pool_free(void *ptr);
+/* returns how many bytes there are at the <ptr>, 0 if it's not the pools' */
+size_t pool_size(void *ptr);
+#else
+static inline void *pool_alloc(size_t size) { (void)size; return NULL; }
+static inline bool pool_free(void *ptr) { (void)ptr; return false; }
+static inline size_t pool_size(void *ptr) { (void)ptr; return 0; }
+#endif /* POOL_ALLOC */
+
+#endif /* ALLOC_H */
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
@@ -11,16 +11,28 @@
  */
 
 #include <assert.h>
+#include <setjmp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
+#include <string.h>
+
+#include <sys/resource.h>
 
 #include "ast.h"
+#include "closure.h"
+#include "layout.h"
 #include "debug.h"
+#include "infer.h"
+#include "jit.h"
+#include "list.h"
 #include "mem.h"
 #include "infnum.h"
 #include "nob.h"
 #include "lexer.h"
+#include "profile.h"
+#include "str.h"
+#include "tier.h"
 #include "util.h"
 #include "utf8.h"
 
@@ -33,33 +45,31 @@
 /* returns <node>'s id, or 0 if the node is none */
 #define NDID(node) ((node) == NULL ? 0 : (node)->id)
 
-/* program counter */
-static struct node *NM_pc = NULL;
-
-/* the argument stack */
-static Nob  **NM_as      = NULL;
-static Nob  **NM_as_curr = NULL;
-static size_t NM_as_size = 16;
-
-/* the current node's id */
-static unsigned currid = 1;
-
-/* the current generic label id */
-static unsigned currlabelid = 0;
-
-/* buffers for the assembly sections (the `out` functions writes into them) */
-struct section text  = { { 0 }, 0 };
-struct section data  = { { 0 }, 0 };
-struct section bss   = { { 0 }, 0 };
-struct section funcs = { { 0 }, 0 };
-/* the current section we are writing to */
-struct section *currsect = &text;
+/* the interpreter's state lives in the context the thread is in (see
+ * context.h) */
+#define NM_pc          (NM_ctx->pc)
+#define NM_as          (NM_ctx->as)
+#define NM_as_end      (NM_ctx->as_end)
+#define NM_as_size     (NM_ctx->as_size)
+#define NM_fs          (NM_ctx->fs)
+#define NM_fs_curr     (NM_ctx->fs_curr)
+#define NM_fs_size     (NM_ctx->fs_size)
+#define NM_fp          (NM_ctx->fp)
+#define NM_cs_base     (NM_ctx->cs_base)
+#define NM_cs_limit    (NM_ctx->cs_limit)
+#define NM_tail        (NM_ctx->tail)
+#define NM_fuel        (NM_ctx->fuel)
+#define currid         (NM_ctx->currid)
+#define currlabelid    (NM_ctx->currlabelid)
+#define currfunc       (NM_ctx->currfunc)
+#define pending_funs   (NM_ctx->pending_funs)
 
 /* {{{ argument stack manipulation functions */
 void arg_stack_init(void)
 {
   NM_as = ncalloc(NM_as_size, sizeof(Nob *));
   NM_as_curr = NM_as;
+  NM_as_end = NM_as + NM_as_size;
 }
 
 void arg_stack_finish(void)
@@ -67,18 +77,37 @@ void arg_stack_finish(void)
   nfree(NM_as);
 }
 
-void arg_stack_push(Nob *ob, const char *file, unsigned line)
+/*
+ * Makes room for (at least) <n> more elements on the stack.
+ *
+ * That's done once per function call, for as many elements as the function
+ * keeps on the stack at most (see `stack_depth`), so the pushes and pops
+ * themselves don't have to check anything. Growing the stack moves it, so
+ * only the indexes into it are safe to keep across calls.
+ */
+static void arg_stack_reserve(unsigned n)
 {
-  ptrdiff_t offset = NM_as_curr - NM_as;
-  /* hmm, will they be ever used? */
-  (void)file;
-  (void)line;
+  ptrdiff_t offset;
+
+  if ((size_t)(NM_as_end - NM_as_curr) >= n)
+    return;
+
+  offset = NM_as_curr - NM_as;
+
+  while (NM_as_size - offset < n)
+    NM_as_size *= 2;
 
-  /* handle overflow */
-  if (offset >= (signed)NM_as_size){
-    NM_as_size *= 1.5;
-    NM_as = nrealloc(NM_as, sizeof(int *) * NM_as_size);
-    NM_as_curr = NM_as + offset; /* adjust the 'current' pointer */
+  NM_as = nrealloc(NM_as, sizeof(Nob *) * NM_as_size);
+  NM_as_curr = NM_as + offset;
+  NM_as_end = NM_as + NM_as_size;
+}
+
+#if DEBUG
+void arg_stack_push(Nob *ob, const char *file, unsigned line)
+{
+  if (NM_as_curr >= NM_as_end){
+    fprintf(stderr, "nemo: argument stack overflow! in %s line %u\n", file, line);
+    exit(1);
   }
 
   *NM_as_curr = ob; /* set up the current `cell' */
@@ -87,9 +116,7 @@ void arg_stack_push(Nob *ob, const char *file, unsigned line)
 
 Nob *arg_stack_pop(const char *file, unsigned line)
 {
-  ptrdiff_t offset = NM_as_curr - NM_as;
-
-  if (offset < 0){
+  if (NM_as_curr <= NM_as){
     fprintf(stderr, "nemo: argument stack underflow! in %s line %u\n", file, line);
     exit(1);
   }
@@ -98,11 +125,7 @@ Nob *arg_stack_pop(const char *file, unsigned line)
 
   return *NM_as_curr;
 }
-
-Nob *arg_stack_top(void)
-{
-  return *(NM_as_curr - 1);
-}
+#endif
 
 void arg_stack_dump(void)
 {
@@ -125,27 +148,247 @@ void arg_stack_dump(void)
 }
 /* }}} */
 
+/* {{{ frame stack manipulation functions */
+/*
+ * <size> is in KiB.
+ */
+void frame_stack_init(size_t size)
+{
+  struct rlimit rl;
+
+  NM_fs_size = size * 1024;
+  NM_fs = nmalloc(NM_fs_size);
+  NM_fs_curr = NM_fs;
+
+  /* calls are executed recursively, so the C stack has to be kept an eye on
+   * as well (leaving some room for whatever happens after the check) */
+  if (getrlimit(RLIMIT_STACK, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY)
+    NM_cs_limit = rl.rlim_cur;
+  else
+    NM_cs_limit = 8 << 20;
+
+  NM_cs_limit -= NM_cs_limit / 8;
+}
+
+void frame_stack_finish(void)
+{
+  nfree(NM_fs);
+}
+
+/*
+ * Creates a frame (on the frame stack) for a call to a function whose
+ * variables are in <scope>.
+ */
+static struct frame *push_frame(struct scope *scope, struct frame *up)
+{
+  struct frame *frame = (struct frame *)NM_fs_curr;
+  size_t size = sizeof(struct frame) + sizeof(Nob *) * scope->frame_size;
+  char here;
+
+  if (NM_cs_base != NULL && (size_t)(NM_cs_base - &here) > NM_cs_limit){
+    fprintf(stderr, "nemo: call stack overflow (the recursion is too deep)\n");
+    exit(1);
+  }
+
+  if ((size_t)(NM_fs_curr - NM_fs) + size > NM_fs_size){
+    fprintf(stderr, "nemo: frame stack overflow (the limit is %zu KiB, see"
+        " option -s)\n", NM_fs_size / 1024);
+    exit(1);
+  }
+
+  NM_fs_curr += size;
+
+  frame->scope = scope;
+  frame->up = up;
+  frame->moved = NULL;
+  /* so the variables that weren't declared yet are not some garbage */
+  memset(frame->slots, 0x0, sizeof(Nob *) * scope->frame_size);
+
+  return frame;
+}
+
+static inline struct frame *follow(struct frame *frame)
+{
+  while (frame != NULL && frame->moved != NULL)
+    frame = frame->moved;
+
+  return frame;
+}
+
+/*
+ * Returns the current frame of the function <scope> belongs to (that is, the
+ * one its variables are in), which has to be either the currently executed
+ * one or one of its enclosing functions'. NULL is returned for the global
+ * scope.
+ */
+static struct frame *frame_of(struct scope *scope)
+{
+  struct frame *frame;
+
+  if (scope == NULL || scope->parent == NULL)
+    return NULL;
+
+  for (frame = follow(NM_fp); frame->scope != scope; frame = follow(frame->up))
+    assert(frame->up != NULL);
+
+  return frame;
+}
+
+/*
+ * Makes sure the given <frame> (and every one it links to) outlives the
+ * function call it was made for, as a closure is going to refer to it.
+ *
+ * Frames are moved onto the heap (where the collector takes care of them, see
+ * `gc_new_frame`), and the original leaves a note where to, so whatever still
+ * points at it keeps working.
+ */
+static struct frame *capture_frame(struct frame *frame)
+{
+  struct frame *copy;
+  size_t size;
+  unsigned i;
+
+  frame = follow(frame);
+
+  if (frame == NULL || (char *)frame < NM_fs || (char *)frame >= NM_fs + NM_fs_size)
+    /* the global scope, or already on the heap */
+    return frame;
+
+  size = sizeof(struct frame) + sizeof(Nob *) * frame->scope->frame_size;
+  copy = gc_new_frame(size);
+  memcpy(copy, frame, size);
+  copy->up = capture_frame(frame->up);
+  frame->moved = copy;
+
+  /* the frame is not on the frame stack anymore, where the collector looks */
+  for (i = 0; i < frame->scope->frame_size; i++)
+    gc_remember(&copy->slots[i]);
+
+  return copy;
+}
+
+/*
+ * Returns the place where the value of the given <var> is stored.
+ */
+static Nob **var_cell(struct var *var)
+{
+  if (var->scope->parent == NULL)
+    return &var->nob;
+
+  return &frame_of(var->scope)->slots[var->slot];
+}
+
+/*
+ * Stores the <value> in the <cell> (see `var_cell`), letting the collector
+ * know if it's one of those it doesn't look at otherwise.
+ */
+static inline void set_cell(Nob **cell, Nob *value)
+{
+  if ((char *)cell >= NM_fs && (char *)cell < NM_fs + NM_fs_size)
+    *cell = value;
+  else
+    gc_write(cell, value);
+}
+
+/*
+ * A minor collection (see nob.c), whose roots are the argument stack and the
+ * frame stack (the frames which were moved are of no use), and then a step of
+ * a major one, whose roots are the globals as well, and the frames on the heap
+ * the frame stack links to.
+ */
+static void collect(void)
+{
+  /* {{{ */
+  struct vars_list *vars;
+  struct frame *frame;
+  Nob **slot;
+  char *p;
+  unsigned i;
+
+  if (gc_minor_begin()){
+    for (slot = NM_as; slot < NM_as_curr; slot++)
+      gc_evacuate(slot);
+
+    for (p = NM_fs; p < NM_fs_curr; p += sizeof(struct frame) +
+        sizeof(Nob *) * frame->scope->frame_size){
+      frame = (struct frame *)p;
+
+      if (frame->moved == NULL)
+        for (i = 0; i < frame->scope->frame_size; i++)
+          gc_evacuate(&frame->slots[i]);
+    }
+
+    gc_minor_end();
+  }
+
+  gc_major_step();
+
+  if (!gc_major_begin())
+    return;
+
+  for (slot = NM_as; slot < NM_as_curr; slot++)
+    gc_major_root(*slot);
+
+  for (p = NM_fs; p < NM_fs_curr; p += sizeof(struct frame) +
+      sizeof(Nob *) * frame->scope->frame_size){
+    frame = (struct frame *)p;
+
+    if (frame->moved == NULL)
+      for (i = 0; i < frame->scope->frame_size; i++)
+        gc_major_root(frame->slots[i]);
+    else
+      gc_major_frame(frame->moved);
+
+    /* a closure's (see `call_saturated`) */
+    if (frame->up != NULL && ((char *)frame->up < NM_fs ||
+          (char *)frame->up >= NM_fs + NM_fs_size))
+      gc_major_frame(frame->up);
+  }
+
+  if (NM_ctx->globals != NULL)
+    for (vars = NM_ctx->globals->vars; vars != NULL; vars = vars->next)
+      gc_major_root(vars->var->nob);
+
+  gc_major_spawn();
+  /* }}} */
+}
+
+/*
+ * The places where nothing but the stacks (and the remembered set) points at
+ * the young objects, which is where they can be moved.
+ */
+#define SAFE_POINT() do { \
+  if (NM_ctx->gc_pending) \
+    collect(); \
+} while (0)
+/* }}} */
+
 /* new_node
  *
  * Create a new node and append it to the <lex>'s `nodes` list.
  *
+ * Both <parser> and <lex> can be NULL, for nodes created after the parsing is
+ * done (by the optimizer, for instance); the caller is then responsible for
+ * setting the node's scope.
+ *
  */
 static struct node *new_node_internal(struct parser *parser, struct lexer *lex,
     enum node_type type, execf_t execf, compf_t compf, dumpf_t dumpf)
 {
   /* {{{ */
-  struct nodes_list *el = nmalloc(sizeof(struct nodes_list));
   struct node *new = nmalloc(sizeof(struct node));
 
   /* set the node's default values */
   new->id = currid++;
   new->next = NULL;
-  new->scope = parser->curr_scope;
+  new->scope = parser ? parser->curr_scope : NULL;
   /* set the node's non-default values */
   new->type = type;
   new->result_type = NULL;
   new->execf = execf;
   new->compf = compf;
+  new->line = lex ? lex->line : 0;
+  new->col = lex ? lex->col : 0;
 
 #if DEBUG
   new->dumpf = dumpf;
@@ -154,11 +397,15 @@ static struct node *new_node_internal(struct parser *parser, struct lexer *lex,
   (void)dumpf;
 #endif
 
-  /* associate the node with the list's element */
-  el->node = new;
-  /* append to the lexer's list */
-  el->next = lex->nodes;
-  lex->nodes = el;
+  if (lex){
+    struct nodes_list *el = nmalloc(sizeof(struct nodes_list));
+
+    /* associate the node with the list's element */
+    el->node = new;
+    /* append to the lexer's list */
+    el->next = lex->nodes;
+    lex->nodes = el;
+  }
 
   return new;
   /* }}} */
@@ -175,7 +422,7 @@ static struct node *new_node_internal(struct parser *parser, struct lexer *lex,
 #if DEBUG
 /* {{{ dump macros */
 /* maintaining the proper amount of spaces before the node's dump */
-static int nodes_sw = 3;
+#define nodes_sw (NM_ctx->dump_indent)
 #define INDENT() do { nodes_sw += 2; } while (0)
 #define DEDENT() do { nodes_sw -= 2; } while (0)
 #define SPACES() do { \
@@ -220,16 +467,18 @@ void dump_nop(struct node *nd)
 void dump_const(struct node *nd)
 {
   if (nd->type == NT_INTEGER){
-    printf("+ (#%u) const (integer %d)", nd->id, nd->in.i);
+    printf("+ (#%u) const (integer %d)\n", nd->id, nd->in.i);
   } else if (nd->type == NT_CHAR)
     printf("+ (#%u) const (char %lc)\n", nd->id, nd->in.c);
+  else if (nd->type == NT_STRING)
+    printf("+ (#%u) const (string \"%s\")\n", nd->id, nd->in.s);
   else
     printf("+ (#%u) const\n", nd->id);
 }
 
 void dump_tuple(struct node *nd)
 {
-  printf("+ (#%u) tuple\n", NDID(nd));
+  printf("+ (#%u) %s\n", NDID(nd), nodetype_to_s(nd->type));
 
   for (struct nodes_list *p = nd->in.tuple.elems; p != NULL; p = p->next){
     INDENT();
@@ -241,6 +490,11 @@ void dump_tuple(struct node *nd)
   }
 }
 
+void dump_list(struct node *nd)
+{
+  dump_tuple(nd);
+}
+
 void dump_name(struct node *nd)
 {
   printf("+ (#%u) name (%s)\n", NDID(nd), nd->in.s);
@@ -350,7 +604,8 @@ void dump_if(struct node *nd)
 void dump_fun(struct node *nd)
 {
   struct node *d = nd->in.fun.body;
-  struct nob_type *p = nd->result_type->info.func.param;
+  struct nob_type *t = nd->result_type;
+  unsigned i;
 
   if (nd->in.fun.name)
     printf("+ (#%u) fun (%s)\n", nd->id, nd->in.fun.name);
@@ -361,41 +616,61 @@ void dump_fun(struct node *nd)
   DUMPP("- body:");
   INDENT();
 
-  do {
+  for (; d != NULL; d = d->next)
     DUMP(d);
-  } while ((d = d->next) != NULL);
 
   DEDENT();
 
-  if (p){
-    DUMPP("- param:");
+  if (nd->in.fun.arity > 0){
+    DUMPP("- params:");
     INDENT();
-    nob_print_type(p);
+
+    /* the function's type is curried, one param at a time */
+    for (i = 0; i < nd->in.fun.arity; i++){
+      SPACES();
+      printf("%%%u: ", i + 1);
+
+      if (t && t->primitive == OT_FUN){
+        nob_print_type(t->info.func.param);
+        t = t->info.func.return_type;
+      }
+
+      putchar('\n');
+    }
+
+    DEDENT();
   } else {
     DUMPP("- no params");
   }
 
   DEDENT();
-  DEDENT();
 }
 
 void dump_call(struct node *nd)
 {
-  printf("+ (#%u) call\n", nd->id);
+  struct nodes_list *arg;
+
+  printf("+ (#%u) %scall (%u args)\n", nd->id, nd->in.call.tail ? "tail " : "",
+      nd->in.call.argc);
 
   INDENT();
   DUMPP("- target function:");
   INDENT();
-  SPACES();
-  /*if (nd->in.call.fun->in.fun.name)*/
-    /*printf("+ (#%u) fun (%s)\n", NDID(nd->in.call.fun), nd->in.call.fun->in.fun.name);*/
-  /*else*/
-    /*printf("+ (#%u) lambda\n", NDID(nd->in.call.fun));*/
+
+  if (nd->in.call.known && nd->in.call.known != nd->in.call.fun){
+    SPACES();
+    printf("+ (#%u) known to be #%u\n", NDID(nd->in.call.fun), NDID(nd->in.call.known));
+  } else {
+    DUMP(nd->in.call.fun);
+  }
 
   DEDENT();
   DUMPP("- args:");
   INDENT();
-  DUMPP("(not yet implemented)");
+
+  for (arg = nd->in.call.args; arg != NULL; arg = arg->next)
+    DUMP(arg->node);
+
   DEDENT();
   DEDENT();
 }
@@ -420,13 +695,97 @@ void dump_print(struct node *nd)
 #endif /* DEBUG */
 
 /* {{{ exec_nodes */
-void exec_nodes(struct node *node)
+static Nob *dispatch(struct node *node, unsigned stack)
 {
+  /* (the statements can grow the stack, see `arg_stack_reserve`) */
+  ptrdiff_t base;
+  Nob *last = NULL;
+
+  /* every statement starts where the last one did, so there's room for any of
+   * them from now on */
+  arg_stack_reserve(stack);
+  base = NM_as_curr - NM_as;
+
   NM_pc = node;
 
-  if (NM_pc)
-    while (EXEC(NM_pc))
-      ;
+  while (NM_pc != NULL){
+    SAFE_POINT();
+    EXEC(NM_pc);
+    /* the statement's result is of no use anymore (unless it's the last one) */
+    last = NM_as_curr > NM_as + base ? TOP() : NULL;
+    NM_as_curr = NM_as + base;
+  }
+
+  return last;
+}
+
+/*
+ * The budget is burned by `call_saturated` (once per call, and per iteration
+ * of a loop), which jumps back here when there's none left, abandoning the
+ * execution.
+ */
+static Nob *dispatch_fueled(struct node *node, unsigned stack)
+{
+  /* (the stack could have grown by the time it jumps back, see
+   * `arg_stack_reserve`) */
+  ptrdiff_t base = NM_as_curr - NM_as;
+  char *fs = NM_fs_curr;
+  struct frame *fp = NM_fp;
+  struct gc_roots *roots = NM_ctx->gc_roots;
+
+  NM_fuel.left = NM_fuel.budget;
+  NM_fuel.exhausted = false;
+
+  if (setjmp(NM_fuel.out)){
+    NM_as_curr = NM_as + base;
+    NM_fs_curr = fs;
+    NM_fp = fp;
+    /* the roots protected by the functions it jumped out of are gone */
+    NM_ctx->gc_roots = roots;
+    NM_tail.fun = NULL;
+    NM_pc = NULL;
+    NM_fuel.exhausted = true;
+
+    return NULL;
+  }
+
+  return dispatch(node, stack);
+}
+
+static void out_of_fuel(void)
+{
+  longjmp(NM_fuel.out, 1);
+}
+
+/*
+ * Executes the statements starting at <node>, which keep at most <stack>
+ * elements on the argument stack (see `chain_stack_depth`), and returns the
+ * value of the last one (NULL if it has none, like a declaration of a type, or
+ * if the execution ran out of fuel).
+ */
+Nob *exec_nodes(struct node *node, unsigned stack)
+{
+  char here;
+
+  /* unless it was given some other size */
+  if (NM_fs == NULL)
+    frame_stack_init(NM_FRAME_STACK_DEFAULT);
+
+  if (NM_cs_base == NULL){
+    NM_cs_base = &here;
+    NM_jit_stack_limit = NM_cs_base - NM_cs_limit;
+  }
+
+  /* where the collector looks for the globals */
+  if (node != NULL)
+    NM_ctx->globals = node->scope;
+
+  /* the metered loop only when there's a budget, so there's no cost of it
+   * otherwise */
+  if (NM_fuel.enabled)
+    return dispatch_fueled(node, stack);
+
+  return dispatch(node, stack);
 }
 
 struct node *exec_nop(struct node *nd)
@@ -450,6 +809,9 @@ struct node *exec_const(struct node *nd)
   } else if (nd->type == NT_CHAR){
     debug_ast_exec(nd, "char (%lc)", nd->in.c);
     PUSH(new_nob(T_CHAR, nd->in.c));
+  } else if (nd->type == NT_STRING){
+    debug_ast_exec(nd, "string (%s)", nd->in.s);
+    PUSH(new_nob(T_STRING, nd->in.s, (unsigned)strlen(nd->in.s)));
   }
 
   RETURN_NEXT;
@@ -459,22 +821,52 @@ struct node *exec_const(struct node *nd)
 struct node *exec_tuple(struct node *nd)
 {
   /* {{{ */
-  struct nobs_list *nobs = NULL;
   struct nodes_list *nodes;
-  struct nobs_list *el;
+  unsigned length = 0, i;
+  Nob *tuple;
+
+  /* the elements stay on the stack until they're all there (a collection
+   * could happen in the meantime) */
+  for (nodes = nd->in.tuple.elems; nodes != NULL; nodes = nodes->next, length++)
+    EXEC(nodes->node);
+
+  /* (the inference leaves the ill-typed ones be, and the collector has to
+   * know it's a tuple) */
+  if (nd->result_type == NULL || nd->result_type->primitive != OT_TUPLE)
+    nd->result_type = new_type(OT_TUPLE, NULL);
+
+  /* they're on the stack in order */
+  tuple = new_nob(nd->result_type, length, NM_as_curr - length);
 
-  /* transform the nodes_list into nobs_list */
-  for (nodes = nd->in.tuple.elems; nodes != NULL; nodes = nodes->next){
-    el = nmalloc(sizeof(struct nobs_list));
+  for (i = 0; i < length; i++)
+    POP();
 
+  PUSH(tuple);
+
+  RETURN_NEXT;
+  /* }}} */
+}
+
+struct node *exec_list(struct node *nd)
+{
+  /* {{{ */
+  struct nodes_list *nodes;
+  unsigned length = 0, i;
+  Nob *list;
+
+  /* (see `exec_tuple`) */
+  for (nodes = nd->in.tuple.elems; nodes != NULL; nodes = nodes->next, length++)
     EXEC(nodes->node);
-    el->nob = POP();
-    el->next = nobs;
-    nobs = el;
-  }
 
-  /* TODO */
-  PUSH(new_nob(/* FIXME */ T_INT, reverse_nobs_list(nobs)));
+  if (nd->result_type == NULL || nd->result_type->primitive != OT_LIST)
+    nd->result_type = new_type(OT_LIST, new_type(OT_TYPE_VARIABLE));
+
+  list = list_from(nd->result_type, length, NM_as_curr - length);
+
+  for (i = 0; i < length; i++)
+    POP();
+
+  PUSH(list);
 
   RETURN_NEXT;
   /* }}} */
@@ -484,14 +876,26 @@ struct node *exec_name(struct node *nd)
 {
   /* {{{  */
   struct var *var = var_lookup(nd->in.s, nd->scope);
+  Nob *value;
 
-  if (var)
-    EXEC(var->value);
-  else {
+  debug_ast_exec(nd, "name (%s)", nd->in.s);
+
+  if (!var){
     fprintf(stderr, "variable '%s' not found! runtime!!\n", nd->in.s);
     exit(1);
   }
 
+  if ((value = *var_cell(var)) != NULL){
+    PUSH(value);
+  } else if (var->decl == NULL){
+    /* there's no declaration to be executed (eg. a type's constructor) */
+    EXEC(var->value);
+  } else {
+    fprintf(stderr, "variable '%s' used before it was initialized! runtime!!\n",
+        nd->in.s);
+    exit(1);
+  }
+
   RETURN_NEXT;
   /* }}} */
 }
@@ -506,10 +910,12 @@ struct node *exec_decl(struct node *nd)
     debug_ast_exec(nd, "declaration (%s, 0x%02x, #--)", nd->in.decl.var->name,
         nd->in.decl.var->flags);
 
-  if (nd->in.decl.var->value)
+  if (nd->in.decl.var->value){
     EXEC(nd->in.decl.var->value);
-
-  /* TODO associate the value with the variable */
+    /* associate the value with the variable, so that it's not evaluated again
+     * every time the variable is used */
+    set_cell(var_cell(nd->in.decl.var), TOP());
+  }
 
   RETURN_NEXT;
   /* }}} */
@@ -535,88 +941,587 @@ struct node *exec_unop(struct node *nd)
   /* }}} */
 }
 
-struct node *exec_binop(struct node *nd)
+/* {{{ binary operations */
+static void binop_error(enum binop_type op, Nob *left, Nob *right)
 {
   /* {{{ */
-  Nob *left, *right;
-
-  EXEC(nd->in.binop.left);
-  EXEC(nd->in.binop.right);
-
-  debug_ast_exec(nd, "binop ('%s', #%u, #%u)", binop_to_s(nd->in.binop.type),
-      nd->in.binop.left->id, nd->in.binop.right->id);
-
-  right = POP();
-  left  = POP();
-
-  assert(left->ptr != NULL);
-  assert(right->ptr != NULL);
+  fprintf(stderr, "can't apply the binary '%s' operation to a %s and a %s!"
+      " runtime!!\n", binop_to_s(op),
+      left->type->name ? left->type->name : "value",
+      right->type->name ? right->type->name : "value");
+  exit(1);
+  /* }}} */
+}
 
-  switch (nd->in.binop.type){
-    /* fall through */
-    case BINARY_ADD:
-    case BINARY_SUB:
-    case BINARY_MUL:
+static Nob *int_binop(enum binop_type op, int32_t l, int32_t r)
+{
+  /* {{{ */
+  /* the arithmetic is done on unsigned values, as the wraparound is what the
+   * compiled code does as well (and signed overflow in C is undefined) */
+  uint32_t ul = (uint32_t)l, ur = (uint32_t)r;
+
+  switch (op){
+    case BINARY_ADD:    return new_nob(T_INT, (int32_t)(ul + ur));
+    case BINARY_SUB:    return new_nob(T_INT, (int32_t)(ul - ur));
+    case BINARY_MUL:    return new_nob(T_INT, (int32_t)(ul * ur));
     case BINARY_DIV:
     case BINARY_MOD:
-    case BINARY_SHL:
-    case BINARY_SHR:
-    case BINARY_BITAND:
-    case BINARY_BITXOR:
-    case BINARY_BITOR:
-    case BINARY_GT:
-    case BINARY_LT:
-    case BINARY_GE:
-    case BINARY_LE:
-    case BINARY_EQ:
-    case BINARY_NE:
-    case BINARY_ASSIGN:
-    case BINARY_ASSIGN_ADD:
-    case BINARY_ASSIGN_SUB:
-    case BINARY_ASSIGN_MUL:
-    case BINARY_ASSIGN_DIV:
-    case BINARY_ASSIGN_MOD:
-    case BINARY_COMMA:
-      PUSH(new_nob(T_INT, 0));
-      break;
-    default: /* meh */;
+      if (r == 0){
+        fprintf(stderr, "division by zero! runtime!!\n");
+        exit(1);
+      }
+
+      /* that's the one quotient that doesn't fit */
+      if (l == INT32_MIN && r == -1)
+        return new_nob(T_INT, op == BINARY_DIV ? INT32_MIN : 0);
+
+      return new_nob(T_INT, op == BINARY_DIV ? l / r : l % r);
+    case BINARY_SHL:    return new_nob(T_INT, (int32_t)(ul << (ur & 0x1f)));
+    case BINARY_SHR:    return new_nob(T_INT, (int32_t)(ul >> (ur & 0x1f)));
+    case BINARY_BITAND: return new_nob(T_INT, l & r);
+    case BINARY_BITXOR: return new_nob(T_INT, l ^ r);
+    case BINARY_BITOR:  return new_nob(T_INT, l | r);
+    case BINARY_GT:     return new_nob(T_INT, l >  r);
+    case BINARY_LT:     return new_nob(T_INT, l <  r);
+    case BINARY_GE:     return new_nob(T_INT, l >= r);
+    case BINARY_LE:     return new_nob(T_INT, l <= r);
+    case BINARY_EQ:     return new_nob(T_INT, l == r);
+    case BINARY_NE:     return new_nob(T_INT, l != r);
+    default:            return NULL;
   }
+  /* }}} */
+}
 
-  RETURN_NEXT;
+static Nob *real_binop(enum binop_type op, double l, double r)
+{
+  /* {{{ */
+  switch (op){
+    case BINARY_ADD: return new_nob(T_REAL, l + r);
+    case BINARY_SUB: return new_nob(T_REAL, l - r);
+    case BINARY_MUL: return new_nob(T_REAL, l * r);
+    case BINARY_DIV: return new_nob(T_REAL, l / r);
+    case BINARY_GT:  return new_nob(T_INT, l >  r);
+    case BINARY_LT:  return new_nob(T_INT, l <  r);
+    case BINARY_GE:  return new_nob(T_INT, l >= r);
+    case BINARY_LE:  return new_nob(T_INT, l <= r);
+    case BINARY_EQ:  return new_nob(T_INT, l == r);
+    case BINARY_NE:  return new_nob(T_INT, l != r);
+    default:         return NULL;
+  }
   /* }}} */
 }
 
-struct node *exec_ternop(struct node *nd)
+static Nob *infnum_binop(enum binop_type op, struct infnum l, struct infnum r)
 {
   /* {{{ */
-  Nob *predicate;
+  switch (op){
+    case BINARY_ADD:    return new_nob(T_INFNUM, infnum_add(l, r));
+    case BINARY_SUB:    return new_nob(T_INFNUM, infnum_sub(l, r));
+    case BINARY_MUL:    return new_nob(T_INFNUM, infnum_mul(l, r));
+    case BINARY_BITAND: return new_nob(T_INFNUM, infnum_and(l, r));
+    case BINARY_BITXOR: return new_nob(T_INFNUM, infnum_xor(l, r));
+    case BINARY_BITOR:  return new_nob(T_INFNUM, infnum_or(l, r));
+    case BINARY_GT:     return new_nob(T_INT, infnum_cmp(l, r) == INFNUM_CMP_GT);
+    case BINARY_LT:     return new_nob(T_INT, infnum_cmp(l, r) == INFNUM_CMP_LT);
+    case BINARY_GE:     return new_nob(T_INT, infnum_cmp(l, r) != INFNUM_CMP_LT);
+    case BINARY_LE:     return new_nob(T_INT, infnum_cmp(l, r) != INFNUM_CMP_GT);
+    case BINARY_EQ:     return new_nob(T_INT, infnum_cmp(l, r) == INFNUM_CMP_EQ);
+    case BINARY_NE:     return new_nob(T_INT, infnum_cmp(l, r) != INFNUM_CMP_EQ);
+    default:            return NULL;
+  }
+  /* }}} */
+}
 
-  debug_ast_exec(nd, "ternop (#%u, #%u, #%u)", nd->in.ternop.predicate->id,
-      nd->in.ternop.yes->id, nd->in.ternop.no->id);
+static bool is_integral(Nob *ob)
+{
+  return ob->type->primitive == OT_INT || ob->type->primitive == OT_CHAR;
+}
 
-  EXEC(nd->in.ternop.predicate);
-  predicate = POP();
+/* returns the <i> if it's an index of an element of the <seq> (a list or a
+ * string), or its length, if <inclusive>, exits otherwise */
+static unsigned seq_index(Nob *seq, int32_t i, bool inclusive)
+{
+  /* {{{ */
+  bool string = seq->type->primitive == OT_STRING;
+  unsigned length = string ? str_length(seq) : list_length(seq);
 
-  if (nob_is_true(predicate)){
-    EXEC(nd->in.ternop.yes);
-  } else {
-    EXEC(nd->in.ternop.no);
+  if (i < 0 || (unsigned)i > length || ((unsigned)i == length && !inclusive)){
+    fprintf(stderr, "index %d is out of the bounds of a %s of %u! runtime!!\n",
+        i, string ? "string" : "list", length);
+    exit(1);
   }
 
-  RETURN_NEXT;
+  return i;
   /* }}} */
 }
 
-struct node *exec_if(struct node *nd)
+/*
+ * Sets the <from> and the <to> to the bounds of a slice of the <seq> (a list
+ * or a string), the <right> operand of the BINARY_SLICE, which the parser
+ * makes a tuple of the two (see `postfix_expr`). Returns false if it's not.
+ */
+static bool seq_bounds(Nob *seq, Nob *right, unsigned *from, unsigned *to)
 {
   /* {{{ */
-  Nob *guard;
+  struct nob_tuple *bounds;
 
-  if (nd->in.iff.elsee != NULL)
-    debug_ast_exec(nd, "if (#%u, #%u, #%u)",
-      nd->in.iff.guard->id,
-      nd->in.iff.body->id,
-      nd->in.iff.elsee->id);
+  if (right->type->primitive != OT_TUPLE)
+    return false;
+
+  bounds = NOB_GET_TUPLE(right);
+
+  if (bounds->length != 2 || NOB_TUPLE_KINDS(bounds)[0] != OT_INT ||
+      NOB_TUPLE_KINDS(bounds)[1] != OT_INT)
+    return false;
+
+  *from = seq_index(seq, bounds->elems[0].i, true);
+  *to = seq_index(seq, bounds->elems[1].i, true);
+
+  /* (the slices the other way round are empty) */
+  if (*from > *to)
+    *to = *from;
+
+  return true;
+  /* }}} */
+}
+
+/* the operations on the lists, NULL if the <op> is not one of them */
+static Nob *list_binop(enum binop_type op, Nob *left, Nob *right)
+{
+  /* {{{ */
+  unsigned from, to;
+
+  switch (op){
+    case BINARY_ADD:
+      if (right->type->primitive != OT_LIST)
+        return NULL;
+
+      return list_concat(left, right);
+    case BINARY_INDEX:
+      if (!is_integral(right))
+        return NULL;
+
+      return list_get(left, seq_index(left, NOB_GET_INT(right), false));
+    case BINARY_SLICE:
+      if (!seq_bounds(left, right, &from, &to))
+        return NULL;
+
+      return list_slice(left, from, to);
+    default:
+      return NULL;
+  }
+  /* }}} */
+}
+
+/* the operations on the strings, NULL if the <op> is not one of them */
+static Nob *str_binop(enum binop_type op, Nob *left, Nob *right)
+{
+  /* {{{ */
+  unsigned from, to;
+
+  if (op == BINARY_INDEX){
+    if (!is_integral(right))
+      return NULL;
+
+    return new_nob(T_CHAR, str_get(left, seq_index(left, NOB_GET_INT(right), false)));
+  }
+
+  if (op == BINARY_SLICE){
+    if (!seq_bounds(left, right, &from, &to))
+      return NULL;
+
+    return str_slice(left, from, to);
+  }
+
+  if (right->type->primitive != OT_STRING)
+    return NULL;
+
+  switch (op){
+    case BINARY_ADD: return str_concat(left, right);
+    case BINARY_GT:  return new_nob(T_INT, str_compare(left, right) > 0);
+    case BINARY_LT:  return new_nob(T_INT, str_compare(left, right) < 0);
+    case BINARY_GE:  return new_nob(T_INT, str_compare(left, right) >= 0);
+    case BINARY_LE:  return new_nob(T_INT, str_compare(left, right) <= 0);
+    case BINARY_EQ:  return new_nob(T_INT, str_compare(left, right) == 0);
+    case BINARY_NE:  return new_nob(T_INT, str_compare(left, right) != 0);
+    default:         return NULL;
+  }
+  /* }}} */
+}
+
+/*
+ * Returns the result of the <op> (an arithmetic or a comparison one) applied
+ * to the <left> and <right>, looking at the types of both.
+ */
+static Nob *binop_nobs(enum binop_type op, Nob *left, Nob *right)
+{
+  /* {{{ */
+  Nob *ret = NULL;
+
+  if (is_integral(left) && is_integral(right))
+    ret = int_binop(op, NOB_GET_INT(left), NOB_GET_INT(right));
+  else if (left->type->primitive == OT_REAL && right->type->primitive == OT_REAL)
+    ret = real_binop(op, NOB_GET_REAL(left), NOB_GET_REAL(right));
+  else if (left->type->primitive == OT_REAL && is_integral(right))
+    ret = real_binop(op, NOB_GET_REAL(left), NOB_GET_INT(right));
+  else if (is_integral(left) && right->type->primitive == OT_REAL)
+    ret = real_binop(op, NOB_GET_INT(left), NOB_GET_REAL(right));
+  else if (left->type->primitive == OT_INFNUM && right->type->primitive == OT_INFNUM)
+    ret = infnum_binop(op, NOB_GET_INFNUM(left), NOB_GET_INFNUM(right));
+  else if (left->type->primitive == OT_LIST)
+    ret = list_binop(op, left, right);
+  else if (left->type->primitive == OT_STRING)
+    ret = str_binop(op, left, right);
+
+  if (ret == NULL)
+    binop_error(op, left, right);
+
+  return ret;
+  /* }}} */
+}
+
+/*
+ * Returns the operation the compound assignment <op> does before assigning
+ * (ie. BINARY_ADD given BINARY_ASSIGN_ADD), or BINARY_ASSIGN for a plain one.
+ */
+static enum binop_type assign_op(enum binop_type op)
+{
+  /* {{{ */
+  switch (op){
+    case BINARY_ASSIGN_ADD: return BINARY_ADD;
+    case BINARY_ASSIGN_SUB: return BINARY_SUB;
+    case BINARY_ASSIGN_MUL: return BINARY_MUL;
+    case BINARY_ASSIGN_DIV: return BINARY_DIV;
+    case BINARY_ASSIGN_MOD: return BINARY_MOD;
+    case BINARY_ASSIGN_AND: return BINARY_BITAND;
+    case BINARY_ASSIGN_XOR: return BINARY_BITXOR;
+    case BINARY_ASSIGN_OR:  return BINARY_BITOR;
+    case BINARY_ASSIGN_SHL: return BINARY_SHL;
+    case BINARY_ASSIGN_SHR: return BINARY_SHR;
+    default:                return BINARY_ASSIGN;
+  }
+  /* }}} */
+}
+
+static struct node *exec_assign(struct node *nd)
+{
+  /* {{{ */
+  enum binop_type op = assign_op(nd->in.binop.type);
+  struct node *target = nd->in.binop.left;
+  /* the parser only lets the lvalues through, which are the names, and the
+   * elements of the lists in them (`xs[i] = v` makes <xs> a new version of
+   * the list) */
+  struct node *name = target->type == NT_NAME ? target : target->in.binop.left;
+  unsigned index = 0;
+  struct var *var;
+  Nob **cell;
+  Nob *value;
+
+  assert(name->type == NT_NAME);
+
+  if ((var = var_lookup(name->in.s, name->scope)) == NULL){
+    fprintf(stderr, "variable '%s' not found! runtime!!\n", name->in.s);
+    exit(1);
+  }
+
+  if (target != name)
+    EXEC(target->in.binop.right);
+
+  EXEC(nd->in.binop.right);
+  value = POP();
+  cell = var_cell(var);
+
+  if ((op != BINARY_ASSIGN || target != name) && *cell == NULL){
+    fprintf(stderr, "variable '%s' used before it was initialized! runtime!!\n",
+        name->in.s);
+    exit(1);
+  }
+
+  if (target != name){
+    if ((*cell)->type->primitive != OT_LIST || !is_integral(TOP()))
+      binop_error(BINARY_INDEX, *cell, TOP());
+
+    index = seq_index(*cell, NOB_GET_INT(POP()), false);
+
+    if (op != BINARY_ASSIGN)
+      value = binop_nobs(op, list_get(*cell, index), value);
+
+    set_cell(cell, list_set(*cell, index, value));
+  } else {
+    if (op != BINARY_ASSIGN)
+      value = binop_nobs(op, *cell, value);
+
+    set_cell(cell, value);
+  }
+
+  PUSH(value);
+
+  RETURN_NEXT;
+  /* }}} */
+}
+
+struct node *exec_binop(struct node *nd)
+{
+  /* {{{ */
+  enum binop_type op = nd->in.binop.type;
+  Nob *left, *right;
+
+  debug_ast_exec(nd, "binop ('%s', #%u, #%u)", binop_to_s(op),
+      nd->in.binop.left->id, nd->in.binop.right->id);
+
+  switch (op){
+    case BINARY_COMMA:
+      EXEC(nd->in.binop.left);
+      (void)POP();
+      EXEC(nd->in.binop.right);
+      RETURN_NEXT;
+
+    /* fall through */
+    case BINARY_LOGAND:
+    case BINARY_LOGOR:
+      /* the right operand only gets evaluated if the left one doesn't settle
+       * it already */
+      EXEC(nd->in.binop.left);
+
+      if (nob_is_true(POP()) == (op == BINARY_LOGOR)){
+        PUSH(new_nob(T_INT, op == BINARY_LOGOR));
+        RETURN_NEXT;
+      }
+
+      EXEC(nd->in.binop.right);
+      PUSH(new_nob(T_INT, nob_is_true(POP())));
+      RETURN_NEXT;
+
+    /* fall through */
+    case BINARY_ASSIGN:
+    case BINARY_ASSIGN_ADD:
+    case BINARY_ASSIGN_SUB:
+    case BINARY_ASSIGN_MUL:
+    case BINARY_ASSIGN_DIV:
+    case BINARY_ASSIGN_MOD:
+    case BINARY_ASSIGN_AND:
+    case BINARY_ASSIGN_XOR:
+    case BINARY_ASSIGN_OR:
+    case BINARY_ASSIGN_SHL:
+    case BINARY_ASSIGN_SHR:
+      return exec_assign(nd);
+
+    default:
+      break;
+  }
+
+  EXEC(nd->in.binop.left);
+  EXEC(nd->in.binop.right);
+
+  right = POP();
+  left  = POP();
+
+  PUSH(binop_nobs(op, left, right));
+
+  RETURN_NEXT;
+  /* }}} */
+}
+/* }}} */
+
+/* {{{ quickened binary operations */
+/*
+ * The handlers `quicken` puts in place of `exec_binop`, once the types of both
+ * of the operands are known (after the inference): they neither look at the
+ * operands' types nor at the operator.
+ */
+#define QUICK_BINOP(name, ctype, get, result)      \
+static struct node *exec_##name(struct node *nd)   \
+{                                                  \
+  ctype a, b;                                      \
+                                                   \
+  EXEC(nd->in.binop.left);                         \
+  EXEC(nd->in.binop.right);                        \
+                                                   \
+  b = get(POP());                                  \
+  a = get(POP());                                  \
+                                                   \
+  PUSH(result);                                    \
+                                                   \
+  RETURN_NEXT;                                     \
+}
+
+#define QUICK_INT(name, expr)  QUICK_BINOP(int_##name, uint32_t, NOB_GET_INT, new_nob(T_INT, (int32_t)(expr)))
+#define QUICK_REAL(name, expr) QUICK_BINOP(real_##name, double, NOB_GET_REAL, new_nob(T_REAL, (double)(expr)))
+#define QUICK_CMP(type, name, ctype, get, expr) \
+  QUICK_BINOP(type##_##name, ctype, get, new_nob(T_INT, (int32_t)(expr)))
+
+QUICK_INT(add,    a + b)
+QUICK_INT(sub,    a - b)
+QUICK_INT(mul,    a * b)
+QUICK_INT(shl,    a << (b & 0x1f))
+QUICK_INT(shr,    a >> (b & 0x1f))
+QUICK_INT(bitand, a & b)
+QUICK_INT(bitxor, a ^ b)
+QUICK_INT(bitor,  a | b)
+QUICK_CMP(int, gt, int32_t, NOB_GET_INT, a >  b)
+QUICK_CMP(int, lt, int32_t, NOB_GET_INT, a <  b)
+QUICK_CMP(int, ge, int32_t, NOB_GET_INT, a >= b)
+QUICK_CMP(int, le, int32_t, NOB_GET_INT, a <= b)
+QUICK_CMP(int, eq, int32_t, NOB_GET_INT, a == b)
+QUICK_CMP(int, ne, int32_t, NOB_GET_INT, a != b)
+
+QUICK_REAL(add, a + b)
+QUICK_REAL(sub, a - b)
+QUICK_REAL(mul, a * b)
+QUICK_REAL(div, a / b)
+QUICK_CMP(real, gt, double, NOB_GET_REAL, a >  b)
+QUICK_CMP(real, lt, double, NOB_GET_REAL, a <  b)
+QUICK_CMP(real, ge, double, NOB_GET_REAL, a >= b)
+QUICK_CMP(real, le, double, NOB_GET_REAL, a <= b)
+QUICK_CMP(real, eq, double, NOB_GET_REAL, a == b)
+QUICK_CMP(real, ne, double, NOB_GET_REAL, a != b)
+
+QUICK_CMP(infnum, gt, struct infnum, NOB_GET_INFNUM, infnum_cmp(a, b) == INFNUM_CMP_GT)
+QUICK_CMP(infnum, lt, struct infnum, NOB_GET_INFNUM, infnum_cmp(a, b) == INFNUM_CMP_LT)
+QUICK_CMP(infnum, ge, struct infnum, NOB_GET_INFNUM, infnum_cmp(a, b) != INFNUM_CMP_LT)
+QUICK_CMP(infnum, le, struct infnum, NOB_GET_INFNUM, infnum_cmp(a, b) != INFNUM_CMP_GT)
+QUICK_CMP(infnum, eq, struct infnum, NOB_GET_INFNUM, infnum_cmp(a, b) == INFNUM_CMP_EQ)
+QUICK_CMP(infnum, ne, struct infnum, NOB_GET_INFNUM, infnum_cmp(a, b) != INFNUM_CMP_EQ)
+
+#undef QUICK_CMP
+#undef QUICK_REAL
+#undef QUICK_INT
+#undef QUICK_BINOP
+
+/* the division can blow up, so it's not that quick */
+static struct node *exec_int_divmod(struct node *nd)
+{
+  /* {{{ */
+  int32_t a, b;
+
+  EXEC(nd->in.binop.left);
+  EXEC(nd->in.binop.right);
+
+  b = NOB_GET_INT(POP());
+  a = NOB_GET_INT(POP());
+
+  PUSH(int_binop(nd->in.binop.type, a, b));
+
+  RETURN_NEXT;
+  /* }}} */
+}
+
+static const execf_t quick_int[] = {
+  [BINARY_ADD]    = exec_int_add,
+  [BINARY_SUB]    = exec_int_sub,
+  [BINARY_MUL]    = exec_int_mul,
+  [BINARY_DIV]    = exec_int_divmod,
+  [BINARY_MOD]    = exec_int_divmod,
+  [BINARY_SHL]    = exec_int_shl,
+  [BINARY_SHR]    = exec_int_shr,
+  [BINARY_BITAND] = exec_int_bitand,
+  [BINARY_BITXOR] = exec_int_bitxor,
+  [BINARY_BITOR]  = exec_int_bitor,
+  [BINARY_GT]     = exec_int_gt,
+  [BINARY_LT]     = exec_int_lt,
+  [BINARY_GE]     = exec_int_ge,
+  [BINARY_LE]     = exec_int_le,
+  [BINARY_EQ]     = exec_int_eq,
+  [BINARY_NE]     = exec_int_ne,
+  [BINARY_COMMA]  = NULL
+};
+
+static const execf_t quick_real[] = {
+  [BINARY_ADD]   = exec_real_add,
+  [BINARY_SUB]   = exec_real_sub,
+  [BINARY_MUL]   = exec_real_mul,
+  [BINARY_DIV]   = exec_real_div,
+  [BINARY_GT]    = exec_real_gt,
+  [BINARY_LT]    = exec_real_lt,
+  [BINARY_GE]    = exec_real_ge,
+  [BINARY_LE]    = exec_real_le,
+  [BINARY_EQ]    = exec_real_eq,
+  [BINARY_NE]    = exec_real_ne,
+  [BINARY_COMMA] = NULL
+};
+
+static const execf_t quick_infnum[] = {
+  [BINARY_GT]    = exec_infnum_gt,
+  [BINARY_LT]    = exec_infnum_lt,
+  [BINARY_GE]    = exec_infnum_ge,
+  [BINARY_LE]    = exec_infnum_le,
+  [BINARY_EQ]    = exec_infnum_eq,
+  [BINARY_NE]    = exec_infnum_ne,
+  [BINARY_COMMA] = NULL
+};
+
+void quicken(struct node *nd)
+{
+  /* {{{ */
+  struct nob_type *left, *right;
+  execf_t execf = NULL;
+
+  if (nd->type != NT_BINOP || nd->execf != exec_binop)
+    return;
+
+  if (nd->in.binop.left->result_type == NULL ||
+      nd->in.binop.right->result_type == NULL)
+    return;
+
+  left  = prune(nd->in.binop.left->result_type);
+  right = prune(nd->in.binop.right->result_type);
+
+  /* mixed operands are left to the generic handler, and so are the params of
+   * generic functions (their types stay type variables) */
+  if (left->primitive != right->primitive)
+    return;
+
+  switch (left->primitive){
+    case OT_INT:
+      execf = quick_int[nd->in.binop.type];
+      break;
+    case OT_REAL:
+      execf = quick_real[nd->in.binop.type];
+      break;
+    case OT_INFNUM:
+      execf = quick_infnum[nd->in.binop.type];
+      break;
+    default:
+      break;
+  }
+
+  if (execf != NULL)
+    nd->execf = execf;
+  /* }}} */
+}
+/* }}} */
+
+struct node *exec_ternop(struct node *nd)
+{
+  /* {{{ */
+  Nob *predicate;
+
+  debug_ast_exec(nd, "ternop (#%u, #%u, #%u)", nd->in.ternop.predicate->id,
+      nd->in.ternop.yes->id, nd->in.ternop.no->id);
+
+  EXEC(nd->in.ternop.predicate);
+  predicate = POP();
+
+  if (nob_is_true(predicate)){
+    EXEC(nd->in.ternop.yes);
+  } else {
+    EXEC(nd->in.ternop.no);
+  }
+
+  RETURN_NEXT;
+  /* }}} */
+}
+
+struct node *exec_if(struct node *nd)
+{
+  /* {{{ */
+  Nob *guard;
+
+  if (nd->in.iff.elsee != NULL)
+    debug_ast_exec(nd, "if (#%u, #%u, #%u)",
+      nd->in.iff.guard->id,
+      nd->in.iff.body->id,
+      nd->in.iff.elsee->id);
   else
     debug_ast_exec(nd, "if (#%u, #%u, --)",
       nd->in.iff.guard->id,
@@ -624,9 +1529,9 @@ struct node *exec_if(struct node *nd)
 
   EXEC(nd->in.iff.guard);
 
-  guard = TOP();
+  guard = POP();
 
-  if (guard)
+  if (nob_is_true(guard))
     EXEC(nd->in.iff.body);
   else
     if (nd->in.iff.elsee != NULL)
@@ -636,23 +1541,257 @@ struct node *exec_if(struct node *nd)
   /* }}} */
 }
 
-struct node *exec_fun(struct node *nd)
+/*
+ * Executes the expressions of the given function's body, leaving only the last
+ * one's result on the stack (which effectively makes it the return value).
+ */
+static void exec_body(struct node *fun)
 {
   /* {{{ */
   struct node *e;
 
+  for (e = fun->in.fun.body; e != NULL; e = e->next){
+    EXEC(e);
+
+    if (e->next != NULL)
+      (void)POP();
+  }
+  /* }}} */
+}
+
+/*
+ * Calls the machine code of the <fun> (see jit.c) the same way
+ * `call_saturated` calls the function.
+ */
+static void call_native(struct node *fun, Nob **bound, unsigned nbound)
+{
+  /* {{{ */
+  int64_t args[NM_JIT_MAX_ARGS];
+  Nob **stack = NM_as_curr - (fun->in.fun.arity - nbound);
+  unsigned i;
+
+  for (i = 0; i < nbound; i++)
+    args[i] = NOB_GET_INT(bound[i]);
+
+  for (; i < fun->in.fun.arity; i++)
+    args[i] = NOB_GET_INT(stack[i - nbound]);
+
+  NM_as_curr = stack;
+  PUSH(new_nob(T_INT, fun->in.fun.native(args, NM_jit_stack_limit)));
+  /* }}} */
+}
+
+/*
+ * Calls <fun> with its params bound to the <nbound> arguments of <bound>
+ * followed by the ones at the top of the argument stack, of which there have to
+ * be exactly as many as needed to saturate the function. <env> is the frame the
+ * function was created in.
+ *
+ * The arguments get popped off the stack, and the result gets pushed.
+ *
+ * Calls in tail positions (see `exec_call`) are made here as well, in a loop,
+ * which replaces the frame of the function that made them, so a recursive loop
+ * runs in a constant amount of stack.
+ */
+static void call_saturated(struct node *fun, struct frame *env, Nob **bound,
+    unsigned nbound)
+{
+  /* {{{ */
+  struct frame *caller = NM_fp;
+  char *base = NM_fs_curr;
+  struct frame *frame;
+  Nob **args;
+  unsigned i;
+  /* is it a call in a tail position, made in place of the previous one? */
+  bool back_edge = false;
+
+  for (;;){
+    if (fun->in.fun.body == NULL){
+      /* a type's constructor, which only carries its argument around */
+      if (nbound > 0)
+        PUSH(bound[0]);
+
+      break;
+    }
+
+    /* tiering and fuel don't go together, so with the (default) former on the
+     * latter costs nothing */
+    if (fun->in.fun.native == NULL && NM_tiering.enabled)
+      tier_count(fun, back_edge);
+    else if (NM_fuel.enabled && NM_fuel.left-- == 0)
+      out_of_fuel();
+
+    if (fun->in.fun.native != NULL){
+      call_native(fun, bound, nbound);
+      break;
+    }
+
+    frame = push_frame(fun->scope, env);
+    arg_stack_reserve(fun->in.fun.max_stack);
+    args = NM_as_curr - (fun->in.fun.arity - nbound);
+
+    /* bind the params to the arguments */
+    for (i = 0; i < nbound; i++)
+      frame->slots[fun->in.fun.params[i]->slot] = bound[i];
+
+    for (; i < fun->in.fun.arity; i++)
+      frame->slots[fun->in.fun.params[i]->slot] = args[i - nbound];
+
+    NM_as_curr = args;
+
+    NM_fp = frame;
+
+    /* the arguments are all in the frame by now */
+    SAFE_POINT();
+
+    if (NM_profiling)
+      profile_enter(fun);
+
+    exec_body(fun);
+
+    if (NM_profiling)
+      profile_leave();
+
+    if (NM_tail.fun == NULL)
+      break;
+
+    /* the function ended with a call, make it in place of the function */
+    fun    = NM_tail.fun;
+    env    = NM_tail.env;
+    bound  = NM_tail.bound;
+    nbound = NM_tail.nbound;
+    NM_tail.fun = NULL;
+    back_edge = true;
+
+    /* the frames made since the loop started are of no use anymore, unless
+     * the function about to be called was created in one of them (a block,
+     * for instance), which is where its variables from the outside are */
+    if (!(env && (char *)follow(env) >= base && (char *)follow(env) < NM_fs_curr))
+      NM_fs_curr = base;
+  }
+
+  NM_fp = caller;
+  NM_fs_curr = base;
+  /* }}} */
+}
+
+struct node *exec_fun(struct node *nd)
+{
+  /* {{{ */
+  struct frame *env;
+
   if (nd->in.fun.execute){
     debug_ast_exec(nd, "executing a function");
+    call_saturated(nd, frame_of(nd->scope->parent), NULL, 0);
+  } else {
+    debug_ast_exec(nd, "function (%u params)", nd->in.fun.arity);
+    /* the closure is likely to outlive the frame it's created in */
+    env = capture_frame(frame_of(nd->scope->parent));
+    PUSH(new_nob(nd->result_type, nd, env, 0, NULL));
+  }
 
-    for (e = nd->in.fun.body; e != NULL; e = e->next){
-      EXEC(e);
+  RETURN_NEXT;
+  /* }}} */
+}
 
-      /* leave only the last expression on the stack */
-      /* which effectively makes it the function's return value */
-      if (e->next != NULL)
-        POP();
-    }
+/* turns the <n> elements of the argument stack from its <i>th one around */
+static void arg_stack_reverse(ptrdiff_t i, unsigned n)
+{
+  /* {{{ */
+  Nob **from = NM_as + i, **to = NM_as + i + n, *tmp;
+
+  while (from < --to){
+    tmp = *from;
+    *from++ = *to;
+    *to = tmp;
+  }
+  /* }}} */
+}
+
+/* moves the last <k> of the <n> elements of the argument stack from its <i>th
+ * one in front of the others */
+static void arg_stack_rotate(ptrdiff_t i, unsigned n, unsigned k)
+{
+  arg_stack_reverse(i, n);
+  arg_stack_reverse(i, k);
+  arg_stack_reverse(i + k, n - k);
+}
+
+/*
+ * Applies the function which is <argc> elements below the top of the argument
+ * stack to the arguments above it, and replaces them all with the result.
+ *
+ * If there aren't enough arguments to saturate the function, the result is
+ * a partial application of it. If there are too many, whatever the function
+ * returns gets applied to the rest of them.
+ */
+static void apply(unsigned argc)
+{
+  /* {{{ */
+  ptrdiff_t base = (NM_as_curr - NM_as) - argc - 1;
+  Nob *fn = NM_as[base];
+  struct nob_fun *f;
+  unsigned need, surplus;
+
+  assert(fn->type->primitive == OT_FUN);
+
+  f = (struct nob_fun *)fn->ptr;
+  need = f->fun->in.fun.arity - f->argc;
+
+  if (argc < need){
+    /* not enough arguments, remember the ones we've got so far */
+    Nob **all = nmalloc(sizeof(Nob *) * (f->argc + argc));
+
+    if (f->argc > 0)
+      memcpy(all, f->args, sizeof(Nob *) * f->argc);
+
+    memcpy(all + f->argc, NM_as + base + 1, sizeof(Nob *) * argc);
+
+    NM_as_curr = NM_as + base;
+    PUSH(new_nob(fn->type, f->fun, f->env, f->argc + argc, all));
+    nfree(all);
+
+    return;
+  }
+
+  /* move the surplus arguments out of the way (below the function), as the
+   * call is going to use the stack above the arguments it takes; they stay on
+   * the stack, so nothing's lost if the call never returns (see
+   * `out_of_fuel`) */
+  surplus = argc - need;
+
+  if (surplus > 0)
+    arg_stack_rotate(base, argc + 1, surplus);
+
+  call_saturated(f->fun, f->env, f->args, f->argc);
+
+  /* the result replaces the function */
+  NM_as[base + surplus] = POP();
+
+  if (surplus > 0){
+    /* and goes back in front of the surplus, to be applied to them */
+    arg_stack_rotate(base, surplus + 1, 1);
+    apply(surplus);
   }
+  /* }}} */
+}
+
+/*
+ * A saturated call to a known function which got compiled (`exec_call` swaps
+ * itself for it once it notices).
+ */
+static struct node *exec_call_native(struct node *nd)
+{
+  /* {{{ */
+  struct nodes_list *arg;
+
+  debug_ast_exec(nd, "native call (#%u, %u args)", NDID(nd->in.call.known),
+      nd->in.call.argc);
+
+  for (arg = nd->in.call.args; arg != NULL; arg = arg->next)
+    EXEC(arg->node);
+
+  call_native(nd->in.call.known, NULL, 0);
 
   RETURN_NEXT;
   /* }}} */
@@ -661,7 +1800,65 @@ struct node *exec_fun(struct node *nd)
 struct node *exec_call(struct node *nd)
 {
   /* {{{ */
-  debug_ast_exec(nd, "function call (not yet implemented)");
+  struct node *known = nd->in.call.known;
+  struct nodes_list *arg;
+  struct nob_fun *f;
+  ptrdiff_t base;
+
+  debug_ast_exec(nd, "function %scall (#%u, %u args)", nd->in.call.tail ?
+      "tail " : "", NDID(nd->in.call.fun), nd->in.call.argc);
+
+  if (known && known->in.fun.arity == nd->in.call.argc){
+    /* a saturated call to a known function, there's no need to create
+     * a function object just to throw it away */
+    for (arg = nd->in.call.args; arg != NULL; arg = arg->next)
+      EXEC(arg->node);
+
+    if (known->in.fun.native != NULL){
+      /* the call can go straight to the machine code from now on */
+      if (nd->execf == exec_call)
+        nd->execf = exec_call_native;
+
+      call_native(known, NULL, 0);
+      RETURN_NEXT;
+    }
+
+    if (nd->in.call.tail){
+      /* leave it for the enclosing function's `call_saturated` */
+      NM_tail.fun = known;
+      NM_tail.env = frame_of(known->scope->parent);
+      NM_tail.bound = NULL;
+      NM_tail.nbound = 0;
+    } else {
+      call_saturated(known, frame_of(known->scope->parent), NULL, 0);
+    }
+
+    RETURN_NEXT;
+  }
+
+  base = NM_as_curr - NM_as;
+
+  EXEC(nd->in.call.fun);
+
+  for (arg = nd->in.call.args; arg != NULL; arg = arg->next)
+    EXEC(arg->node);
+
+  f = (struct nob_fun *)NM_as[base]->ptr;
+
+  if (nd->in.call.tail &&
+      f->fun->in.fun.arity - f->argc == nd->in.call.argc){
+    /* a saturated call in a tail position; the function object is of no use
+     * anymore, only the arguments above it are */
+    memmove(NM_as + base, NM_as + base + 1, sizeof(Nob *) * nd->in.call.argc);
+    NM_as_curr--;
+
+    NM_tail.fun = f->fun;
+    NM_tail.env = f->env;
+    NM_tail.bound = f->args;
+    NM_tail.nbound = f->argc;
+  } else {
+    apply(nd->in.call.argc);
+  }
 
   RETURN_NEXT;
   /* }}} */
@@ -689,20 +1886,58 @@ void print_nob(Nob *ob)
       printf("%g", NOB_GET_REAL(ob));
       break;
     case OT_TUPLE:
-      printf("(");
+    {
+      struct nob_tuple *tuple = NOB_GET_TUPLE(ob);
+      unsigned char *kinds = NOB_TUPLE_KINDS(tuple);
+      unsigned i;
 
-      for (struct nobs_list *p = (struct nobs_list *)ob->ptr; p != NULL; p = p->next){
-        print_nob(p->nob);
+      printf("(");
 
-        if (p->next != NULL)
+      for (i = 0; i < tuple->length; i++){
+        if (i > 0)
           printf(", ");
+
+        switch (kinds[i]){
+          case OT_INT:
+            printf("%d", tuple->elems[i].i);
+            break;
+          case OT_CHAR:
+            printf("%lc", tuple->elems[i].c);
+            break;
+          case OT_REAL:
+            printf("%g", tuple->elems[i].f);
+            break;
+          default:
+            print_nob(tuple->elems[i].nob);
+            break;
+        }
       }
 
       printf(")");
       break;
+    }
+    case OT_LIST:
+    {
+      unsigned length = list_length(ob), i;
+
+      printf("[");
+
+      for (i = 0; i < length; i++){
+        if (i > 0)
+          printf(", ");
+
+        print_nob(list_get(ob, i));
+      }
+
+      printf("]");
+      break;
+    }
 
-    /* fall through */
     case OT_STRING:
+      str_print(ob, stdout);
+      break;
+
+    /* fall through */
     case OT_FUN:
     case OT_TYPE_VARIABLE:
     case OT_CUSTOM:
@@ -730,43 +1965,71 @@ struct node *exec_print(struct node *nd)
 }
 /* }}} */
 /* {{{ comp_nodes */
+static void comp_fun_body(struct node *nd);
+
 void comp_nodes(struct node *node)
 {
-  unsigned vars_size = size_of_vars(node->scope);
+  struct nodes_list *fun;
 
   NM_pc = node;
 
+  /* 4MiB of them is better not made until it's needed */
+  if (NM_ctx->text == NULL){
+    NM_ctx->text  = ncalloc(1, sizeof(struct section));
+    NM_ctx->data  = ncalloc(1, sizeof(struct section));
+    NM_ctx->bss   = ncalloc(1, sizeof(struct section));
+    NM_ctx->funcs = ncalloc(1, sizeof(struct section));
+  }
+
+  convert_closures(node);
+
+  currsect = NM_ctx->bss;
+  out("section .bss");
+  out("_heap: resb %d", NM_CLOSURE_HEAP);
+  currsect = NM_ctx->data;
+  out("section .data");
+  out("_heap_ptr: dd _heap");
+  currsect = NM_ctx->text;
+
   out("section .text");
   out("_kernel:");
   out("  int 0x80");
   out("  ret\n");
+  out("_out_of_memory:");
+  out("  push dword 1");
+  out("  mov eax, 1");
+  out("  call _kernel\n");
   out("global _start");
   out("_start:");
 
-  if (vars_size > 0){
-    out("  push ebp");
-    out("  mov ebp, esp");
-    out("  sub esp, %d", vars_size);
-  }
-
+  /* the global variables are not on the stack (see `comp_decl`) */
   if (NM_pc)
     while (COMP(NM_pc))
       ;
 
-  if (vars_size > 0)
-    out("  leave", vars_size);
-
   out("  push dword eax");
   out("  mov eax, 1");
   out("  call _kernel\n");
 
-  fprintf(outfile, "%s", text.buffer);
-  fprintf(outfile, "%s", funcs.buffer);
-  fprintf(outfile, "%s", bss.buffer);
-  fprintf(outfile, "%s", data.buffer);
+  /* compiling a function's body can queue up the functions it contains */
+  currsect = NM_ctx->funcs;
+
+  while (pending_funs != NULL){
+    fun = pending_funs;
+    pending_funs = fun->next;
+    comp_fun_body(fun->node);
+    nfree(fun);
+  }
+
+  currsect = NM_ctx->text;
+
+  fprintf(NM_ctx->outfile, "%s", NM_ctx->text->buffer);
+  fprintf(NM_ctx->outfile, "%s", NM_ctx->funcs->buffer);
+  fprintf(NM_ctx->outfile, "%s", NM_ctx->bss->buffer);
+  fprintf(NM_ctx->outfile, "%s", NM_ctx->data->buffer);
 
   /* suck it Emacs (: */
-  fprintf(outfile, "; vim: ft=nasm:ts=2:sw=2 expandtab\n\n");
+  fprintf(NM_ctx->outfile, "; vim: ft=nasm:ts=2:sw=2 expandtab\n\n");
 }
 
 struct node *comp_nop(struct node *nd)
@@ -807,27 +2070,107 @@ struct node *comp_tuple(struct node *nd)
   /* }}} */
 }
 
+struct node *comp_list(struct node *nd)
+{
+  /* {{{ */
+  printf("lists not yet implemented\n");
+
+  RETURN_NEXT;
+  /* }}} */
+}
+
+/*
+ * Writes the label of the function <fun> into the <buf>, and returns it.
+ *
+ * The functions declared in the global scope are labeled by their name, the
+ * rest get the node's id added, as the nested ones can share their names.
+ */
+static char *fun_label(struct node *fun, char *buf, size_t size)
+{
+  /* {{{ */
+  if (fun->in.fun.name == NULL)
+    snprintf(buf, size, "_f%d", NDID(fun));
+  else if (fun->scope == NULL || fun->scope->parent == NULL ||
+           fun->scope->parent->parent == NULL)
+    snprintf(buf, size, "%s", fun->in.fun.name);
+  else
+    snprintf(buf, size, "%s_%d", fun->in.fun.name, NDID(fun));
+
+  return buf;
+  /* }}} */
+}
+
+/*
+ * The number of parameters the <fun> gets called with (a lifted function's
+ * free variables come right after the ordinary ones).
+ */
+static unsigned params_of(struct node *fun)
+{
+  /* {{{ */
+  if (fun->in.fun.escapes)
+    return fun->in.fun.arity;
+
+  return fun->in.fun.arity + fun->in.fun.nfree;
+  /* }}} */
+}
+
+/*
+ * Loads the value of the <var> into eax, from wherever it lives in the
+ * function being compiled.
+ */
+static void comp_load(struct var *var)
+{
+  /* {{{ */
+  struct vars_list *v;
+  unsigned idx = 0;
+  char label[128];
+
+  if (var->scope->parent == NULL){
+    out("  mov eax, [v@%s] ; loading %s", var->name, var->name);
+    return;
+  }
+
+  if (currfunc == NULL || var->scope == currfunc->scope){
+    out("  mov eax, [ebp %+d] ; loading %s", var->offset, var->name);
+    return;
+  }
+
+  /* a closure referring to itself (see `add_free`) */
+  if (var->value == currfunc){
+    if (currfunc->in.fun.env)
+      out("  mov eax, [ebp %+d] ; the environment", currfunc->in.fun.env->offset);
+    else
+      out("  mov eax, %s@env", fun_label(currfunc, label, sizeof(label)));
+    return;
+  }
+
+  /* it's a free variable (see closure.c) */
+  for (v = currfunc->in.fun.free; v != NULL && v->var != var; v = v->next)
+    idx++;
+
+  assert(v != NULL);
+
+  if (currfunc->in.fun.escapes){
+    out("  mov eax, [ebp %+d] ; the environment", currfunc->in.fun.env->offset);
+    out("  mov eax, [eax +%u] ; loading %s", 4 + idx * 4, var->name);
+  } else {
+    out("  mov eax, [ebp +%u] ; loading %s", 8 + (currfunc->in.fun.arity + idx) * 4,
+        var->name);
+  }
+  /* }}} */
+}
+
 struct node *comp_name(struct node *nd)
 {
   /* {{{  */
   struct var *var = var_lookup(nd->in.s, nd->scope);
-  char *base;
 
   if (!var){
     fprintf(stderr, "variable '%s' not found! compile time!\n", nd->in.s);
     exit(1);
   }
 
-  if (var->decl != NULL && nd->scope != var->decl->scope){
-    base = "ecx";
-  } else {
-    base = "ebp";
-  }
-
-  if (var->offset == 0)
-    out("  mov eax, [%s] ; loading %s", base, var->name);
-  else
-    out("  mov eax, [%s %+d] ; loading %s", base, var->offset, var->name);
+  comp_load(var);
 
   RETURN_NEXT;
   /* }}} */
@@ -836,22 +2179,31 @@ struct node *comp_name(struct node *nd)
 struct node *comp_decl(struct node *nd)
 {
   /* {{{ */
-  if (nd->in.decl.var->value)
-    debug_ast_comp(nd, "declaration (%s, 0x%02x, #%u)", nd->in.decl.var->name,
-        nd->in.decl.var->flags, nd->in.decl.var->value->id);
+  struct var *var = nd->in.decl.var;
+  struct section *prevsect = currsect;
+
+  if (var->value)
+    debug_ast_comp(nd, "declaration (%s, 0x%02x, #%u)", var->name,
+        var->flags, var->value->id);
   else
-    debug_ast_comp(nd, "declaration (%s, 0x%02x, #--)", nd->in.decl.var->name,
-        nd->in.decl.var->flags);
+    debug_ast_comp(nd, "declaration (%s, 0x%02x, #--)", var->name,
+        var->flags);
 
-  /*printf("var's offset: %u\n", nd->in.decl.var->offset);*/
+  if (var->value)
+    COMP(var->value);
 
-  if (nd->in.decl.var->value)
-    COMP(nd->in.decl.var->value);
+  if (var->scope->parent == NULL){
+    /* the global variables get a fixed place, so the functions can get to
+     * them no matter who called them */
+    currsect = NM_ctx->bss;
+    out("v@%s: resb %u", var->name,
+        var->type && var->type->size > 0 ? var->type->size : 4);
+    currsect = prevsect;
 
-  if (nd->in.decl.var->offset == 0)
-    out("  mov [ebp], eax ; declaring %s", nd->in.decl.var->name);
-  else
-    out("  mov [ebp %+d], eax ; declaring %s", nd->in.decl.var->offset, nd->in.decl.var->name);
+    out("  mov [v@%s], eax ; declaring %s", var->name, var->name);
+  } else {
+    out("  mov [ebp %+d], eax ; declaring %s", var->offset, var->name);
+  }
 
   RETURN_NEXT;
   /* }}} */
@@ -883,33 +2235,237 @@ struct node *comp_unop(struct node *nd)
   /* }}} */
 }
 
+/*
+ * Returns <true> if the node is an integer literal, whose value can be encoded
+ * straight into the instruction as an immediate operand.
+ */
+static bool is_imm(struct node *nd)
+{
+  return nd != NULL && nd->type == NT_INTEGER;
+}
+
+/*
+ * Returns <k> if the <value> is 2^k, or -1 if it's not a power of two at all.
+ */
+static int log2_of(uint32_t value)
+{
+  int k = 0;
+
+  if (value == 0 || (value & (value - 1)) != 0)
+    return -1;
+
+  while ((value >>= 1) != 0)
+    k++;
+
+  return k;
+}
+
+/*
+ * Computes the 'magic' multiplier <M> and the shift amount <s> so that a signed
+ * division of any 32-bit integer by the constant <d> can be performed with
+ * a multiplication and a couple of shifts and adds instead of an `idiv`.
+ *
+ * <d> must not be 0, 1 or -1 (see Hacker's Delight, chapter 10).
+ */
+static void magic_signed(int32_t d, int32_t *M, int *s)
+{
+  /* {{{ */
+  const uint32_t two31 = 0x80000000u;
+  uint32_t ad = d < 0 ? -(uint32_t)d : (uint32_t)d;
+  uint32_t t = two31 + ((uint32_t)d >> 31);
+  uint32_t anc = t - 1 - t % ad; /* absolute value of nc */
+  uint32_t q1, r1, q2, r2, delta;
+  int p = 31;
+
+  q1 = two31 / anc; r1 = two31 - q1 * anc;
+  q2 = two31 / ad;  r2 = two31 - q2 * ad;
+
+  do {
+    p++;
+    q1 = 2 * q1; r1 = 2 * r1;
+    if (r1 >= anc){ q1++; r1 -= anc; }
+    q2 = 2 * q2; r2 = 2 * r2;
+    if (r2 >= ad){ q2++; r2 -= ad; }
+    delta = ad - r2;
+  } while (q1 < delta || (q1 == delta && r1 == 0));
+
+  *M = (int32_t)(q2 + 1);
+  if (d < 0)
+    *M = -*M;
+  *s = p - 32;
+  /* }}} */
+}
+
+/*
+ * Emits the code for eax = eax / <d> (or eax = eax % <d> if <mod> is set),
+ * without the `idiv`, for a constant non-zero divisor.
+ */
+static void comp_div_by_const(int32_t d, bool mod)
+{
+  /* {{{ */
+  uint32_t ad = d < 0 ? -(uint32_t)d : (uint32_t)d;
+  int k = log2_of(ad);
+
+  if (ad == 1){
+    if (mod)
+      out("  xor eax, eax");
+    else if (d < 0)
+      out("  neg eax");
+  } else if (k > 0){
+    /* dividing a signed number by shifting rounds towards negative infinity,
+     * so negative dividends need to be biased by 2^k - 1 beforehand */
+    out("  push edx");
+    out("  cdq");
+    out("  and edx, %u", ad - 1);
+    out("  add eax, edx");
+
+    if (mod){
+      out("  and eax, %u", ad - 1);
+      out("  sub eax, edx");
+    } else {
+      out("  sar eax, %d", k);
+
+      if (d < 0)
+        out("  neg eax");
+    }
+
+    out("  pop edx");
+  } else {
+    int32_t M;
+    int s;
+
+    magic_signed(d, &M, &s);
+
+    out("  push ebx");
+    out("  push edx");
+    out("  mov ebx, eax");
+    out("  mov edx, %d", M);
+    out("  imul edx");
+
+    if (d > 0 && M < 0)
+      out("  add edx, ebx");
+    else if (d < 0 && M > 0)
+      out("  sub edx, ebx");
+
+    if (s > 0)
+      out("  sar edx, %d", s);
+
+    /* add one to negative quotients */
+    out("  mov eax, edx");
+    out("  shr eax, 31");
+    out("  add eax, edx");
+
+    if (mod){
+      out("  imul eax, eax, %d", d);
+      out("  sub ebx, eax");
+      out("  mov eax, ebx");
+    }
+
+    out("  pop edx");
+    out("  pop ebx");
+  }
+  /* }}} */
+}
+
+/*
+ * Emits the code for eax = eax * <m>.
+ */
+static void comp_mul_by_const(int32_t m)
+{
+  /* {{{ */
+  uint32_t am = m < 0 ? -(uint32_t)m : (uint32_t)m;
+  int k = log2_of(am);
+
+  if (m == 0){
+    out("  xor eax, eax");
+  } else if (k >= 0){
+    if (k > 0)
+      out("  shl eax, %d", k);
+
+    if (m < 0)
+      out("  neg eax");
+  } else if (m == 3 || m == 5 || m == 9){
+    out("  lea eax, [eax + eax * %d]", m - 1);
+  } else {
+    out("  imul eax, eax, %d", m);
+  }
+  /* }}} */
+}
+
+/*
+ * Swaps the operands of a comparison (a < b is the same as b > a).
+ */
+static enum binop_type flip_compare(enum binop_type type)
+{
+  switch (type){
+    case BINARY_LT: return BINARY_GT;
+    case BINARY_GT: return BINARY_LT;
+    case BINARY_LE: return BINARY_GE;
+    case BINARY_GE: return BINARY_LE;
+    default:        return type;
+  }
+}
+
 struct node *comp_binop(struct node *nd)
 {
   /* {{{ */
-  Nob *value;
+  enum binop_type type = nd->in.binop.type;
+  struct node *left = nd->in.binop.left;
+  struct node *right = nd->in.binop.right;
+  const char *setcc = NULL;
 
   debug_ast_comp(nd, "binop ('%s', #%u, #%u)", binop_to_s(nd->in.binop.type),
       nd->in.binop.left->id, nd->in.binop.right->id);
 
+  /* make the constant the right operand whenever the operation allows that */
+  if (is_imm(left) && !is_imm(right)){
+    switch (type){
+      case BINARY_ADD:
+      case BINARY_MUL:
+      case BINARY_BITAND:
+      case BINARY_BITXOR:
+      case BINARY_BITOR:
+      case BINARY_EQ:
+      case BINARY_NE:
+      case BINARY_LT:
+      case BINARY_GT:
+      case BINARY_LE:
+      case BINARY_GE:
+        type = flip_compare(type);
+        left = nd->in.binop.right;
+        right = nd->in.binop.left;
+        break;
+      default: /* meh */;
+    }
+  }
+
 #define PRIMITIVE_BINOP(func)   \
-  out("  push ebx");            \
-  COMP(nd->in.binop.right);     \
-  out("  mov ebx, eax");        \
-  COMP(nd->in.binop.left);      \
-  out("  " func " eax, ebx");   \
-  out("  pop ebx\n");
-
-#define PRIMITIVE_COMPARE(func) \
-  out("  push ebx");            \
-  COMP(nd->in.binop.right);     \
-  out("  mov ebx, eax");        \
-  COMP(nd->in.binop.left);      \
-  out("  cmp eax, ebx");        \
-  out("  " func " al");         \
-  out("  movsx eax, al");       \
-  out("  pop ebx\n");
-
-  switch (nd->in.binop.type){
+  if (is_imm(right)){           \
+    COMP(left);                 \
+    out("  " func " eax, %d", right->in.i); \
+  } else {                      \
+    out("  push ebx");          \
+    COMP(right);                \
+    out("  mov ebx, eax");      \
+    COMP(left);                 \
+    out("  " func " eax, ebx"); \
+    out("  pop ebx\n");         \
+  }
+
+#define PRIMITIVE_SHIFT(func)   \
+  if (is_imm(right)){           \
+    COMP(left);                 \
+    out("  " func " eax, %d", right->in.i & 0x1f); \
+  } else {                      \
+    /* the shift count has to be in `cl` */ \
+    COMP(right);                \
+    out("  push eax");          \
+    COMP(left);                 \
+    out("  pop ecx");           \
+    out("  " func " eax, cl\n"); \
+  }
+
+  switch (type){
     case BINARY_ADD:
       PRIMITIVE_BINOP("add");
       break;
@@ -917,26 +2473,31 @@ struct node *comp_binop(struct node *nd)
       PRIMITIVE_BINOP("sub");
       break;
     case BINARY_MUL:
-      PRIMITIVE_BINOP("imul");
+      if (is_imm(right)){
+        COMP(left);
+        comp_mul_by_const(right->in.i);
+      } else {
+        PRIMITIVE_BINOP("imul");
+      }
       break;
     case BINARY_DIV:
-      out("  push edx");
-      out("  xor edx, edx");
-      COMP(nd->in.binop.right);
-      out("  mov ebx, eax");
-      COMP(nd->in.binop.left);
-      out("  idiv ebx");
-      out("  pop edx\n");
-      break;
     case BINARY_MOD:
-      out("  push edx");
-      out("  xor edx, edx");
-      COMP(nd->in.binop.right);
-      out("  mov ebx, eax");
-      COMP(nd->in.binop.left);
-      out("  idiv ebx");
-      out("  mov eax, edx");
-      out("  pop edx\n");
+      if (is_imm(right) && right->in.i != 0){
+        COMP(left);
+        comp_div_by_const(right->in.i, type == BINARY_MOD);
+      } else {
+        out("  push ebx");
+        out("  push edx");
+        COMP(right);
+        out("  mov ebx, eax");
+        COMP(left);
+        out("  cdq");
+        out("  idiv ebx");
+        if (type == BINARY_MOD)
+          out("  mov eax, edx");
+        out("  pop edx");
+        out("  pop ebx\n");
+      }
       break;
     case BINARY_BITAND:
       PRIMITIVE_BINOP("and");
@@ -947,37 +2508,17 @@ struct node *comp_binop(struct node *nd)
     case BINARY_BITOR:
       PRIMITIVE_BINOP("or");
       break;
-    case BINARY_EQ:
-      PRIMITIVE_COMPARE("sete");
-      break;
-    case BINARY_NE:
-      PRIMITIVE_COMPARE("setne");
-      break;
-    case BINARY_LT:
-      PRIMITIVE_COMPARE("setl");
-      break;
-    case BINARY_LE:
-      PRIMITIVE_COMPARE("setle");
-      break;
-    case BINARY_GT:
-      PRIMITIVE_COMPARE("setg");
-      break;
-    case BINARY_GE:
-      PRIMITIVE_COMPARE("setge");
-      break;
+    case BINARY_EQ: setcc = "sete";  break;
+    case BINARY_NE: setcc = "setne"; break;
+    case BINARY_LT: setcc = "setl";  break;
+    case BINARY_LE: setcc = "setle"; break;
+    case BINARY_GT: setcc = "setg";  break;
+    case BINARY_GE: setcc = "setge"; break;
     case BINARY_SHL:
-      COMP(nd->in.binop.right);
-      value = POP();
-      COMP(nd->in.binop.left);
-      /* MIN(255, ...) because `shl` and `shr` accept either the `cl` register
-       * or a __8-bit value__ */
-      out("  shl eax, %d", MIN(0xff, NOB_GET_INT(value)));
+      PRIMITIVE_SHIFT("shl");
       break;
     case BINARY_SHR:
-      COMP(nd->in.binop.right);
-      value = POP();
-      COMP(nd->in.binop.left);
-      out("  shr eax, %d", MIN(0xff, NOB_GET_INT(value)));
+      PRIMITIVE_SHIFT("shr");
       break;
 
     /* fall through */
@@ -994,6 +2535,26 @@ struct node *comp_binop(struct node *nd)
     default: /* meh */;
   }
 
+  if (setcc){
+    if (is_imm(right)){
+      COMP(left);
+      out("  cmp eax, %d", right->in.i);
+    } else {
+      out("  push ebx");
+      COMP(right);
+      out("  mov ebx, eax");
+      COMP(left);
+      out("  cmp eax, ebx");
+      out("  pop ebx");
+    }
+
+    out("  %s al", setcc);
+    out("  movsx eax, al\n");
+  }
+
+#undef PRIMITIVE_BINOP
+#undef PRIMITIVE_SHIFT
+
   RETURN_NEXT;
   /* }}} */
 }
@@ -1037,129 +2598,279 @@ struct node *comp_if(struct node *nd)
   /* }}} */
 }
 
-struct node *comp_fun(struct node *nd)
+/*
+ * Queues up the <fun>'s body to be compiled (once the code it's in is done).
+ */
+static void defer_fun(struct node *fun)
 {
   /* {{{ */
-  struct node *expr;
-  unsigned vars_size = size_of_vars(nd->scope);
+  struct nodes_list *new;
 
-  debug_ast_comp(nd, "function");
+  if (fun->in.fun.compiled || fun->in.fun.body == NULL)
+    return;
 
-  /* a buffer for the functions */
-  struct node *functions[64] = { NULL };
-  struct node **currfun = functions;
-  struct node **fun;
+  fun->in.fun.compiled = true;
 
-  /*if (nd->in.fun.name)*/
-    /*printf("function's %s scope is %s, %p\n", nd->in.fun.name, nd->scope->name, (void*)nd->scope);*/
-  /*else*/
-    /*printf("function's _f%d scope is %s, %p\n", NDID(nd), nd->scope->name, (void*)nd->scope);*/
+  new = nmalloc(sizeof(struct nodes_list));
+  new->node = fun;
+  new->next = pending_funs;
+  pending_funs = new;
+  /* }}} */
+}
 
-  /*printf("size of vars: %u\n", vars_size);*/
+static void comp_fun_body(struct node *nd)
+{
+  /* {{{ */
+  struct node *prevfunc = currfunc;
+  struct node *expr;
+  unsigned vars_size;
+  char label[128];
 
-  if (!nd->in.fun.compiled){
-    currsect = &funcs;
-    nd->in.fun.compiled = true;
+  /* a closure keeps its environment record (passed in ecx) with the rest of
+   * the locals, as ecx gets clobbered by the first call it makes */
+  if (nd->in.fun.escapes && nd->in.fun.nfree > 0 && nd->in.fun.env == NULL)
+    nd->in.fun.env = new_var("$env", 0, NULL, NULL, nd->scope, false, 0);
 
-    /* print out the function's name (or a generated handle for anonymous) */
-    if (nd->in.fun.name)
-      out("%s:", nd->in.fun.name);
-    else
-      out("_f%d:", NDID(nd));
+  vars_size = layout_frame(nd);
+  currfunc = nd;
 
-    /* set up the stack frame for the function */
-    out("  push ebp");
-    out("  mov ebp, esp");
+  out("%s:", fun_label(nd, label, sizeof(label)));
 
-    if (vars_size > 0){
-      out("  sub esp, %d", vars_size);
-    }
+  /* set up the stack frame for the function */
+  out("  push ebp");
+  out("  mov ebp, esp");
 
-    for (expr = nd->in.fun.body; expr != NULL; expr = expr->next){
-      /* if the expression in the function's body is also a function we have to
-       * wait with it a bit and write it to the assembly file after with dealt
-       * with the current function */
-      if (expr->type == NT_FUN){
-        /* TODO: FIXME: check for overflow */
-        *(currfun++) = expr;
-
-        /* emit the "mov eax, funname" without compiling the whole body right
-         * here */
-        expr->in.fun.compiled = true;
-        /* compile the body */
-        COMP(expr);
-        expr->in.fun.compiled = false;
-
-      } else if (expr->type == NT_CALL){
-        /* TODO: FIXME: check for overflow */
-        *(currfun++) = expr->in.call.fun;
-        /* set this to true so that the body of the function doesn't get
-         * written in the midway */
-        expr->in.call.fun->in.fun.compiled = true;
-        /* we call this because we need the `call` to the function */
-        COMP(expr);
-        /* set this to false again so at the end of this function the body gets
-         * generated */
-        expr->in.call.fun->in.fun.compiled = false;
-      } else {
-        COMP(expr);
+  if (vars_size > 0)
+    out("  sub esp, %d", vars_size);
 
-        /* leave only the last expression on the stack */
-        /* which effectively makes it the function's return value */
-        /* NOTE: hmmmm... is that right here? */
-        if (expr->next != NULL)
-          POP();
-      }
-    }
+  if (nd->in.fun.env)
+    out("  mov [ebp %+d], ecx ; the environment", nd->in.fun.env->offset);
 
-    out("  leave");
-    out("  ret\n");
+  /* the result of the last expression is left in eax, which effectively makes
+   * it the function's return value (there's nothing to pop here, constant
+   * operands for instance don't get compiled on their own) */
+  for (expr = nd->in.fun.body; expr != NULL; expr = expr->next)
+    COMP(expr);
 
-    currsect = &text;
+  out("  leave");
+  out("  ret\n");
+
+  /* the one environment record all the uses of the function share */
+  if (nd->in.fun.escapes && nd->in.fun.nfree == 0){
+    currsect = NM_ctx->data;
+    out("%s@env: dd %s", label, label);
+    currsect = NM_ctx->funcs;
   }
 
-  /* compile all the functions that were defined/declared inside of the current
-   * one */
-  for (fun = functions; *fun != NULL; fun++)
-    COMP(*fun);
+  currfunc = prevfunc;
+  /* }}} */
+}
+
+struct node *comp_fun(struct node *nd)
+{
+  /* {{{ */
+  struct vars_list *v;
+  unsigned i;
+  char label[128];
+
+  debug_ast_comp(nd, "function");
 
-  if (nd->in.fun.name)
-    out("  mov eax, %s", nd->in.fun.name);
-  else
-    out("  mov eax, _f%d", NDID(nd));
+  defer_fun(nd);
+  fun_label(nd, label, sizeof(label));
+
+  if (!nd->in.fun.escapes){
+    /* it only ever gets called directly, so its value doesn't matter */
+    out("  mov eax, %s", label);
+  } else if (nd->in.fun.nfree == 0){
+    out("  mov eax, %s@env", label);
+  } else {
+    /* a fresh record with the current values of the free variables */
+    out("  push ebx");
+    out("  mov ebx, [_heap_ptr]");
+    out("  add dword [_heap_ptr], %u", 4 + nd->in.fun.nfree * 4);
+    out("  cmp dword [_heap_ptr], _heap + %d", NM_CLOSURE_HEAP);
+    out("  ja _out_of_memory");
+    out("  mov dword [ebx], %s", label);
+
+    for (v = nd->in.fun.free, i = 0; v != NULL; v = v->next, i++){
+      comp_load(v->var);
+      out("  mov [ebx +%u], eax", 4 + i * 4);
+    }
+
+    out("  mov eax, ebx");
+    out("  pop ebx");
+  }
 
   RETURN_NEXT;
   /* }}} */
 }
 
+/*
+ * Pushes the given arguments, last one first (so that %1 ends up right above
+ * the return address), and returns how many bytes they take on the stack.
+ */
+static unsigned comp_push_args(struct nodes_list *arg)
+{
+  /* {{{ */
+  unsigned size;
+
+  if (arg == NULL)
+    return 0;
+
+  size = comp_push_args(arg->next);
+
+  COMP(arg->node);
+  out("  push eax");
+
+  /* every param is 4 bytes wide (see `new_var`) */
+  return size + 4;
+  /* }}} */
+}
+
+/*
+ * Pushes the free variables a lifted function takes after its arguments (so
+ * before them), and returns how many bytes they take on the stack.
+ */
+static unsigned comp_push_free(struct vars_list *v)
+{
+  /* {{{ */
+  unsigned size;
+
+  if (v == NULL)
+    return 0;
+
+  size = comp_push_free(v->next);
+
+  comp_load(v->var);
+  out("  push eax");
+
+  return size + 4;
+  /* }}} */
+}
+
 struct node *comp_call(struct node *nd)
 {
   /* {{{ */
-  unsigned args_size = 0;
+  struct node *known = nd->in.call.known;
+  struct node *direct = direct_call(nd);
+  /* does the callee take its free variables as arguments? (if not, it gets
+   * its environment record in ecx) */
+  bool lifted = direct != NULL && !direct->in.fun.escapes;
+  struct nodes_list *arg, *surplus = NULL;
+  unsigned args_size, surplus_size = 0;
+  unsigned i, nparams;
+  char label[128];
 
   assert(nd->in.call.fun);
 
-  debug_ast_comp(nd, "compiling a function call (#%u)", NDID(nd->in.call.fun));
+  debug_ast_comp(nd, "compiling a function call (#%u, %u args)",
+      NDID(nd->in.call.fun), nd->in.call.argc);
+
+  if (direct){
+    fun_label(direct, label, sizeof(label));
+    /* a lambda that's called right away doesn't get compiled on its own */
+    if (nd->in.call.fun->type == NT_FUN)
+      defer_fun(nd->in.call.fun);
+  }
+
+  nparams = nd->in.call.argc + (lifted ? direct->in.fun.nfree : 0);
+
+  /* a call in a tail position reuses the caller's frame; the arguments are
+   * written over the function's own (so there can't be more of them) and the
+   * callee returns straight to whoever called the function */
+  if (nd->in.call.tail && currfunc != NULL &&
+      nparams <= params_of(currfunc) &&
+      (known == NULL || known->in.fun.arity == nd->in.call.argc)){
+    if (lifted && nparams == 1 && nd->in.call.argc == 1){
+      COMP(nd->in.call.args->node);
+      out("  mov [ebp +8], eax");
+    } else {
+      /* all of them have to be evaluated before any param is overwritten, the
+       * environment record included */
+      if (!lifted){
+        COMP(nd->in.call.fun);
+        out("  push eax");
+      }
+
+      if (lifted)
+        comp_push_free(direct->in.fun.free);
 
-  if (nd->in.call.arg){
-    args_size += nd->in.call.arg->result_type->size;
+      comp_push_args(nd->in.call.args);
 
-    COMP(nd->in.call.arg);
-    out("  push eax");
+      for (i = 0; i < nparams; i++){
+        out("  pop eax");
+        out("  mov [ebp +%u], eax", 8 + i * 4);
+      }
+
+      if (!lifted)
+        out("  pop ecx");
+    }
+
+    out("  leave");
+
+    if (direct)
+      out("  jmp %s ; tail call", label);
+    else
+      out("  jmp [ecx] ; tail call");
+
+    RETURN_NEXT;
   }
 
-  COMP(nd->in.call.fun);
+  if (known && nd->in.call.argc < known->in.fun.arity){
+    fprintf(stderr, "partial application (%u of %u arguments) is not"
+        " supported when compiling!\n", nd->in.call.argc, known->in.fun.arity);
+    exit(1);
+  }
+
+  /* the arguments the function doesn't take get applied to whatever it
+   * returns; they're pushed first so they are already in place for that call */
+  if (known && nd->in.call.argc > known->in.fun.arity){
+    for (arg = nd->in.call.args, i = 1; i < known->in.fun.arity; i++)
+      arg = arg->next;
+
+    if (known->in.fun.arity == 0){
+      surplus = nd->in.call.args;
+    } else {
+      surplus = arg->next;
+      /* temporarily cut the list, so only the function's own arguments get
+       * pushed below */
+      arg->next = NULL;
+    }
+
+    surplus_size = comp_push_args(surplus);
+  }
+
+  args_size = lifted ? comp_push_free(direct->in.fun.free) : 0;
+
+  if (!known || known->in.fun.arity > 0)
+    args_size += comp_push_args(nd->in.call.args);
 
-  /* store the current stack frame for the called function to use */
-  out("  lea ecx, [ebp]");
+  if (surplus && known->in.fun.arity > 0)
+    arg->next = surplus;
 
-  /* make the call */
-  out("  call eax");
+  if (lifted){
+    out("  call %s", label);
+  } else {
+    /* the function's value is its environment record */
+    COMP(nd->in.call.fun);
+    out("  mov ecx, eax");
+
+    if (direct)
+      out("  call %s", label);
+    else
+      out("  call [ecx]");
+  }
 
   /* remove arguments from the frame */
   if (args_size > 0)
     out("  add esp, %d", args_size);
 
+  if (surplus_size > 0){
+    out("  mov ecx, eax");
+    out("  call [ecx]");
+    out("  add esp, %d", surplus_size);
+  }
+
   RETURN_NEXT;
   /* }}} */
 }
@@ -1215,6 +2926,20 @@ struct node *new_char(struct parser *parser, struct lexer *lex, nchar_t value)
   /* }}} */
 }
 
+struct node *new_string(struct parser *parser, struct lexer *lex, char *value)
+{
+  /* {{{ */
+  struct node *nd = new_node(parser, lex, NT_STRING, const);
+
+  nd->in.s = strdup(value);
+  nd->result_type = T_STRING;
+
+  debug_ast_new(nd, "string (%s) ", value);
+
+  return nd;
+  /* }}} */
+}
+
 struct node *new_real(struct parser *parser, struct lexer *lex, double value)
 {
   /* {{{ */
@@ -1243,6 +2968,20 @@ struct node *new_tuple(struct parser *parser, struct lexer *lex,
   /* }}} */
 }
 
+struct node *new_list(struct parser *parser, struct lexer *lex,
+    struct nodes_list *elems)
+{
+  /* {{{ */
+  struct node *nd = new_node(parser, lex, NT_LIST, list);
+
+  nd->in.tuple.elems = elems;
+
+  debug_ast_new(nd, "list");
+
+  return nd;
+  /* }}} */
+}
+
 struct node *new_name(struct parser *parser, struct lexer *lex, char *name)
 {
   /* {{{ */
@@ -1335,39 +3074,311 @@ struct node *new_if(struct parser *parser, struct lexer *lex, struct node *guard
   /* }}} */
 }
 
+/*
+ * Marks the calls <nd> ends with (given it's the last expression of
+ * a function's body) as being in a tail position.
+ */
+static void mark_tail_calls(struct node *nd)
+{
+  /* {{{ */
+  if (nd == NULL)
+    return;
+
+  switch (nd->type){
+    case NT_CALL:
+      nd->in.call.tail = true;
+      break;
+    case NT_TERNOP:
+      mark_tail_calls(nd->in.ternop.yes);
+      mark_tail_calls(nd->in.ternop.no);
+      break;
+    case NT_IF:
+      mark_tail_calls(nd->in.iff.body);
+      mark_tail_calls(nd->in.iff.elsee);
+      break;
+    default: /* the rest have some work left after whatever they contain */;
+  }
+  /* }}} */
+}
+
+/*
+ * Returns the most elements executing the <nd> keeps on the argument stack at
+ * once (the node's result included), not counting what the functions it calls
+ * need for their own bodies (they reserve that themselves, see
+ * `call_saturated`).
+ */
+static unsigned stack_depth(struct node *nd)
+{
+  /* {{{ */
+  struct nodes_list *l;
+  unsigned depth = 1;
+  unsigned i;
+
+  if (nd == NULL)
+    return 0;
+
+  switch (nd->type){
+    case NT_TUPLE:
+    case NT_LIST:
+      /* the elements stay on the stack until they're all evaluated */
+      i = 0;
+
+      for (l = nd->in.tuple.elems; l != NULL; l = l->next, i++)
+        depth = MAX(depth, i + stack_depth(l->node));
+      break;
+    case NT_UNOP:
+      depth = MAX(depth, stack_depth(nd->in.unop.target));
+      break;
+    case NT_BINOP:
+      switch (nd->in.binop.type){
+        case BINARY_COMMA:
+        case BINARY_LOGAND:
+        case BINARY_LOGOR:
+          /* the left operand is popped before the right one is evaluated */
+          depth = MAX(depth, stack_depth(nd->in.binop.left));
+          depth = MAX(depth, stack_depth(nd->in.binop.right));
+          break;
+        default:
+          depth = MAX(depth, stack_depth(nd->in.binop.left));
+          depth = MAX(depth, 1 + stack_depth(nd->in.binop.right));
+          break;
+      }
+      break;
+    case NT_TERNOP:
+      depth = MAX(depth, stack_depth(nd->in.ternop.predicate));
+      depth = MAX(depth, stack_depth(nd->in.ternop.yes));
+      depth = MAX(depth, stack_depth(nd->in.ternop.no));
+      break;
+    case NT_IF:
+      depth = MAX(depth, stack_depth(nd->in.iff.guard));
+      depth = MAX(depth, stack_depth(nd->in.iff.body));
+      depth = MAX(depth, stack_depth(nd->in.iff.elsee));
+      break;
+    case NT_WHILE:
+      depth = MAX(depth, stack_depth(nd->in.whilee.guard));
+      depth = MAX(depth, stack_depth(nd->in.whilee.body));
+      depth = MAX(depth, stack_depth(nd->in.whilee.elsee));
+      break;
+    case NT_DECL:
+      depth = MAX(depth, stack_depth(nd->in.decl.var->value));
+      break;
+    case NT_CALL:
+      /* the function object (unless it's known) and the arguments above it */
+      i = nd->in.call.known ? 0 : 1;
+      depth = MAX(depth, stack_depth(nd->in.call.fun));
+
+      for (l = nd->in.call.args; l != NULL; l = l->next, i++)
+        depth = MAX(depth, i + stack_depth(l->node));
+      break;
+    case NT_PRINT:
+      for (l = nd->in.print.exprs; l != NULL; l = l->next)
+        depth = MAX(depth, stack_depth(l->node));
+      break;
+
+    /* fall through */
+    case NT_NOP:
+    case NT_INTEGER:
+    case NT_REAL:
+    case NT_STRING:
+    case NT_CHAR:
+    case NT_NAME:
+    case NT_BLOCK:
+    case NT_FUN:
+    case NT_USE:
+      break;
+  }
+
+  return depth;
+  /* }}} */
+}
+
+/*
+ * Returns the most elements executing the statements starting at <chain>
+ * keeps on the argument stack at once (the result of every one of them is
+ * popped before the next one is executed).
+ */
+unsigned chain_stack_depth(struct node *chain)
+{
+  /* {{{ */
+  unsigned depth = 0;
+
+  for (; chain != NULL; chain = chain->next)
+    depth = MAX(depth, stack_depth(chain));
+
+  return depth;
+  /* }}} */
+}
+
 struct node *new_fun(struct parser *parser, struct lexer *lex, char *name,
-    char *param, struct node *body, char *opts, bool execute)
+    unsigned arity, struct var **params, struct node *body, char *opts,
+    bool execute)
 {
   /* {{{ */
   struct node *nd = new_node(parser, lex, NT_FUN, fun);
+  struct node *last;
 
   nd->in.fun.name = name;
-  nd->in.fun.param = param;
+  nd->in.fun.arity = arity;
+  nd->in.fun.params = params;
   nd->in.fun.body = body;
   nd->in.fun.opts = opts;
   nd->in.fun.execute = execute;
   nd->in.fun.compiled = false;
+  nd->in.fun.max_stack = 0;
+  nd->in.fun.calls = 0;
+  nd->in.fun.loops = 0;
+  nd->in.fun.native = NULL;
+  nd->in.fun.nojit = false;
+  nd->in.fun.rejected = NULL;
+  nd->in.fun.free = NULL;
+  nd->in.fun.nfree = 0;
+  nd->in.fun.escapes = false;
+  nd->in.fun.env = NULL;
+
+  if (body){
+    for (last = body; last->next != NULL; last = last->next)
+      ;
+
+    mark_tail_calls(last);
+  }
+
+  nd->in.fun.max_stack = chain_stack_depth(body);
 
   if (name)
-    debug_ast_new(nd, "fun (%s, #%u, %d)", name, NDID(body), execute);
+    debug_ast_new(nd, "fun (%s, %u, #%u, %d)", name, arity, NDID(body), execute);
   else
-    debug_ast_new(nd, "lambda (#%u, %d)", name, NDID(body), execute);
+    debug_ast_new(nd, "lambda (%u, #%u, %d)", arity, NDID(body), execute);
 
   return nd;
   /* }}} */
 }
 
+/*
+ * Calls <fn> on every (non-NULL) direct child of the node <nd>, and on every
+ * expression in a function's body.
+ *
+ * The <fn> gets the pointer to wherever the child is referenced from, so it
+ * can replace the node with a different one.
+ */
+void for_each_child(struct node *nd, visit_t fn, void *data)
+{
+  /* {{{ */
+  struct nodes_list *l;
+  struct node **e;
+
+#define CHILD(slot) do { if ((slot) != NULL) fn(&(slot), data); } while (0)
+
+  switch (nd->type){
+    case NT_TUPLE:
+    case NT_LIST:
+      for (l = nd->in.tuple.elems; l != NULL; l = l->next)
+        CHILD(l->node);
+      break;
+    case NT_UNOP:
+      CHILD(nd->in.unop.target);
+      break;
+    case NT_BINOP:
+      CHILD(nd->in.binop.left);
+      CHILD(nd->in.binop.right);
+      break;
+    case NT_TERNOP:
+      CHILD(nd->in.ternop.predicate);
+      CHILD(nd->in.ternop.yes);
+      CHILD(nd->in.ternop.no);
+      break;
+    case NT_IF:
+      CHILD(nd->in.iff.guard);
+      CHILD(nd->in.iff.body);
+      CHILD(nd->in.iff.elsee);
+      break;
+    case NT_WHILE:
+      CHILD(nd->in.whilee.guard);
+      CHILD(nd->in.whilee.body);
+      CHILD(nd->in.whilee.elsee);
+      break;
+    case NT_DECL:
+      CHILD(nd->in.decl.var->value);
+      break;
+    case NT_CALL:
+      CHILD(nd->in.call.fun);
+      for (l = nd->in.call.args; l != NULL; l = l->next)
+        CHILD(l->node);
+      break;
+    case NT_FUN:
+      for (e = &nd->in.fun.body; *e != NULL; e = &(*e)->next)
+        fn(e, data);
+      break;
+    case NT_PRINT:
+      for (l = nd->in.print.exprs; l != NULL; l = l->next)
+        CHILD(l->node);
+      break;
+
+    /* fall through */
+    case NT_NOP:
+    case NT_INTEGER:
+    case NT_REAL:
+    case NT_STRING:
+    case NT_CHAR:
+    case NT_NAME:
+    case NT_BLOCK:
+    case NT_USE:
+      break;
+  }
+
+#undef CHILD
+  /* }}} */
+}
+
+/*
+ * Returns the function <fun> evaluates to, if that's known before running the
+ * program, NULL otherwise.
+ */
+struct node *known_fun(struct node *fun, struct scope *scope)
+{
+  /* {{{ */
+  struct var *var;
+
+  if (fun->type == NT_FUN)
+    return fun;
+
+  if (fun->type != NT_NAME || scope == NULL)
+    return NULL;
+
+  if ((var = var_lookup(fun->in.s, scope)) == NULL)
+    return NULL;
+
+  /* a mutable variable could have a different function assigned to it by the
+   * time the call happens */
+  if (var->param || (var->flags & NOB_FLAG_MUTABLE))
+    return NULL;
+
+  if (var->value == NULL || var->value->type != NT_FUN)
+    return NULL;
+
+  return var->value;
+  /* }}} */
+}
+
 struct node *new_call(struct parser *parser, struct lexer *lex, struct node *fun,
-    struct node *arg, char *opts)
+    struct nodes_list *args, char *opts)
 {
   /* {{{ */
   struct node *nd = new_node(parser, lex, NT_CALL, call);
+  struct nodes_list *arg;
 
   nd->in.call.fun  = fun;
-  nd->in.call.arg  = arg;
+  nd->in.call.args = args;
+  nd->in.call.argc = 0;
   nd->in.call.opts = opts;
 
-  debug_ast_new(nd, "call (#%d)", NDID(fun));
+  for (arg = args; arg != NULL; arg = arg->next)
+    nd->in.call.argc++;
+
+  nd->in.call.known = known_fun(fun, nd->scope);
+  /* see `mark_tail_calls` */
+  nd->in.call.tail = false;
+
+  debug_ast_new(nd, "call (#%d, %u)", NDID(fun), nd->in.call.argc);
 
   return nd;
   /* }}} */
@@ -1388,6 +3399,43 @@ struct node *new_print(struct parser *parser, struct lexer *lex, struct nodes_li
 }
 /* }}} */
 
+/*
+ * Turns the node <nd> (in place) into an integer constant of the given
+ * <value>. The node keeps its id, scope and place in the execution chain.
+ */
+void node_to_int(struct node *nd, int value)
+{
+  /* {{{ */
+  nd->type = NT_INTEGER;
+  nd->in.i = value;
+  nd->result_type = T_INT;
+  nd->lvalue = false;
+  nd->execf = exec_const;
+  nd->compf = comp_const;
+#if DEBUG
+  nd->dumpf = dump_const;
+#endif
+  /* }}} */
+}
+
+/*
+ * Same as above, but for reals.
+ */
+void node_to_real(struct node *nd, double value)
+{
+  /* {{{ */
+  nd->type = NT_REAL;
+  nd->in.f = value;
+  nd->result_type = T_REAL;
+  nd->lvalue = false;
+  nd->execf = exec_const;
+  nd->compf = comp_const;
+#if DEBUG
+  nd->dumpf = dump_const;
+#endif
+  /* }}} */
+}
+
 /*
  * Modifies a { struct nodes_list } in place by reversing it's order.
  *
@@ -1412,28 +3460,6 @@ struct nodes_list *reverse_nodes_list(struct nodes_list *list)
   return list;
 }
 
-/*
- * *Exactly* the same as above, but on a different type. Thanks C for the type
- * system!
- */
-struct nobs_list *reverse_nobs_list(struct nobs_list *list)
-{
-  struct nobs_list *curr = list,
-                   *prev = NULL,
-                   *next;
-
-  while (curr != NULL){
-    next = curr->next;
-    curr->next = prev;
-    prev = curr;
-    curr = next;
-  }
-
-  list = prev;
-
-  return list;
-}
-
 const char *binop_to_s(enum binop_type type)
 {
   switch (type){
@@ -1464,11 +3490,39 @@ const char *binop_to_s(enum binop_type type)
     case BINARY_ASSIGN_OR:  return "|=";
     case BINARY_ASSIGN_SHL: return "<<=";
     case BINARY_ASSIGN_SHR: return ">>=";
+    case BINARY_INDEX:      return "[]";
+    case BINARY_SLICE:      return "[:]";
     case BINARY_COMMA:      return ",";
     default: return "#unknown#binop_to_s#";
   }
 }
 
+const char *nodetype_to_s(enum node_type type)
+{
+  switch (type){
+    case NT_NOP:     return "nop";
+    case NT_INTEGER: return "integer";
+    case NT_REAL:    return "real";
+    case NT_STRING:  return "string";
+    case NT_CHAR:    return "char";
+    case NT_TUPLE:   return "tuple";
+    case NT_LIST:    return "list";
+    case NT_NAME:    return "name";
+    case NT_UNOP:    return "unop";
+    case NT_BINOP:   return "binop";
+    case NT_TERNOP:  return "ternop";
+    case NT_IF:      return "if";
+    case NT_WHILE:   return "while";
+    case NT_DECL:    return "declaration";
+    case NT_CALL:    return "call";
+    case NT_BLOCK:   return "block";
+    case NT_FUN:     return "fun";
+    case NT_USE:     return "use";
+    case NT_PRINT:   return "print";
+    default: return "#unknown#nodetype_to_s#";
+  }
+}
+
 /*
  * vi: ft=c:ts=2:sw=2:expandtab
  */
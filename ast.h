@@ -15,6 +15,7 @@
 
 #include <stdint.h>
 
+#include "context.h"
 #include "nemo.h"
 #include "nob.h"
 #include "infnum.h"
@@ -40,6 +41,7 @@ enum node_type {
   NT_STRING,
   NT_CHAR,
   NT_TUPLE,
+  NT_LIST,
   NT_NAME,
   NT_UNOP,
   NT_BINOP,
@@ -95,12 +97,19 @@ enum binop_type {
   BINARY_ASSIGN_OR,
   BINARY_ASSIGN_SHL,
   BINARY_ASSIGN_SHR,
+  /* <list>[<index>], and <list>[<from>:<to>] (whose right operand is the
+   * tuple of the two) */
+  BINARY_INDEX,
+  BINARY_SLICE,
   BINARY_COMMA
 };
 
 typedef struct node *(*execf_t)(struct node *);
 typedef struct node *(*compf_t)(struct node *);
 typedef void         (*dumpf_t)(struct node *);
+/* a function compiled into machine code (see jit.c), which gets its integer
+ * arguments in an array, and the lowest address the C stack can grow to */
+typedef int32_t      (*nativef_t)(const int64_t *args, const char *stack_limit);
 
 struct node {
   /* d'uh */
@@ -123,6 +132,8 @@ struct node {
   /* the `id' probably should also be inside #if DEBUG but then it gives
    * compilation errors that I can't nicely resolve, meh */
   unsigned id;
+  /* where the node ends in the source (0 if it wasn't parsed from any) */
+  unsigned line, col;
 #if DEBUG
   /* function which dumps the node (option `-da`) */
   dumpf_t dumpf;
@@ -136,7 +147,7 @@ struct node {
     char   *s; /* NT_STRING */
     nchar_t c; /* NT_CHAR */
 
-    struct { /* NT_TUPLE */
+    struct { /* NT_TUPLE, NT_LIST */
       struct nodes_list *elems;
     } tuple;
 
@@ -158,10 +169,19 @@ struct node {
       struct var *var;
     } decl;
 
-    struct { /* NT_CALL (<name> [opts]()) */
+    struct { /* NT_CALL (<name> [opts](<args>)) */
       char *name;
       struct node *fun;
-      struct node *arg;
+      /* the arguments, in the order they were given (`f(1)(2)` gets uncurried
+       * into `f(1, 2)`) */
+      struct nodes_list *args;
+      unsigned argc;
+      /* the function that's called, if it's known at parse time (ie. <fun> is
+       * a lambda or an immutable variable that holds one), NULL otherwise */
+      struct node *known;
+      /* is it the last thing the enclosing function does? (if so, the call
+       * replaces the function's frame rather than growing the stack) */
+      bool tail;
       char *opts;
     } call;
 
@@ -179,7 +199,10 @@ struct node {
 
     struct { /* NT_FUN (function) */
       char *name;
-      char *param;
+      /* the number of params the function takes (%1 up to %<arity>) */
+      unsigned arity;
+      /* the params themselves, <arity> of them, %1 being the first one */
+      struct var **params;
       struct node *body;
       /* the options the function can take */
       char *opts;
@@ -191,6 +214,29 @@ struct node {
       /* whether the body of the function has already been compiled (written)
        * into the output assembly file (unused when interpreting) */
       bool compiled;
+      /* the most elements the body keeps on the argument stack at once (see
+       * `stack_depth`) */
+      unsigned max_stack;
+      /* how many times the interpreter called the function, and went round
+       * its loops (see tier.c), its machine code once it got compiled (NULL
+       * before that), and whether it turned out it can't be (see jit.c),
+       * along with the node which was the reason (if it was one) */
+      unsigned long calls;
+      unsigned long loops;
+      nativef_t native;
+      bool nojit;
+      struct node *rejected;
+
+      /* the rest is filled in by `convert_closures` (see closure.c) and is
+       * unused when interpreting */
+      /* the variables of the enclosing functions the function uses */
+      struct vars_list *free;
+      unsigned nfree;
+      /* is the function ever used as a value (returned, passed along, kept in
+       * a mutable variable), rather than only being called directly? */
+      bool escapes;
+      /* where a function which escapes keeps the pointer to its environment */
+      struct var *env;
     } fun;
 
     struct { /* NT_PRINT */
@@ -204,12 +250,42 @@ struct nodes_list {
   struct nodes_list *next;
 };
 
+/* the default size of the interpreter's frame stack, in KiB (option `-s`) */
+#define NM_FRAME_STACK_DEFAULT 8192
+/* the size of the compiled program's heap for the closures' environments, in
+ * bytes */
+#define NM_CLOSURE_HEAP (1 << 20)
+
+/*
+ * A function call's frame in the interpreter, which holds the values of the
+ * function's params and local variables (global variables are stored in the
+ * `struct var`s themselves).
+ *
+ * The frames are laid out one after another on a contiguous, preallocated
+ * stack, and are moved to the heap only when a closure gets created in them
+ * (see `capture_frame` in ast.c).
+ */
+struct frame {
+  /* the scope whose variables live in the frame */
+  struct scope *scope;
+  /* the frame of the lexically enclosing function (NULL if it's the global
+   * scope), where the variables from outside of the function are */
+  struct frame *up;
+  /* where the frame was moved to, if it was */
+  struct frame *moved;
+  /* <scope->frame_size> of them */
+  Nob *slots[];
+};
+
 struct node *new_nop(struct parser *parser, struct lexer *lex);
 struct node *new_int(struct parser *parser, struct lexer *lex, int value);
 struct node *new_char(struct parser *parser, struct lexer *lex, nchar_t value);
+struct node *new_string(struct parser *parser, struct lexer *lex, char *value);
 struct node *new_real(struct parser *parser, struct lexer *lex, double value);
 struct node *new_tuple(struct parser *parser, struct lexer *lex,
     struct nodes_list *elems);
+struct node *new_list(struct parser *parser, struct lexer *lex,
+    struct nodes_list *elems);
 struct node *new_decl(struct parser *parser, struct lexer *lex, struct var *v);
 struct node *new_name(struct parser *parser, struct lexer *lex, char *name);
 struct node *new_unop(struct parser *parser, struct lexer *lex,
@@ -221,15 +297,25 @@ struct node *new_ternop(struct parser *parser, struct lexer *lex,
 struct node *new_if(struct parser *parser, struct lexer *lex,
     struct node *guard, struct node *body, struct node *elsee);
 struct node *new_fun(struct parser *parser, struct lexer *lex, char *name,
-    char *param, struct node *body, char *opts, bool execute);
+    unsigned arity, struct var **params, struct node *body, char *opts,
+    bool execute);
 struct node *new_call(struct parser *parser, struct lexer *lex,
-    struct node *fun, struct node *arg, char *opts);
+    struct node *fun, struct nodes_list *args, char *opts);
 struct node *new_print(struct parser *parser, struct lexer *lex,
     struct nodes_list *exprs);
 
-void exec_nodes(struct node *node);
+Nob *exec_nodes(struct node *node, unsigned stack);
+unsigned chain_stack_depth(struct node *chain);
 void comp_nodes(struct node *node);
 
+void node_to_int(struct node *nd, int value);
+void node_to_real(struct node *nd, double value);
+void quicken(struct node *nd);
+
+typedef void (*visit_t)(struct node **slot, void *data);
+void for_each_child(struct node *nd, visit_t fn, void *data);
+struct node *known_fun(struct node *fun, struct scope *scope);
+
 #if DEBUG
 void dump_nodes(struct node *node);
 #else
@@ -238,21 +324,42 @@ void dump_nodes(struct node *node);
 
 void arg_stack_init(void);
 void arg_stack_finish(void);
+void frame_stack_init(size_t size);
+void frame_stack_finish(void);
 
+/* there's always enough room on the stack for whatever a function pushes (see
+ * `arg_stack_reserve`), so only the debug builds check it */
+#if DEBUG
 #define PUSH(i) arg_stack_push(i, __FILE__, __LINE__)
 #define POP() arg_stack_pop(__FILE__, __LINE__)
-#define TOP() arg_stack_top()
 void arg_stack_push(Nob *ob, const char *file, unsigned line);
 Nob *arg_stack_pop(const char *file, unsigned line);
-Nob *arg_stack_top(void);
+#else
+#define PUSH(i) arg_stack_push(i)
+#define POP() arg_stack_pop()
+#endif
+#define TOP() (NM_as_curr[-1])
+#define NM_as_curr (NM_ctx->as_curr)
+
+#if !DEBUG
+static inline void arg_stack_push(Nob *ob)
+{
+  *NM_as_curr++ = ob;
+}
+
+static inline Nob *arg_stack_pop(void)
+{
+  return *--NM_as_curr;
+}
+#endif
 
 const char *binop_to_s(enum binop_type);
+const char *nodetype_to_s(enum node_type);
 
 struct nodes_list *reverse_nodes_list(struct nodes_list *);
-struct nobs_list  *reverse_nobs_list(struct nobs_list *);
 
-/* defined in ast.c */
-extern struct section *currsect;
+/* the assembly section being written to (see `out`) */
+#define currsect (NM_ctx->currsect)
 
 #endif /* AST_H */
 
@@ -0,0 +1,255 @@
+/*
+ *
+ * closure.c
+ *
+ * Created at:  Mon Oct 19 15:40:12 2026 15:40:12
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+/*
+ * Closure conversion (done only when compiling).
+ *
+ * Every function gets the list of the variables it uses which belong to the
+ * functions it's nested in (its free variables), and is marked whether it
+ * escapes, ie. whether it's ever used as a value rather than only being called
+ * directly.
+ *
+ * A function which doesn't escape is lambda lifted: its free variables are
+ * passed to it as additional arguments (right after the ordinary ones), so it
+ * gets called directly like any top-level function.
+ *
+ * A function which escapes evaluates to a flat environment record: the
+ * address of its code followed by the values of its free variables. Calling
+ * it passes the record in `ecx`. The ones which have no free variables share
+ * a single static record, so only those that really need an environment get
+ * one allocated.
+ *
+ * In both cases the variables are captured by value. Global variables are
+ * never free, they have a fixed address.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ast.h"
+#include "closure.h"
+#include "mem.h"
+#include "scope.h"
+
+/* the functions the walk is currently in, the innermost one first */
+struct context {
+  struct node *fun;
+  struct context *up;
+};
+
+/* did the last walk add a free variable to any function? */
+#define changed (NM_ctx->closures_changed)
+
+struct node *direct_call(struct node *call)
+{
+  /* {{{ */
+  struct node *known = call->in.call.known;
+
+  assert(call->type == NT_CALL);
+
+  if (known == NULL || known->in.fun.body == NULL)
+    return NULL;
+
+  /* partial applications create a function object */
+  if (call->in.call.argc < known->in.fun.arity)
+    return NULL;
+
+  if (call->in.call.fun->type != NT_NAME && call->in.call.fun->type != NT_FUN)
+    return NULL;
+
+  return known;
+  /* }}} */
+}
+
+/* {{{ escape analysis */
+static void mark_escaping(struct node **slot, void *data)
+{
+  /* {{{ */
+  struct node *nd = *slot;
+  struct nodes_list *arg;
+  struct var *var;
+
+  switch (nd->type){
+    case NT_CALL:
+      /* a recursive call is parsed before its function is assigned to the
+       * variable, so it only becomes known now */
+      if (nd->in.call.known == NULL)
+        nd->in.call.known = known_fun(nd->in.call.fun, nd->scope);
+
+      if (direct_call(nd) != NULL){
+        /* being called is not using the function as a value */
+        if (nd->in.call.fun->type == NT_FUN)
+          for_each_child(nd->in.call.fun, mark_escaping, data);
+
+        for (arg = nd->in.call.args; arg != NULL; arg = arg->next)
+          mark_escaping(&arg->node, data);
+
+        return;
+      }
+      break;
+
+    case NT_NAME:
+      var = var_lookup(nd->in.s, nd->scope);
+
+      if (var != NULL && !var->param && var->value != NULL &&
+          var->value->type == NT_FUN)
+        var->value->in.fun.escapes = true;
+      return;
+
+    case NT_DECL:
+      /* being assigned to a variable doesn't make a function escape (the
+       * uses of the variable can) */
+      if (nd->in.decl.var->value != NULL &&
+          nd->in.decl.var->value->type == NT_FUN){
+        for_each_child(nd->in.decl.var->value, mark_escaping, data);
+        return;
+      }
+      break;
+
+    case NT_FUN:
+      nd->in.fun.escapes = true;
+      break;
+
+    default:
+      break;
+  }
+
+  for_each_child(nd, mark_escaping, data);
+  /* }}} */
+}
+/* }}} */
+
+/* {{{ free variables */
+/*
+ * Makes the <var> available in the innermost function of the <ctx>, which
+ * means every function between the use and the var's declaration has to have
+ * it as a free variable.
+ */
+static void add_free(struct context *ctx, struct var *var)
+{
+  /* {{{ */
+  struct vars_list **tail;
+
+  /* the global variables are reachable from anywhere */
+  if (var->scope == NULL || var->scope->parent == NULL)
+    return;
+
+  for (; ctx != NULL && ctx->fun->scope != var->scope; ctx = ctx->up){
+    /* a closure which refers to itself already has its record at hand */
+    if (ctx->fun == var->value && ctx->fun->in.fun.escapes)
+      continue;
+
+    for (tail = &ctx->fun->in.fun.free; *tail != NULL; tail = &(*tail)->next)
+      if ((*tail)->var == var)
+        break;
+
+    if (*tail != NULL)
+      continue;
+
+    *tail = nmalloc(sizeof(struct vars_list));
+    (*tail)->var = var;
+    (*tail)->next = NULL;
+    ctx->fun->in.fun.nfree++;
+    changed = true;
+  }
+  /* }}} */
+}
+
+/*
+ * The free variables of the <fun> have to be passed to it (or stored in its
+ * environment record) where the <ctx> is.
+ */
+static void add_free_of(struct context *ctx, struct node *fun)
+{
+  /* {{{ */
+  struct vars_list *v;
+
+  for (v = fun->in.fun.free; v != NULL; v = v->next)
+    add_free(ctx, v->var);
+  /* }}} */
+}
+
+static void find_free(struct node **slot, void *data)
+{
+  /* {{{ */
+  struct context *ctx = data;
+  struct context inner;
+  struct node *nd = *slot;
+  struct node *fun;
+  struct nodes_list *arg;
+  struct var *var;
+
+  switch (nd->type){
+    case NT_NAME:
+      if ((var = var_lookup(nd->in.s, nd->scope)) != NULL)
+        add_free(ctx, var);
+      return;
+
+    case NT_CALL:
+      if ((fun = direct_call(nd)) != NULL && !fun->in.fun.escapes){
+        add_free_of(ctx, fun);
+
+        /* the name of a lifted function is not needed, only its label */
+        if (nd->in.call.fun->type == NT_FUN)
+          find_free(&nd->in.call.fun, ctx);
+
+        for (arg = nd->in.call.args; arg != NULL; arg = arg->next)
+          find_free(&arg->node, ctx);
+
+        return;
+      }
+      break;
+
+    case NT_FUN:
+      inner.fun = nd;
+      inner.up = ctx;
+      for_each_child(nd, find_free, &inner);
+
+      /* the environment record gets filled where the function is */
+      if (nd->in.fun.escapes)
+        add_free_of(ctx, nd);
+      return;
+
+    default:
+      break;
+  }
+
+  for_each_child(nd, find_free, ctx);
+  /* }}} */
+}
+/* }}} */
+
+void convert_closures(struct node *root)
+{
+  /* {{{ */
+  struct node **e;
+
+  for (e = &root; *e != NULL; e = &(*e)->next)
+    mark_escaping(e, NULL);
+
+  /* a call to a lifted function needs all of its free variables, which makes
+   * them free in the caller too; that can change what the functions called
+   * earlier need, so keep at it until nothing new comes up */
+  do {
+    changed = false;
+
+    for (e = &root; *e != NULL; e = &(*e)->next)
+      find_free(e, NULL);
+  } while (changed);
+  /* }}} */
+}
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
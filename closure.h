@@ -0,0 +1,35 @@
+/*
+ *
+ * closure.h
+ *
+ * Created at:  Mon Oct 19 15:40:12 2026 15:40:12
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+#ifndef CLOSURE_H
+#define CLOSURE_H
+
+#include "ast.h"
+
+/*
+ * Finds out the free variables of every function in the program starting at
+ * <root>, and which of the functions escape (see closure.c).
+ */
+void convert_closures(struct node *root);
+
+/*
+ * Returns the function the <call> jumps straight into (by its label), or NULL
+ * if it has to go through whatever the callee evaluates to at run time.
+ */
+struct node *direct_call(struct node *call);
+
+#endif /* CLOSURE_H */
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
@@ -0,0 +1,31 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+/* the -DDEBUG flag */
+/* #undef DEBUG */
+/* the small allocations come from nemo's own pools (see alloc.h) */
+#define POOL_ALLOC     1
+/* directory where the (third-party) libraries are located */
+#define LIBDIR         "/usr/local/lib"
+
+#define HAVE_STRDUP    1
+#define HAVE_STDBOOL_H 1
+
+/*
+ * The maximum length a name or keyword can have.
+ * It's to avoid calling malloc so much.
+ */
+#define MAX_NAME_LENGTH 128
+
+/*
+ * Maximum number of parameters a function can take.
+ * Guess what, it's also to avoid calling malloc so much.
+ */
+#define MAX_FUN_PARAMS 16
+
+#endif /* CONFIG_H */
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
@@ -0,0 +1,170 @@
+/*
+ *
+ * context.c
+ *
+ * Created at:  Mon Oct 19 21:48:19 2026 21:48:19
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ast.h"
+#include "context.h"
+#include "jit.h"
+#include "mem.h"
+#include "nob.h"
+#include "opt.h"
+#include "parser.h"
+#include "scope.h"
+#include "tier.h"
+
+#if defined(__GNUC__)
+__thread struct nemo_ctx *NM_ctx __attribute__((tls_model("initial-exec"))) = NULL;
+#else
+_Thread_local struct nemo_ctx *NM_ctx = NULL;
+#endif
+
+struct nemo_ctx *nemo_ctx_new(void)
+{
+  /* {{{ */
+  struct nemo_ctx *ctx, *prev;
+
+  if ((ctx = calloc(1, sizeof(struct nemo_ctx))) == NULL){
+    fprintf(stderr, "calloc failed to allocate %zu bytes in %s line %u\n",
+        sizeof(struct nemo_ctx), __FILE__, __LINE__);
+    exit(1);
+  }
+
+  ctx->currid = 1;
+  ctx->as_size = 256;
+  ctx->dump_indent = 3;
+
+  ctx->tiering.enabled = true;
+  ctx->tiering.calls = NM_TIER_CALLS_DEFAULT;
+  ctx->tiering.loops = NM_TIER_LOOPS_DEFAULT;
+  ctx->tiering.stats = false;
+
+  /* the rest of the set up is done by the functions that use the context */
+  prev = nemo_ctx_enter(ctx);
+
+  next_type_var_name = L'α';
+
+  /* initialize the argument stack */
+  arg_stack_init();
+  /* initialize the types (which includes creating the standard types) and
+   * everything related */
+  types_init();
+  /* THE scope */
+  ctx->main = new_scope("main", NULL);
+
+  nemo_ctx_enter(prev);
+
+  return ctx;
+  /* }}} */
+}
+
+void nemo_ctx_free(struct nemo_ctx *ctx)
+{
+  /* {{{ */
+  struct nemo_ctx *prev;
+
+  assert(ctx != NM_ctx);
+
+  prev = nemo_ctx_enter(ctx);
+
+  next_type_var_name = L'α';
+
+  /* the order quite matters (the collector could still be marking the frames
+   * on the heap, for one) */
+  arg_stack_finish();
+  gc_finish();
+  frame_stack_finish();
+  tier_finish();
+  jit_finish();
+  types_finish();
+  scopes_finish();
+
+  nfree(ctx->text);
+  nfree(ctx->data);
+  nfree(ctx->bss);
+  nfree(ctx->funcs);
+
+  nemo_ctx_enter(prev);
+
+  free(ctx);
+  /* }}} */
+}
+
+struct nemo_ctx *nemo_ctx_enter(struct nemo_ctx *ctx)
+{
+  /* {{{ */
+  struct nemo_ctx *prev = NM_ctx;
+
+  /* the context could have been used by some other thread, whose C stack the
+   * interpreter has nothing to do with (see `exec_nodes`) */
+  if (ctx != NULL && ctx != prev)
+    ctx->cs_base = NULL;
+
+  NM_ctx = ctx;
+
+  return prev;
+  /* }}} */
+}
+
+bool nemo_ctx_fuel(struct nemo_ctx *ctx, unsigned long budget)
+{
+  /* {{{ */
+  if (budget == 0){
+    ctx->fuel.enabled = false;
+    return true;
+  }
+
+  if (ctx->jit_code != NULL)
+    return false;
+
+  ctx->fuel.enabled = true;
+  ctx->fuel.budget = budget;
+  ctx->tiering.enabled = false;
+
+  return true;
+  /* }}} */
+}
+
+bool nemo_ctx_out_of_fuel(struct nemo_ctx *ctx)
+{
+  return ctx->fuel.exhausted;
+}
+
+int nemo_ctx_eval(struct nemo_ctx *ctx, const char *name, char *source,
+    unsigned opt_level)
+{
+  /* {{{ */
+  struct nemo_ctx *prev = nemo_ctx_enter(ctx);
+  struct node *root;
+  int ret = 0;
+
+  if ((root = parse_string((char *)name, source, ctx->main)) != NULL){
+    root = optimize(root, opt_level);
+    exec_nodes(root, chain_stack_depth(root));
+
+    if (ctx->fuel.exhausted)
+      ret = 2;
+  } else
+    ret = 1;
+
+  nemo_ctx_enter(prev);
+
+  return ret;
+  /* }}} */
+}
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
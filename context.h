@@ -0,0 +1,221 @@
+/*
+ *
+ * context.h
+ *
+ * Created at:  Mon Oct 19 21:48:19 2026 21:48:19
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "nemo.h"
+#include "tier.h"
+#include "utf8.h"
+
+/* forward */
+struct code;
+struct code_list;
+struct frame;
+struct gc_pool;
+struct gc_roots;
+struct gc_slab;
+struct nemo_gc_stats;
+struct nob;
+struct nob_type;
+struct node;
+struct nodes_list;
+struct profile;
+struct scope;
+struct scopes_list;
+struct section;
+struct types_list;
+
+/*
+ * Everything an interpreter has: its program, types, objects, stacks, and so
+ * on. Any number of them can exist at once, and each one can be used by one
+ * thread at a time, independently of the others.
+ *
+ * The thread using one has to enter it first (see `nemo_ctx_enter`), it's
+ * where all the functions of libnemo take the state from (`NM_ctx`), so it
+ * doesn't have to be passed around everywhere.
+ */
+struct nemo_ctx {
+  /* the global scope */
+  struct scope *main;
+
+  /* {{{ the interpreter (ast.c) */
+  /* program counter */
+  struct node *pc;
+  /* the argument stack (see `arg_stack_reserve`) */
+  struct nob **as, **as_curr, **as_end;
+  size_t as_size;
+  /* the frame stack */
+  char *fs, *fs_curr;
+  size_t fs_size;
+  /* the frame of the function that's currently being executed (NULL in the
+   * global scope) */
+  struct frame *fp;
+  /* where the C stack was when the execution started, and how far from there
+   * it can grow before the interpreter's recursion crashes the whole process */
+  char *cs_base;
+  size_t cs_limit;
+  /* a call in a tail position that's waiting to be made (see
+   * `call_saturated`); its arguments are at the top of the argument stack */
+  struct {
+    /* NULL if there's none */
+    struct node *fun;
+    struct frame *env;
+    struct nob **bound;
+    unsigned nbound;
+  } tail;
+  /* the global scope of the statements being executed */
+  struct scope *globals;
+  /* the execution budget (see `nemo_ctx_fuel`) */
+  struct {
+    bool enabled;
+    /* how many function calls (and loop iterations) an execution can make,
+     * and how many are left */
+    unsigned long budget, left;
+    /* did the last execution run out of it? */
+    bool exhausted;
+    /* where the execution is abandoned to */
+    jmp_buf out;
+  } fuel;
+  /* the next node's id */
+  unsigned currid;
+  /* maintaining the proper amount of spaces before the node's dump */
+  int dump_indent;
+  /* }}} */
+
+  /* {{{ the compiler (ast.c) */
+  /* the file into which all the assembly goes */
+  FILE *outfile;
+  /* buffers for the assembly sections (the `out` functions writes into them),
+   * allocated once there's something to compile */
+  struct section *text, *data, *bss, *funcs;
+  /* the current section we are writing to */
+  struct section *currsect;
+  /* the current generic label id */
+  unsigned currlabelid;
+  /* the function whose body is being compiled (NULL outside of any) */
+  struct node *currfunc;
+  /* the functions whose bodies are yet to be compiled (see `comp_nodes`) */
+  struct nodes_list *pending_funs;
+  /* did the last walk of `convert_closures` add a free variable? */
+  bool closures_changed;
+  /* }}} */
+
+  /* {{{ the types and the objects (nob.c) */
+  struct nob_type *t_void, *t_int, *t_infnum, *t_char, *t_real, *t_string,
+                  *t_list;
+  struct types_list *types;
+  struct gc_pool *gc;
+  /* the slabs of the released pools, and a nursery (see nob.c) */
+  struct gc_slab *gc_slabs;
+  char *gc_nursery;
+  /* is the nursery full (and waiting for a safe point to be collected)? */
+  bool gc_pending;
+  /* see `gc_protect` */
+  struct gc_roots *gc_roots;
+  /* the promoted objects whose insides are yet to be promoted */
+  struct nob **gc_work;
+  size_t gc_nwork, gc_work_size;
+  /* the number of the last major collection */
+  uint32_t gc_epoch;
+  /* what the collector did so far (see `nemo_gc_stats`) */
+  struct nemo_gc_stats *gc_stats;
+  nchar_t next_type_var_name;
+  /* where `unify` and friends jump to when the types don't match */
+  jmp_buf infer_jmp_buf;
+  /* }}} */
+
+  /* a list of global scopes (scope.c) */
+  struct scopes_list *scopes;
+  /* the ids of the common subexpressions' variables (opt.c) */
+  unsigned cse_id;
+
+  /* {{{ the machine code (jit.c, tier.c) */
+  struct tiering tiering;
+  /* the functions that got counted, for the stats */
+  struct nodes_list *tier_counted;
+  /* the native code doesn't grow the C stack past it */
+  char *jit_stack_limit;
+  /* the memory the compiled functions are in */
+  struct code_list *jit_code;
+  /* the innermost function being compiled */
+  struct code *jit_compiling;
+  /* }}} */
+
+  /* {{{ debugging (debug.c, mem.c, profile.c) */
+  uint32_t debug_flags;
+  unsigned mem_counter;
+  /* is the program being profiled (option `-P`)? */
+  bool profiling;
+  struct profile *profile;
+  /* }}} */
+};
+
+/* the context the calling thread has entered (NULL if none) */
+#if defined(__GNUC__)
+/* libnemo is a shared library, and the initial-exec model makes it a single
+ * load off of the thread pointer, rather than a function call */
+extern __thread struct nemo_ctx *NM_ctx __attribute__((tls_model("initial-exec")));
+#else
+extern _Thread_local struct nemo_ctx *NM_ctx;
+#endif
+
+/*
+ * Creates a new interpreter, with only the standard types and an empty global
+ * scope. The thread that calls it doesn't enter it.
+ */
+struct nemo_ctx *nemo_ctx_new(void);
+
+/* the thread that calls it can't be in the <ctx> */
+void nemo_ctx_free(struct nemo_ctx *ctx);
+
+/*
+ * Makes the calling thread use the <ctx> (which no other thread can be using at
+ * the moment), and returns the one it used before.
+ */
+struct nemo_ctx *nemo_ctx_enter(struct nemo_ctx *ctx);
+
+/*
+ * Limits every execution in the <ctx> to <budget> function calls and loop
+ * iterations, after which it is abandoned (see `nemo_ctx_out_of_fuel`); a
+ * <budget> of 0 takes the limit away.
+ *
+ * The machine code can't be metered, so the functions stay in the interpreter
+ * while there's a limit (see tier.c). Returns false if the <ctx> already has
+ * some of them compiled.
+ */
+bool nemo_ctx_fuel(struct nemo_ctx *ctx, unsigned long budget);
+
+/* did the last execution in the <ctx> run out of fuel? */
+bool nemo_ctx_out_of_fuel(struct nemo_ctx *ctx);
+
+/*
+ * Parses, optimizes (at the <opt_level>) and executes the <source> (whose name
+ * is <name>) in the global scope of the <ctx>, so the variables and the types
+ * it declares are there for the next ones.
+ *
+ * Returns 0 on success, 1 if the source couldn't be parsed, and 2 if it ran out
+ * of fuel.
+ */
+int nemo_ctx_eval(struct nemo_ctx *ctx, const char *name, char *source,
+    unsigned opt_level);
+
+#endif /* CONTEXT_H */
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
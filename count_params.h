@@ -143,11 +143,10 @@ static inline void count_params_fun(struct node *node, struct params_info *info)
 
 static inline void count_params_call(struct node *node, struct params_info *info)
 {
-  /* supress warnings */
-  (void)node;
-  (void)info;
+  struct nodes_list *arg;
 
-  count_params(node->in.call.arg, info);
+  for (arg = node->in.call.args; arg != NULL; arg = arg->next)
+    count_params(arg->node, info);
 }
 
 static inline void count_params_use(struct node *node, struct params_info *info)
@@ -176,6 +175,7 @@ static inline struct params_info count_params(struct node *node, struct params_i
     [NT_STRING]  = count_params_const,
     [NT_CHAR]    = count_params_const,
     [NT_TUPLE]   = count_params_tuple,
+    [NT_LIST]    = count_params_tuple,
     [NT_NAME]    = count_params_name,
     [NT_UNOP]    = count_params_unop,
     [NT_BINOP]   = count_params_binop,
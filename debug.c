@@ -18,10 +18,6 @@
 #include "ast.h"
 #include "debug.h"
 
-/* the bit pattern of the enabled debug flags */
-/* see debug.h for more details */
-uint32_t NM_debug_flags = 0;
-
 void debug_ast_new(struct node *nd, const char *fmt, ...)
 {
   if (NM_DEBUG_GET_FLAG(NM_DEBUG_AST)){
@@ -18,14 +18,16 @@
 
 #include "ast.h"
 
-/* globalize the flags (defined in debug.c) */
-extern uint32_t NM_debug_flags;
+/* the bit pattern of the enabled debug flags (per context) */
+#define NM_debug_flags (NM_ctx->debug_flags)
 /* the debug flags */
 #define NM_DEBUG_AST    (1 << 0)  /* -da */
 #define NM_DEBUG_LEXER  (1 << 1)  /* -dl */
 #define NM_DEBUG_MEM    (1 << 2)  /* -dm */
 #define NM_DEBUG_PARSER (1 << 3)  /* -dp */
 #define NM_DEBUG_TYPES  (1 << 4)  /* -dt */
+#define NM_DEBUG_GC     (1 << 5)  /* -dg */
+#define NM_DEBUG_GC_JSON (1 << 6) /* -dG */
 /* there are, obviously, more to come :) */
 /* few more handy macros to set/get certain debug flags */
 #define NM_DEBUG_SET_FLAG(f) (NM_debug_flags |= (f))
@@ -23,13 +23,12 @@
 #include "nob.h"
 #include "count_params.h"
 
-static jmp_buf infer_jmp_buf;
+#define infer_jmp_buf (NM_ctx->infer_jmp_buf)
 
 static struct nob_type *infer_type_internal(struct scope *scope, struct node *node, struct ng *nongen);
 static bool types_are_equal(struct nob_type *one, struct nob_type *two);
 static bool occurs_in_type(struct nob_type *v, struct nob_type *type2);
 static bool occurs_in(struct nob_type *v, struct nob_type *type2);
-static struct nob_type *prune(struct nob_type *type);
 
 typedef struct {
   struct nob_type *from;
@@ -41,6 +40,7 @@ struct ng *new_nongen(void)
   struct ng *ng = nmalloc(sizeof(struct ng));
 
   ng->current_slot = ng->slots;
+  ng->slots_num = 0;
 
   return ng;
 }
@@ -139,6 +139,9 @@ static struct nob_type *freshrec(struct nob_type *type, struct ng *nongen, mappi
 
         return new_type(OT_TUPLE, new_types_list);
       }
+      case OT_LIST:
+        return new_type(OT_LIST,
+            freshrec(pruned->info.list.elem, nongen, mappings, current_mapping, mappings_num));
 
       /* silence warnings, we won't use these here */
       case OT_TYPE_VARIABLE:
@@ -194,6 +197,9 @@ static bool occurs_in(struct nob_type *type1, struct nob_type *type2)
     for (lptr = type2->info.tuple.elems; lptr != NULL; lptr = lptr->next)
       if (occurs_in_type(type1, lptr->type))
         return true;
+  } else if (type2->primitive == OT_LIST){
+    if (occurs_in_type(type1, type2->info.list.elem))
+      return true;
   } else if (type2->primitive == OT_FUN){
     if (occurs_in_type(type1, type2->info.func.return_type) ||
         occurs_in_type(type1, type2->info.func.param))
@@ -207,7 +213,7 @@ static bool occurs_in(struct nob_type *type1, struct nob_type *type2)
   return false;
 }
 
-static struct nob_type *prune(struct nob_type *type)
+struct nob_type *prune(struct nob_type *type)
 {
   assert(type != NULL);
 
@@ -257,11 +263,15 @@ void unify(struct nob_type *type1, struct nob_type *type2)
         for (; lptra != NULL && lptrb != NULL; lptra = lptra->next, lptrb = lptrb->next){
           unify(lptra->type, lptrb->type);
         }
+      } else if (a->primitive == OT_LIST){
+        unify(a->info.list.elem, b->info.list.elem);
       } else if (a->primitive == OT_FUN){
         unify(a->info.func.return_type, b->info.func.return_type);
         unify(a->info.func.param, b->info.func.param);
       } else if (a->primitive == OT_CUSTOM){
-        unify(a->info.custom.var, b->info.custom.var);
+        /* the likes of `void` have no type parameter */
+        if (a->info.custom.var != NULL && b->info.custom.var != NULL)
+          unify(a->info.custom.var, b->info.custom.var);
       }
     }
   } else {
@@ -270,6 +280,23 @@ void unify(struct nob_type *type1, struct nob_type *type2)
   }
 }
 
+/*
+ * Returns the (curried) type of a function that would take the given <args>
+ * and return <result_type>.
+ */
+static struct nob_type *call_type(struct scope *scope, struct nodes_list *args,
+    struct nob_type *result_type, struct ng *nongen)
+{
+  struct nob_type *param_type;
+
+  if (args == NULL)
+    return result_type;
+
+  param_type = infer_type_internal(scope, args->node, nongen);
+
+  return new_type(OT_FUN, call_type(scope, args->next, result_type, nongen), param_type);
+}
+
 static struct nob_type *infer_type_internal(struct scope *scope, struct node *node, struct ng *nongen)
 {
   struct nob_type *ret = NULL;
@@ -310,6 +337,18 @@ static struct nob_type *infer_type_internal(struct scope *scope, struct node *no
       ret = new_type(OT_TUPLE, reverse_types_list(new_types_list));
       break;
     }
+    case NT_LIST:
+    {
+      struct nob_type *elem = new_type(OT_TYPE_VARIABLE);
+      struct nodes_list *lptr;
+
+      /* the elements are all of the same type */
+      for (lptr = node->in.tuple.elems; lptr != NULL; lptr = lptr->next)
+        unify(elem, infer_type_internal(scope, lptr->node, nongen));
+
+      ret = new_type(OT_LIST, elem);
+      break;
+    }
     case NT_NAME:
     {
       struct nob_type *type = vars_type_lookup(node->in.s, scope, nongen);
@@ -324,41 +363,128 @@ static struct nob_type *infer_type_internal(struct scope *scope, struct node *no
     }
     case NT_FUN:
     {
-      struct nob_type *param_type;
       struct nob_type *result_type;
       struct ng *new_nongen = copy_nongen(nongen);
+      struct node *last;
+      unsigned i;
 
-      struct params_info pinfo = count_params(node->in.fun.body, NULL);
+      for (i = 0; i < node->in.fun.arity; i++)
+        add_to_nongen(new_nongen, node->in.fun.params[i]->type);
 
-      if (pinfo.value == 0)
-        /* "no param" */
-        param_type = T_VOID;
-      else
-        param_type = new_type(OT_TYPE_VARIABLE);
+      /* the function returns whatever its last expression evaluates to */
+      for (last = node->in.fun.body; last->next != NULL; last = last->next)
+        ;
 
-      new_var(node->in.fun.param, 0, NULL, param_type, node->scope, true, 0);
-      add_to_nongen(new_nongen, param_type);
+      result_type = infer_type_internal(node->scope, last, new_nongen);
 
-      result_type = infer_type_internal(node->scope, node->in.fun.body, new_nongen);
+      /* the type is curried nonetheless, so (given int params) { %1 + %2 }
+       * is an int -> int -> int */
+      if (node->in.fun.arity == 0){
+        ret = new_type(OT_FUN, result_type, T_VOID);
+      } else {
+        ret = result_type;
 
-      ret = new_type(OT_FUN, result_type, param_type);
+        for (i = node->in.fun.arity; i > 0; i--)
+          ret = new_type(OT_FUN, ret, node->in.fun.params[i - 1]->type);
+      }
       break;
     }
     case NT_CALL:
     {
       struct nob_type *fun_type = infer_type_internal(scope, node->in.call.fun, nongen);
-      struct nob_type *arg_type = infer_type_internal(scope, node->in.call.arg, nongen);
       struct nob_type *result_type = new_type(OT_TYPE_VARIABLE);
 
-      unify(new_type(OT_FUN, result_type, arg_type), fun_type);
+      if (node->in.call.argc == 0)
+        /* applying void */
+        unify(new_type(OT_FUN, result_type, T_VOID), fun_type);
+      else
+        unify(call_type(scope, node->in.call.args, result_type, nongen), fun_type);
 
       ret = result_type;
       break;
     }
 
-    /* FIXME */
+    case NT_TERNOP:
+    {
+      infer_type_internal(scope, node->in.ternop.predicate, nongen);
+
+      ret = infer_type_internal(scope, node->in.ternop.yes, nongen);
+      unify(ret, infer_type_internal(scope, node->in.ternop.no, nongen));
+      break;
+    }
+    case NT_IF:
+    {
+      /* it can end a function's body, so it's the function's return value */
+      infer_type_internal(scope, node->in.iff.guard, nongen);
+
+      ret = infer_type_internal(scope, node->in.iff.body, nongen);
+
+      if (node->in.iff.elsee)
+        unify(ret, infer_type_internal(scope, node->in.iff.elsee, nongen));
+      break;
+    }
+
     case NT_BINOP:
-      return T_INT;
+    {
+      struct nob_type *left = infer_type_internal(scope, node->in.binop.left, nongen);
+      struct nob_type *right = infer_type_internal(scope, node->in.binop.right, nongen);
+
+      switch (node->in.binop.type){
+        case BINARY_COMMA:
+          ret = right;
+          break;
+        case BINARY_LOGAND:
+        case BINARY_LOGOR:
+          ret = T_INT;
+          break;
+        case BINARY_GT:
+        case BINARY_LT:
+        case BINARY_GE:
+        case BINARY_LE:
+        case BINARY_EQ:
+        case BINARY_NE:
+          unify(left, right);
+          ret = T_INT;
+          break;
+        case BINARY_INDEX:
+          unify(right, T_INT);
+
+          /* the strings are indexed the same way the lists of characters
+           * are */
+          if (prune(left)->primitive == OT_STRING){
+            ret = T_CHAR;
+            break;
+          }
+
+          ret = new_type(OT_TYPE_VARIABLE);
+          unify(left, new_type(OT_LIST, ret));
+          break;
+        case BINARY_SLICE:
+        {
+          struct types_list *bounds = nmalloc(sizeof(struct types_list));
+
+          bounds->type = T_INT;
+          bounds->next = nmalloc(sizeof(struct types_list));
+          bounds->next->type = T_INT;
+          bounds->next->next = NULL;
+
+          if (prune(left)->primitive != OT_STRING)
+            unify(left, new_type(OT_LIST, new_type(OT_TYPE_VARIABLE)));
+
+          unify(right, new_type(OT_TUPLE, bounds));
+          ret = left;
+          break;
+        }
+        default:
+          /* the arithmetic and the assignments; both of the operands are of
+           * the same type, and so is the result (this is what lets the
+           * interpreter quicken the operation, see `quicken`) */
+          unify(left, right);
+          ret = left;
+          break;
+      }
+      break;
+    }
 
     /* TODO implement the rest of nodes */
     default:
@@ -194,7 +194,7 @@ void infnum_print(struct infnum num, FILE *fp)
   else
     fprintf(fp,  "%s", buff);
 
-  free(buff);
+  nfree(buff);
   free_infnum(copy);
   free_infnum(ten);
 }
@@ -0,0 +1,741 @@
+/*
+ *
+ * jit.c
+ *
+ * Created at:  Mon Oct 19 20:14:07 2026 20:14:07
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+/*
+ * The just-in-time compiler of the interpreter (x86-64 only).
+ *
+ * A function which got hot in the interpreter (see tier.c) gets its body
+ * translated straight into machine code, which is put into memory that's made
+ * executable only once it's no longer writable.
+ *
+ * Only the functions which deal with integers alone are compiled: their params
+ * and every expression in their bodies have to be of type `int` (as inferred),
+ * and the body can only use the params, integer constants, the arithmetic,
+ * bitwise, comparison and logical operations, `?:`, `if`/`else` (whose blocks
+ * are inlined, if they're a single expression), and calls to itself or to
+ * other such functions. Nothing in there has any side effects, nor allocates
+ * anything, so the native code doesn't need to know about the interpreter at
+ * all. The arithmetic wraps around and division by zero is an error, just like
+ * in the interpreter.
+ *
+ * The native function takes a pointer to its arguments (as 64-bit integers) in
+ * rdi, and the lowest the C stack can go in rsi (the calling context's, see
+ * `NM_jit_stack_limit`, as the code can be run by any of them), and returns its
+ * result in eax. Nothing in the native code touches rsi, so it's passed along
+ * to the calls as it is. The params are kept in its stack frame,
+ * below rbp. The expressions are evaluated into eax, the intermediate results
+ * are pushed onto the stack. A call to itself in a tail position becomes a jump
+ * back to the start of the body.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ast.h"
+#include "infer.h"
+#include "jit.h"
+#include "mem.h"
+#include "scope.h"
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/* the memory the compiled functions are in */
+struct code_list {
+  void *mem;
+  size_t size;
+  struct code_list *next;
+};
+
+#define NM_code (NM_ctx->jit_code)
+
+#if defined(__x86_64__)
+
+/* the function being compiled */
+struct code {
+  struct node *fun;
+  unsigned char *buf;
+  size_t pos, size;
+  /* where the body starts (after the prologue) */
+  size_t body;
+  /* how many stack words were pushed by the code emitted so far (to keep the
+   * stack aligned at the calls) */
+  unsigned depth;
+  /* the first node it came across that it can't compile (if any) */
+  struct node *rejected;
+  /* can a call in a tail position be made in place? (it can't from a block
+   * whose own call isn't in one, see `gen_block`) */
+  bool tail;
+  /* the function whose call made this one get compiled */
+  struct code *up;
+};
+
+/* the innermost function being compiled */
+#define compiling (NM_ctx->jit_compiling)
+
+/* the condition codes (the low nibble of jcc's and setcc's opcodes) */
+enum cc {
+  CC_B  = 0x2,
+  CC_AE = 0x3,
+  CC_E  = 0x4,
+  CC_NE = 0x5,
+  CC_L  = 0xc,
+  CC_GE = 0xd,
+  CC_LE = 0xe,
+  CC_G  = 0xf
+};
+
+static void jit_division_by_zero(void)
+{
+  fprintf(stderr, "division by zero! runtime!!\n");
+  exit(1);
+}
+
+static void jit_stack_overflow(void)
+{
+  fprintf(stderr, "nemo: call stack overflow (the recursion is too deep)\n");
+  exit(1);
+}
+
+/* {{{ emitting the bytes */
+static void emit(struct code *c, unsigned n, ...)
+{
+  /* {{{ */
+  va_list vl;
+
+  if (c->pos + n > c->size){
+    c->size = c->size ? c->size * 2 : 256;
+    c->buf = nrealloc(c->buf, c->size);
+  }
+
+  va_start(vl, n);
+
+  while (n--)
+    c->buf[c->pos++] = (unsigned char)va_arg(vl, int);
+
+  va_end(vl);
+  /* }}} */
+}
+
+static void emit32(struct code *c, uint32_t u)
+{
+  emit(c, 4, u & 0xff, (u >> 8) & 0xff, (u >> 16) & 0xff, u >> 24);
+}
+
+static void emit64(struct code *c, uint64_t u)
+{
+  emit32(c, (uint32_t)u);
+  emit32(c, (uint32_t)(u >> 32));
+}
+
+/* the 32-bit displacement at <at> (filled by `jump_here`) */
+static void patch32(struct code *c, size_t at, uint32_t u)
+{
+  c->buf[at]     = u & 0xff;
+  c->buf[at + 1] = (u >> 8) & 0xff;
+  c->buf[at + 2] = (u >> 16) & 0xff;
+  c->buf[at + 3] = u >> 24;
+}
+
+/*
+ * Emits a jump (if <cc> is 0 it's an unconditional one) to where the code is
+ * going to be once `jump_here` is called with what it returned.
+ */
+static size_t jump(struct code *c, enum cc cc)
+{
+  /* {{{ */
+  if (cc)
+    emit(c, 2, 0x0f, 0x80 | cc);
+  else
+    emit(c, 1, 0xe9);
+
+  emit32(c, 0);
+
+  return c->pos - 4;
+  /* }}} */
+}
+
+static void jump_here(struct code *c, size_t at)
+{
+  patch32(c, at, (uint32_t)(c->pos - (at + 4)));
+}
+
+/* mov rax, <addr>; call rax (the stack has to be aligned already) */
+static void call_abs(struct code *c, void (*fn)(void))
+{
+  /* {{{ */
+  union { void (*fn)(void); uint64_t u; } addr;
+
+  addr.u = 0;
+  addr.fn = fn;
+
+  emit(c, 2, 0x48, 0xb8);
+  emit64(c, addr.u);
+  emit(c, 2, 0xff, 0xd0);
+  /* }}} */
+}
+
+/* calls one of the error functions above, which don't return */
+static void call_error(struct code *c, void (*fn)(void))
+{
+  /* {{{ */
+  /* sub rsp, 8 */
+  if (c->depth % 2)
+    emit(c, 4, 0x48, 0x83, 0xec, 0x08);
+
+  call_abs(c, fn);
+  /* }}} */
+}
+
+static void push_eax(struct code *c)
+{
+  emit(c, 1, 0x50);
+  c->depth++;
+}
+
+/* pop rcx */
+static void pop_ecx(struct code *c)
+{
+  emit(c, 1, 0x59);
+  c->depth--;
+}
+
+/* the param <idx> lives at [rbp - 4 * (idx + 1)] */
+static int8_t param_disp(unsigned idx)
+{
+  return (int8_t)(-4 * (int)(idx + 1));
+}
+
+/* sets eax to 1 if the <cc> holds, or to 0 otherwise */
+static void set_eax(struct code *c, enum cc cc)
+{
+  /* setcc al; movzx eax, al */
+  emit(c, 3, 0x0f, 0x90 | cc, 0xc0);
+  emit(c, 3, 0x0f, 0xb6, 0xc0);
+}
+/* }}} */
+
+/* the <nd> can't be compiled (and neither can the function then) */
+static void reject(struct code *c, struct node *nd)
+{
+  if (c->rejected == NULL)
+    c->rejected = nd;
+}
+
+static bool is_int(struct node *nd)
+{
+  /* {{{ */
+  if (nd->result_type == NULL)
+    return false;
+
+  return prune(nd->result_type)->primitive == OT_INT;
+  /* }}} */
+}
+
+static void gen(struct code *c, struct node *nd);
+
+/* functions which call each other can't wait for one another to be compiled */
+static bool being_compiled(struct node *fun)
+{
+  /* {{{ */
+  struct code *c;
+
+  for (c = compiling; c != NULL; c = c->up)
+    if (c->fun == fun)
+      return true;
+
+  return false;
+  /* }}} */
+}
+
+static void gen_param(struct code *c, struct node *nd)
+{
+  /* {{{ */
+  struct var *var = var_lookup(nd->in.s, nd->scope);
+  struct node *fun = c->fun;
+  unsigned i;
+
+  if (var == NULL || !var->param || var->scope != fun->scope){
+    reject(c, nd);
+    return;
+  }
+
+  for (i = 0; i < fun->in.fun.arity; i++){
+    if (fun->in.fun.params[i] == var){
+      /* mov eax, [rbp + disp8] */
+      emit(c, 3, 0x8b, 0x45, (uint8_t)param_disp(i));
+      return;
+    }
+  }
+
+  reject(c, nd);
+  /* }}} */
+}
+
+static void gen_divmod(struct code *c, enum binop_type op)
+{
+  /* {{{ */
+  size_t nonzero, normal, not_min, done;
+
+  /* test ecx, ecx; jnz nonzero */
+  emit(c, 2, 0x85, 0xc9);
+  nonzero = jump(c, CC_NE);
+  call_error(c, jit_division_by_zero);
+  jump_here(c, nonzero);
+
+  /* INT32_MIN / -1 is the one quotient that doesn't fit (and idiv traps) */
+  /* cmp ecx, -1; jne normal; cmp eax, INT32_MIN; jne not_min */
+  emit(c, 3, 0x83, 0xf9, 0xff);
+  normal = jump(c, CC_NE);
+  emit(c, 1, 0x3d);
+  emit32(c, 0x80000000u);
+  not_min = jump(c, CC_NE);
+
+  /* the quotient stays INT32_MIN, the remainder is 0 */
+  if (op == BINARY_MOD)
+    emit(c, 2, 0x31, 0xc0);
+
+  done = jump(c, 0);
+  jump_here(c, normal);
+  jump_here(c, not_min);
+
+  /* cdq; idiv ecx */
+  emit(c, 3, 0x99, 0xf7, 0xf9);
+
+  /* mov eax, edx */
+  if (op == BINARY_MOD)
+    emit(c, 2, 0x89, 0xd0);
+
+  jump_here(c, done);
+  /* }}} */
+}
+
+static void gen_logical(struct code *c, struct node *nd)
+{
+  /* {{{ */
+  bool or = nd->in.binop.type == BINARY_LOGOR;
+  size_t settled, done;
+
+  /* the right operand only gets evaluated if the left one doesn't settle it
+   * already */
+  gen(c, nd->in.binop.left);
+  emit(c, 2, 0x85, 0xc0);
+  settled = jump(c, or ? CC_NE : CC_E);
+
+  gen(c, nd->in.binop.right);
+  emit(c, 2, 0x85, 0xc0);
+  set_eax(c, CC_NE);
+  done = jump(c, 0);
+
+  jump_here(c, settled);
+  /* mov eax, <or> */
+  emit(c, 1, 0xb8);
+  emit32(c, or);
+
+  jump_here(c, done);
+  /* }}} */
+}
+
+static void gen_binop(struct code *c, struct node *nd)
+{
+  /* {{{ */
+  enum binop_type op = nd->in.binop.type;
+
+  if (!is_int(nd->in.binop.left) || !is_int(nd->in.binop.right)){
+    reject(c, nd);
+    return;
+  }
+
+  switch (op){
+    case BINARY_LOGAND:
+    case BINARY_LOGOR:
+      gen_logical(c, nd);
+      return;
+    case BINARY_COMMA:
+      gen(c, nd->in.binop.left);
+      gen(c, nd->in.binop.right);
+      return;
+    default:
+      break;
+  }
+
+  gen(c, nd->in.binop.right);
+  push_eax(c);
+  gen(c, nd->in.binop.left);
+  pop_ecx(c);
+
+  /* eax <op>= ecx */
+  switch (op){
+    case BINARY_ADD:    emit(c, 2, 0x01, 0xc8); break;
+    case BINARY_SUB:    emit(c, 2, 0x29, 0xc8); break;
+    case BINARY_MUL:    emit(c, 3, 0x0f, 0xaf, 0xc1); break;
+    case BINARY_BITAND: emit(c, 2, 0x21, 0xc8); break;
+    case BINARY_BITXOR: emit(c, 2, 0x31, 0xc8); break;
+    case BINARY_BITOR:  emit(c, 2, 0x09, 0xc8); break;
+    /* the shifts are done by cl, which the cpu masks the same way the
+     * interpreter does; the right one is a logical one in both */
+    case BINARY_SHL:    emit(c, 2, 0xd3, 0xe0); break;
+    case BINARY_SHR:    emit(c, 2, 0xd3, 0xe8); break;
+    case BINARY_DIV:
+    case BINARY_MOD:
+      gen_divmod(c, op);
+      break;
+    case BINARY_GT: emit(c, 2, 0x39, 0xc8); set_eax(c, CC_G);  break;
+    case BINARY_LT: emit(c, 2, 0x39, 0xc8); set_eax(c, CC_L);  break;
+    case BINARY_GE: emit(c, 2, 0x39, 0xc8); set_eax(c, CC_GE); break;
+    case BINARY_LE: emit(c, 2, 0x39, 0xc8); set_eax(c, CC_LE); break;
+    case BINARY_EQ: emit(c, 2, 0x39, 0xc8); set_eax(c, CC_E);  break;
+    case BINARY_NE: emit(c, 2, 0x39, 0xc8); set_eax(c, CC_NE); break;
+    default:
+      /* the assignments */
+      reject(c, nd);
+      break;
+  }
+  /* }}} */
+}
+
+/*
+ * A block called right where it's made (which is what the branches of an `if`
+ * are, see parser.c) gets its body compiled in place, given it's a single
+ * expression. Returns false if the <nd> isn't such a call.
+ */
+static bool gen_block(struct code *c, struct node *nd)
+{
+  /* {{{ */
+  struct node *block = nd->in.call.fun;
+  bool tail = c->tail;
+
+  if (block->type != NT_FUN || block->in.fun.arity > 0 || nd->in.call.argc > 0 ||
+      block->in.fun.body == NULL || block->in.fun.body->next != NULL)
+    return false;
+
+  c->tail = tail && nd->in.call.tail;
+  gen(c, block->in.fun.body);
+  c->tail = tail;
+
+  return true;
+  /* }}} */
+}
+
+static void gen_call(struct code *c, struct node *nd)
+{
+  /* {{{ */
+  struct node *fun = c->fun;
+  struct node *callee = nd->in.call.known;
+  struct node *args[NM_JIT_MAX_ARGS];
+  struct nodes_list *arg;
+  unsigned argc = 0, pad, i;
+
+  if (gen_block(c, nd))
+    return;
+
+  /* a recursive call is parsed before its function is assigned to the
+   * variable, but it's known by now */
+  if (callee == NULL)
+    callee = known_fun(nd->in.call.fun, nd->scope);
+
+  if (callee == NULL || callee->in.fun.body == NULL ||
+      nd->in.call.argc != callee->in.fun.arity){
+    reject(c, nd);
+    return;
+  }
+
+  /* the callee has to be compiled as well (unless it's a recursive call) */
+  if (callee != fun && callee->in.fun.native == NULL &&
+      (being_compiled(callee) || !jit_compile(callee))){
+    reject(c, nd);
+    return;
+  }
+
+  for (arg = nd->in.call.args; arg != NULL; arg = arg->next)
+    args[argc++] = arg->node;
+
+  if (nd->in.call.tail && c->tail && callee == fun && c->depth == 0){
+    /* evaluate all the arguments before any of the params gets overwritten */
+    for (i = 0; i < argc; i++){
+      gen(c, args[i]);
+      push_eax(c);
+    }
+
+    /* pop rax; mov [rbp + disp8], eax */
+    for (i = argc; i > 0; i--){
+      emit(c, 1, 0x58);
+      emit(c, 3, 0x89, 0x45, (uint8_t)param_disp(i - 1));
+      c->depth--;
+    }
+
+    /* jmp body */
+    emit(c, 1, 0xe9);
+    emit32(c, (uint32_t)(c->body - (c->pos + 4)));
+    return;
+  }
+
+  /* the stack has to be 16-byte aligned at the call */
+  pad = (c->depth + argc) % 2;
+
+  if (pad){
+    emit(c, 4, 0x48, 0x83, 0xec, 0x08);
+    c->depth++;
+  }
+
+  /* the arguments go in the reverse order, so the first one is at the lowest
+   * address */
+  for (i = argc; i > 0; i--){
+    gen(c, args[i - 1]);
+    push_eax(c);
+  }
+
+  /* mov rdi, rsp */
+  emit(c, 3, 0x48, 0x89, 0xe7);
+
+  if (callee == fun){
+    /* call <the start of the function> */
+    emit(c, 1, 0xe8);
+    emit32(c, (uint32_t)(0 - (c->pos + 4)));
+  } else {
+    union { nativef_t fn; uint64_t u; } addr;
+
+    addr.u = 0;
+    addr.fn = callee->in.fun.native;
+
+    emit(c, 2, 0x48, 0xb8);
+    emit64(c, addr.u);
+    emit(c, 2, 0xff, 0xd0);
+  }
+
+  /* add rsp, <the arguments and the padding> */
+  if (argc + pad > 0){
+    emit(c, 3, 0x48, 0x81, 0xc4);
+    emit32(c, 8 * (argc + pad));
+    c->depth -= argc + pad;
+  }
+  /* }}} */
+}
+
+/* evaluates the <nd> to <yes> if the <predicate> holds, to <no> otherwise */
+static void gen_cond(struct code *c, struct node *nd, struct node *predicate,
+    struct node *yes, struct node *no)
+{
+  /* {{{ */
+  size_t otherwise, done;
+
+  if (!is_int(predicate) || yes == NULL || no == NULL){
+    reject(c, nd);
+    return;
+  }
+
+  gen(c, predicate);
+  emit(c, 2, 0x85, 0xc0);
+  otherwise = jump(c, CC_E);
+  gen(c, yes);
+  done = jump(c, 0);
+  jump_here(c, otherwise);
+  gen(c, no);
+  jump_here(c, done);
+  /* }}} */
+}
+
+static void gen(struct code *c, struct node *nd)
+{
+  /* {{{ */
+  if (c->rejected != NULL)
+    return;
+
+  if (!is_int(nd)){
+    reject(c, nd);
+    return;
+  }
+
+  switch (nd->type){
+    case NT_INTEGER:
+      /* mov eax, imm32 */
+      emit(c, 1, 0xb8);
+      emit32(c, (uint32_t)nd->in.i);
+      break;
+
+    case NT_NAME:
+      gen_param(c, nd);
+      break;
+
+    case NT_UNOP:
+      gen(c, nd->in.unop.target);
+
+      /* the interpreter does nothing for the other ones yet */
+      if (nd->in.unop.type == UNARY_MINUS)
+        emit(c, 2, 0xf7, 0xd8);
+      else if (nd->in.unop.type != UNARY_PLUS)
+        reject(c, nd);
+      break;
+
+    case NT_BINOP:
+      gen_binop(c, nd);
+      break;
+
+    case NT_TERNOP:
+      gen_cond(c, nd, nd->in.ternop.predicate, nd->in.ternop.yes,
+          nd->in.ternop.no);
+      break;
+
+    case NT_IF:
+      /* (without an else it's got no value to give) */
+      if (nd->in.iff.unless)
+        gen_cond(c, nd, nd->in.iff.guard, nd->in.iff.elsee, nd->in.iff.body);
+      else
+        gen_cond(c, nd, nd->in.iff.guard, nd->in.iff.body, nd->in.iff.elsee);
+      break;
+
+    case NT_CALL:
+      gen_call(c, nd);
+      break;
+
+    default:
+      reject(c, nd);
+      break;
+  }
+  /* }}} */
+}
+
+static void gen_fun(struct code *c)
+{
+  /* {{{ */
+  struct node *fun = c->fun;
+  struct node *expr;
+  unsigned frame = (4 * fun->in.fun.arity + 15) / 16 * 16;
+  unsigned i;
+  size_t ok;
+
+  /* push rbp; mov rbp, rsp; sub rsp, <frame> */
+  emit(c, 4, 0x55, 0x48, 0x89, 0xe5);
+  emit(c, 3, 0x48, 0x81, 0xec);
+  emit32(c, frame);
+
+  /* cmp rsp, rsi; jae ok */
+  emit(c, 3, 0x48, 0x39, 0xf4);
+  ok = jump(c, CC_AE);
+  call_error(c, jit_stack_overflow);
+  jump_here(c, ok);
+
+  /* mov eax, [rdi + 8 * i]; mov [rbp + disp8], eax */
+  for (i = 0; i < fun->in.fun.arity; i++){
+    emit(c, 3, 0x8b, 0x47, 8 * i);
+    emit(c, 3, 0x89, 0x45, (uint8_t)param_disp(i));
+  }
+
+  c->body = c->pos;
+
+  for (expr = fun->in.fun.body; expr != NULL; expr = expr->next)
+    gen(c, expr);
+
+  /* leave; ret */
+  emit(c, 2, 0xc9, 0xc3);
+  /* }}} */
+}
+
+bool jit_compile(struct node *fun)
+{
+  /* {{{ */
+  struct code c = { fun, NULL, 0, 0, 0, 0, NULL, true, NULL };
+  struct code_list *code;
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  void *mem;
+  union { void *mem; nativef_t fn; } native;
+
+  assert(fun->type == NT_FUN);
+
+  if (fun->in.fun.native != NULL)
+    return true;
+
+  if (fun->in.fun.nojit || fun->in.fun.body == NULL ||
+      fun->in.fun.arity > NM_JIT_MAX_ARGS || fun->result_type == NULL)
+    goto fail;
+
+  c.up = compiling;
+  compiling = &c;
+  gen_fun(&c);
+  compiling = c.up;
+
+  if (c.rejected != NULL)
+    goto fail;
+
+  /* it never is writable and executable at the same time */
+  mem = mmap(NULL, (c.pos + page - 1) / page * page, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (mem == MAP_FAILED)
+    goto fail;
+
+  memcpy(mem, c.buf, c.pos);
+
+  if (mprotect(mem, (c.pos + page - 1) / page * page, PROT_READ | PROT_EXEC) != 0){
+    munmap(mem, (c.pos + page - 1) / page * page);
+    goto fail;
+  }
+
+  code = nmalloc(sizeof(struct code_list));
+  code->mem = mem;
+  code->size = (c.pos + page - 1) / page * page;
+  code->next = NM_code;
+  NM_code = code;
+
+  nfree(c.buf);
+
+  native.mem = mem;
+  fun->in.fun.native = native.fn;
+
+  return true;
+
+fail:
+  nfree(c.buf);
+  fun->in.fun.nojit = true;
+  fun->in.fun.rejected = c.rejected;
+
+  return false;
+  /* }}} */
+}
+
+#else /* !__x86_64__ */
+
+bool jit_compile(struct node *fun)
+{
+  fun->in.fun.nojit = true;
+
+  return false;
+}
+
+#endif /* __x86_64__ */
+
+void jit_finish(void)
+{
+  /* {{{ */
+  struct code_list *next;
+
+  for (; NM_code != NULL; NM_code = next){
+    next = NM_code->next;
+    munmap(NM_code->mem, NM_code->size);
+    nfree(NM_code);
+  }
+  /* }}} */
+}
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
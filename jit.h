@@ -0,0 +1,42 @@
+/*
+ *
+ * jit.h
+ *
+ * Created at:  Mon Oct 19 20:14:07 2026 20:14:07
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+#ifndef JIT_H
+#define JIT_H
+
+#include "ast.h"
+
+/* the most params a function can have to get compiled */
+#define NM_JIT_MAX_ARGS 16
+
+/* the native code doesn't grow the C stack past it (see `exec_nodes`), it's
+ * given the current context's at every call (see `call_native`) */
+#define NM_jit_stack_limit (NM_ctx->jit_stack_limit)
+
+/*
+ * Compiles the <fun> into machine code and sets its `native`, if it's one the
+ * JIT can handle (see jit.c). Otherwise its `nojit` gets set, so it's not tried
+ * again.
+ *
+ * Returns whether it did compile it.
+ */
+bool jit_compile(struct node *fun);
+
+/* frees the memory all the machine code is in */
+void jit_finish(void);
+
+#endif /* JIT_H */
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
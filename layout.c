@@ -0,0 +1,245 @@
+/*
+ *
+ * layout.c
+ *
+ * Created at:  Mon Oct 19 17:05:48 2026 17:05:48
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+/*
+ * Stack frame layout of the compiled functions.
+ *
+ * A function's variables get their places in its frame (below ebp) right
+ * before its body is compiled, when all of them (and their types) are known.
+ * Each one takes as many bytes as its type does, aligned to that size (but no
+ * more than to a stack word); the ones whose types are still unknown take a
+ * stack word.
+ *
+ * Two variables share a slot if they're never needed at the same time. The
+ * lifetime of a variable spans the expressions of the function's body from
+ * the first to the last one that touches it: declares it, reads it or hands
+ * it over to a nested function (see closure.c).
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include "ast.h"
+#include "closure.h"
+#include "infer.h"
+#include "layout.h"
+#include "mem.h"
+#include "scope.h"
+
+struct lifetime {
+  struct var *var;
+  /* the first and the last expressions of the body that touch the variable
+   * (-1 if none does) */
+  int first, last;
+};
+
+struct slot {
+  int offset;
+  unsigned size;
+  /* the last expression the variable currently in the slot is needed in */
+  int last;
+};
+
+struct uses {
+  struct scope *scope;
+  struct lifetime *vars;
+  unsigned nvars;
+  /* the index of the body's expression being looked at */
+  int at;
+};
+
+static void touch(struct uses *uses, struct var *var)
+{
+  /* {{{ */
+  unsigned i;
+
+  if (var == NULL || var->scope != uses->scope)
+    return;
+
+  for (i = 0; i < uses->nvars; i++){
+    if (uses->vars[i].var != var)
+      continue;
+
+    if (uses->vars[i].first < 0)
+      uses->vars[i].first = uses->at;
+
+    uses->vars[i].last = uses->at;
+    break;
+  }
+  /* }}} */
+}
+
+static void touch_free_of(struct uses *uses, struct node *fun)
+{
+  /* {{{ */
+  struct vars_list *v;
+
+  for (v = fun->in.fun.free; v != NULL; v = v->next)
+    touch(uses, v->var);
+  /* }}} */
+}
+
+static void find_uses(struct node **slot, void *data)
+{
+  /* {{{ */
+  struct uses *uses = data;
+  struct node *nd = *slot;
+  struct node *fun;
+  struct nodes_list *arg;
+
+  switch (nd->type){
+    case NT_NAME:
+      touch(uses, var_lookup(nd->in.s, nd->scope));
+      return;
+
+    case NT_DECL:
+      touch(uses, nd->in.decl.var);
+      break;
+
+    case NT_CALL:
+      /* a lifted function gets the variables as arguments */
+      if ((fun = direct_call(nd)) != NULL && !fun->in.fun.escapes){
+        touch_free_of(uses, fun);
+
+        for (arg = nd->in.call.args; arg != NULL; arg = arg->next)
+          find_uses(&arg->node, data);
+
+        return;
+      }
+      break;
+
+    case NT_FUN:
+      /* the function's body has a frame of its own, only its environment
+       * record gets filled here */
+      if (nd->in.fun.escapes)
+        touch_free_of(uses, nd);
+      return;
+
+    default:
+      break;
+  }
+
+  for_each_child(nd, find_uses, data);
+  /* }}} */
+}
+
+static int by_first_use(const void *a, const void *b)
+{
+  const struct lifetime *one = a, *two = b;
+
+  return one->first - two->first;
+}
+
+static unsigned size_of(struct var *var)
+{
+  /* {{{ */
+  struct nob_type *type;
+
+  if (var->type == NULL)
+    return NM_STACK_WORD;
+
+  type = prune(var->type);
+
+  /* type variables, and the types which are not laid out yet */
+  if (type->size == 0)
+    return NM_STACK_WORD;
+
+  return type->size;
+  /* }}} */
+}
+
+unsigned layout_frame(struct node *fun)
+{
+  /* {{{ */
+  struct scope *scope = fun->scope;
+  struct uses uses = { scope, NULL, 0, 0 };
+  struct slot *slots;
+  struct vars_list *v;
+  struct node *expr;
+  unsigned nslots = 0;
+  unsigned bytes = 0;
+  unsigned i, j, size, align;
+
+  assert(fun->type == NT_FUN);
+
+  if (scope->laid_out)
+    return scope->frame_bytes;
+
+  for (v = scope->vars; v != NULL; v = v->next)
+    if (!v->var->param)
+      uses.nvars++;
+
+  uses.vars = ncalloc(uses.nvars + 1, sizeof(struct lifetime));
+  slots = ncalloc(uses.nvars + 1, sizeof(struct slot));
+
+  for (v = scope->vars, i = 0; v != NULL; v = v->next){
+    if (v->var->param)
+      continue;
+
+    uses.vars[i].var = v->var;
+    uses.vars[i].first = uses.vars[i].last = -1;
+
+    /* the environment record is needed till the very end */
+    if (v->var == fun->in.fun.env){
+      uses.vars[i].first = 0;
+      uses.vars[i].last = INT_MAX;
+    }
+
+    i++;
+  }
+
+  for (expr = fun->in.fun.body; expr != NULL; expr = expr->next, uses.at++)
+    find_uses(&expr, &uses);
+
+  qsort(uses.vars, uses.nvars, sizeof(struct lifetime), by_first_use);
+
+  for (i = 0; i < uses.nvars; i++){
+    /* nothing ever touches it, so it needs no place */
+    if (uses.vars[i].first < 0)
+      continue;
+
+    size = size_of(uses.vars[i].var);
+
+    /* see if there's a slot which is no longer needed by now */
+    for (j = 0; j < nslots; j++)
+      if (slots[j].last < uses.vars[i].first && slots[j].size >= size)
+        break;
+
+    if (j == nslots){
+      align = size < NM_STACK_WORD ? size : NM_STACK_WORD;
+      bytes = (bytes + size + align - 1) / align * align;
+
+      slots[nslots].offset = -(int)bytes;
+      slots[nslots].size = size;
+      nslots++;
+    }
+
+    slots[j].last = uses.vars[i].last;
+    uses.vars[i].var->offset = slots[j].offset;
+  }
+
+  nfree(uses.vars);
+  nfree(slots);
+
+  scope->frame_bytes = (bytes + NM_STACK_WORD - 1) / NM_STACK_WORD * NM_STACK_WORD;
+  scope->laid_out = true;
+
+  return scope->frame_bytes;
+  /* }}} */
+}
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
@@ -0,0 +1,34 @@
+/*
+ *
+ * layout.h
+ *
+ * Created at:  Mon Oct 19 17:05:48 2026 17:05:48
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include "ast.h"
+
+/* what the offsets of the variables on the stack get aligned to (at most) */
+#define NM_STACK_WORD 4
+
+/*
+ * Gives every (non-param) variable of the function <fun> its offset in the
+ * function's stack frame, and returns how many bytes they take altogether.
+ *
+ * It's only done once per function (the result is kept in its scope).
+ */
+unsigned layout_frame(struct node *fun);
+
+#endif /* LAYOUT_H */
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
@@ -277,6 +277,8 @@ static struct token fetch_token(struct parser *parser, struct lexer *lex)
     while (*savep != '"')
       *(tmp_str + i2++) = *savep++;
 
+    *(tmp_str + i2) = '\0';
+
     i--;
     p++; /* jump to the next character so the next `fetch_token' doesn't start
             lexing at the closing '"' */
@@ -0,0 +1,372 @@
+/*
+ *
+ * list.c
+ *
+ * Created at:  Mon Oct 19 03:34:12 2026 03:34:12
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+/*
+ * The lists (see list.h).
+ *
+ * A list is a tree, of (at most) NOB_LIST_WIDTH slots in every node, with the
+ * elements in the leaves, in order. The nodes are the OT_LIST objects
+ * themselves (see `struct nob_list`), so the collector takes care of them,
+ * and since they never change either, any number of lists can share them: a
+ * new version of a list copies only the nodes on the way from the root to
+ * wherever it differs, and points to the old ones elsewhere.
+ *
+ * The nodes are not necessarily full (which is what lets two lists be
+ * concatenated without copying either one), so every node above the leaves
+ * knows how many elements there are below each one of its children (the
+ * sizes). Wherever the nodes are full, the size of the children tells which
+ * one of them an element is in right away, and the sizes only make up for
+ * the ones which are not. The concatenation keeps the number of nodes on
+ * every level close to the least it could be (see `list_rebalance`), so that
+ * the tree stays about as shallow as a full one would be.
+ *
+ * Getting an element, replacing it, or appending one takes time proportional
+ * to the tree's height (a full tree holding the most elements a list can
+ * have is 7 levels high). Concatenating two lists, or taking a slice of one,
+ * takes the same, times the width of a node (at the seams).
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "list.h"
+#include "mem.h"
+#include "nob.h"
+#include "util.h"
+
+#define LIST_WIDTH NOB_LIST_WIDTH
+/* log2(LIST_WIDTH) */
+#define LIST_BITS 5
+/* how many more nodes than the least they'd fit in a level is allowed to have
+ * at the seam of a concatenation */
+#define LIST_SLACK 2
+
+/* returns the <node> without the nodes of only one child on top of it */
+static Nob *list_root(Nob *node)
+{
+  /* {{{ */
+  while (NOB_GET_LIST(node)->height > 0 && NOB_GET_LIST(node)->n == 1)
+    node = NOB_GET_LIST(node)->slots[0];
+
+  return node;
+  /* }}} */
+}
+
+/*
+ * Returns which of the children of the <node> (above the leaves) the <*i>th
+ * element is in, making the <*i> the element's index in that child.
+ */
+static unsigned list_child(struct nob_list *node, unsigned *i)
+{
+  /* {{{ */
+  unsigned *sizes = NOB_LIST_SIZES(node);
+  unsigned shift = LIST_BITS * node->height;
+  unsigned j;
+
+  /* none of the children has more elements than a full one would, so it can't
+   * be any of the children before the one it would be in if they were all
+   * full */
+  j = shift < sizeof(unsigned) * 8 ? *i >> shift : 0;
+
+  while (sizes[j] <= *i)
+    j++;
+
+  if (j > 0)
+    *i -= sizes[j - 1];
+
+  return j;
+  /* }}} */
+}
+
+Nob *list_from(struct nob_type *type, unsigned length, Nob **elems)
+{
+  /* {{{ */
+  unsigned height = 0, n, i;
+  Nob **level, *ret;
+
+  if (length <= LIST_WIDTH)
+    return new_nob(type, 0, length, elems);
+
+  /* the leaves first, and then every level on top of the one before, all of
+   * the nodes full (but the last ones) */
+  n = (length + LIST_WIDTH - 1) / LIST_WIDTH;
+  level = nmalloc(sizeof(Nob *) * n);
+
+  for (i = 0; i < n; i++)
+    level[i] = new_nob(type, 0, MIN(LIST_WIDTH, length - i * LIST_WIDTH),
+        elems + i * LIST_WIDTH);
+
+  while (n > 1){
+    height++;
+
+    /* (a node is made before its place in the <level> gets overwritten) */
+    for (i = 0; i * LIST_WIDTH < n; i++)
+      level[i] = new_nob(type, height, MIN(LIST_WIDTH, n - i * LIST_WIDTH),
+          level + i * LIST_WIDTH);
+
+    n = i;
+  }
+
+  ret = level[0];
+  nfree(level);
+
+  return ret;
+  /* }}} */
+}
+
+Nob *list_get(Nob *list, unsigned i)
+{
+  /* {{{ */
+  struct nob_list *node = NOB_GET_LIST(list);
+
+  assert(i < node->length);
+
+  while (node->height > 0)
+    node = NOB_GET_LIST(node->slots[list_child(node, &i)]);
+
+  return node->slots[i];
+  /* }}} */
+}
+
+/* returns a copy of the <ob>'s node, with its <i>th element being the <value> */
+static Nob *list_set_node(Nob *ob, unsigned i, Nob *value)
+{
+  /* {{{ */
+  struct nob_list *node = NOB_GET_LIST(ob);
+  Nob *slots[LIST_WIDTH];
+  unsigned j;
+
+  memcpy(slots, node->slots, sizeof(Nob *) * node->n);
+
+  if (node->height == 0){
+    slots[i] = value;
+  } else {
+    j = list_child(node, &i);
+    slots[j] = list_set_node(node->slots[j], i, value);
+  }
+
+  return new_nob(ob->type, node->height, node->n, slots);
+  /* }}} */
+}
+
+Nob *list_set(Nob *list, unsigned i, Nob *value)
+{
+  assert(i < list_length(list));
+
+  return list_set_node(list, i, value);
+}
+
+/*
+ * Makes (at most) two nodes of the <height> out of the <n> <slots> (at most
+ * twice as many as fit in a node), putting them in the <out>. Returns how
+ * many it made.
+ */
+static unsigned list_pack(struct nob_type *type, unsigned height, Nob **slots,
+    unsigned n, Nob **out)
+{
+  /* {{{ */
+  if (n <= LIST_WIDTH){
+    out[0] = new_nob(type, height, n, slots);
+    return 1;
+  }
+
+  out[0] = new_nob(type, height, LIST_WIDTH, slots);
+  out[1] = new_nob(type, height, n - LIST_WIDTH, slots + LIST_WIDTH);
+
+  return 2;
+  /* }}} */
+}
+
+/*
+ * The <n> <nodes> (of the same height, which are going to be the children of
+ * one or two nodes) were put together from two different lists, so there
+ * could be quite a few of them that are far from full. If there are too many
+ * of them, the slots of those which are not (almost) full get spread over the
+ * ones after them, until they fit in few enough.
+ *
+ * Returns how many of the <nodes> there are afterwards.
+ */
+static unsigned list_rebalance(struct nob_type *type, Nob **nodes, unsigned n)
+{
+  /* {{{ */
+  /* (a node's worth of slots carried over, and the next node's) */
+  Nob *carry[LIST_WIDTH * 2];
+  struct nob_list *node;
+  unsigned total = 0, least, height, i, j, c, k;
+
+  for (i = 0; i < n; i++)
+    total += NOB_GET_LIST(nodes[i])->n;
+
+  least = (total + LIST_WIDTH - 1) / LIST_WIDTH;
+
+  for (i = 0; n > least + LIST_SLACK; ){
+    /* the first node which is not (almost) full */
+    while (i < n && NOB_GET_LIST(nodes[i])->n >= LIST_WIDTH - LIST_SLACK / 2)
+      i++;
+
+    if (i == n)
+      break;
+
+    node = NOB_GET_LIST(nodes[i]);
+    height = node->height;
+    c = node->n;
+    memcpy(carry, node->slots, sizeof(Nob *) * c);
+
+    /* the nodes after it take as many of the slots carried over as they can,
+     * and carry over the ones of their own they can't keep */
+    for (j = i + 1; c > 0 && j < n; j++){
+      node = NOB_GET_LIST(nodes[j]);
+      memcpy(carry + c, node->slots, sizeof(Nob *) * node->n);
+      c += node->n;
+      k = MIN(c, LIST_WIDTH);
+
+      nodes[j - 1] = new_nob(type, height, k, carry);
+      memmove(carry, carry + k, sizeof(Nob *) * (c - k));
+      c -= k;
+    }
+
+    if (c > 0){
+      /* they were all (almost) full after all */
+      nodes[n - 1] = new_nob(type, height, c, carry);
+      break;
+    }
+
+    /* the nodes from the <j>th one on are left as they were, one place
+     * earlier */
+    memmove(nodes + j - 1, nodes + j, sizeof(Nob *) * (n - j));
+    n--;
+  }
+
+  return n;
+  /* }}} */
+}
+
+/*
+ * Puts the nodes of the <left> and the <right> ones together, into (at most)
+ * two nodes of the height of the higher one of them, putting them in the
+ * <out>. Returns how many it made.
+ *
+ * It goes down the right edge of the <left> one, and the left edge of the
+ * <right> one, until the nodes are leaves on both sides, and makes the nodes
+ * on the way back up of whatever was on both sides of the seam.
+ */
+static unsigned list_join(Nob *left, Nob *right, Nob **out)
+{
+  /* {{{ */
+  struct nob_list *l = NOB_GET_LIST(left), *r = NOB_GET_LIST(right);
+  Nob *slots[LIST_WIDTH * 2], *seam[2];
+  unsigned height = MAX(l->height, r->height);
+  unsigned n = 0, k;
+
+  if (height == 0){
+    memcpy(slots, l->slots, sizeof(Nob *) * l->n);
+    memcpy(slots + l->n, r->slots, sizeof(Nob *) * r->n);
+
+    return list_pack(left->type, 0, slots, l->n + r->n, out);
+  }
+
+  /* whichever side is lower is put together with the other side's edge */
+  if (l->height == height)
+    k = list_join(l->slots[l->n - 1], r->height == height ? r->slots[0] : right, seam);
+  else
+    k = list_join(left, r->slots[0], seam);
+
+  if (l->height == height){
+    memcpy(slots, l->slots, sizeof(Nob *) * (l->n - 1));
+    n = l->n - 1;
+  }
+
+  memcpy(slots + n, seam, sizeof(Nob *) * k);
+  n += k;
+
+  if (r->height == height){
+    memcpy(slots + n, r->slots + 1, sizeof(Nob *) * (r->n - 1));
+    n += r->n - 1;
+  }
+
+  n = list_rebalance(left->type, slots, n);
+
+  return list_pack(left->type, height, slots, n, out);
+  /* }}} */
+}
+
+Nob *list_concat(Nob *left, Nob *right)
+{
+  /* {{{ */
+  Nob *out[2];
+
+  if (list_length(left) == 0)
+    return right;
+
+  if (list_length(right) == 0)
+    return left;
+
+  if (list_join(left, right, out) == 1)
+    return list_root(out[0]);
+
+  return new_nob(left->type, NOB_GET_LIST(out[0])->height + 1, 2, out);
+  /* }}} */
+}
+
+/*
+ * Returns a node of the height of the <ob>'s, of its elements from the
+ * <from>th one up to the <to>th one (of which there's at least one).
+ */
+static Nob *list_slice_node(Nob *ob, unsigned from, unsigned to)
+{
+  /* {{{ */
+  struct nob_list *node = NOB_GET_LIST(ob);
+  Nob *slots[LIST_WIDTH];
+  unsigned first = from, last = to - 1;
+  unsigned i, j, n = 0;
+
+  if (from == 0 && to == node->length)
+    return ob;
+
+  if (node->height == 0)
+    return new_nob(ob->type, 0, to - from, node->slots + from);
+
+  i = list_child(node, &first);
+  j = list_child(node, &last);
+
+  if (i == j){
+    /* (the nodes with only one child are dropped at the top, see
+     * `list_root`) */
+    slots[n++] = list_slice_node(node->slots[i], first, last + 1);
+  } else {
+    slots[n++] = list_slice_node(node->slots[i], first,
+        list_length(node->slots[i]));
+    memcpy(slots + n, node->slots + i + 1, sizeof(Nob *) * (j - i - 1));
+    n += j - i - 1;
+    slots[n++] = list_slice_node(node->slots[j], 0, last + 1);
+  }
+
+  return new_nob(ob->type, node->height, n, slots);
+  /* }}} */
+}
+
+Nob *list_slice(Nob *list, unsigned from, unsigned to)
+{
+  /* {{{ */
+  assert(from <= to && to <= list_length(list));
+
+  if (from == to)
+    return new_nob(list->type, 0, 0, NULL);
+
+  return list_root(list_slice_node(list, from, to));
+  /* }}} */
+}
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
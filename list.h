@@ -0,0 +1,45 @@
+/*
+ *
+ * list.h
+ *
+ * Created at:  Mon Oct 19 03:34:12 2026 03:34:12
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+#ifndef LIST_H
+#define LIST_H
+
+#include "nob.h"
+
+/*
+ * The lists never change once they're created: every function below returns
+ * a new one (sharing whatever it can with the ones it was given), and leaves
+ * those be.
+ */
+
+/* the number of elements in the <list> (an OT_LIST Nob) */
+#define list_length(list) (NOB_GET_LIST(list)->length)
+
+/* returns a list of the <type> of the <length> <elems>, in order */
+Nob *list_from(struct nob_type *type, unsigned length, Nob **elems);
+/* returns the <i>th element of the <list> (which has to be there) */
+Nob *list_get(Nob *list, unsigned i);
+/* returns the <list> with its <i>th element (which has to be there) being the
+ * <value> */
+Nob *list_set(Nob *list, unsigned i, Nob *value);
+/* returns the <left> list followed by the <right> one */
+Nob *list_concat(Nob *left, Nob *right);
+/* returns the elements of the <list> from the <from>th one up to (but not
+ * including) the <to>th one (from <= to <= length) */
+Nob *list_slice(Nob *list, unsigned from, unsigned to);
+
+#endif /* LIST_H */
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
@@ -10,33 +10,324 @@
  *
  */
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 
+#include "alloc.h"
 #include "config.h"
 #include "debug.h"
 #include "mem.h"
 
+#if DEBUG
+#include <pthread.h>
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#endif
+#endif /* DEBUG */
+
 /* see how many mallocs/callocs/reallocs/frees there were */
-static unsigned counter = 0;
+#define counter (NM_ctx->mem_counter)
+
+#if DEBUG
+/*
+ * The allocation-site profiler (see `mem_profile_start`).
+ *
+ * Every site (a file and a line an allocation was made in) counts its
+ * allocations, and the bytes they took, and every pointer allocated since the
+ * profiler got started remembers its site and size, so that freeing it counts
+ * against the site's live bytes.
+ *
+ * The memory is allocated by whichever thread (the collector's marker has no
+ * context), so the profiler is the process's, and it has a lock of its own.
+ * Its own memory comes straight from malloc.
+ */
+/* how many buckets the table of sites has */
+#define PROFILE_SITES 1024
+/* how many frames of a site's backtrace are kept */
+#define PROFILE_FRAMES 12
+
+struct profile_site {
+  const char *file;
+  unsigned line;
+  /* "malloc", "calloc" or "realloc" (of the site's first allocation) */
+  const char *kind;
+  unsigned long count;
+  uint64_t bytes;
+  size_t live, peak;
+  /* the backtrace of the site's first allocation */
+  void *frames[PROFILE_FRAMES];
+  int nframes;
+  struct profile_site *next;
+};
+
+/* a pointer that was allocated (and is not freed yet) */
+struct profile_ptr {
+  void *ptr;
+  size_t size;
+  struct profile_site *site;
+  struct profile_ptr *next;
+};
+
+static struct {
+  bool enabled;
+  bool backtraces;
+  pthread_mutex_t lock;
+  unsigned long nsites;
+  struct profile_site *sites[PROFILE_SITES];
+  /* the live pointers (the number of buckets is a power of two) */
+  struct profile_ptr **ptrs;
+  size_t nptrs, ptrs_size;
+} profile = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static inline size_t profile_ptr_hash(void *ptr, size_t size)
+{
+  return ((uintptr_t)ptr >> 4) * 2654435761u & (size - 1);
+}
+
+static struct profile_site *profile_site(const char *file, unsigned line,
+    const char *kind)
+{
+  /* {{{ */
+  unsigned hash = (line * 2654435761u) % PROFILE_SITES;
+  struct profile_site *site;
+
+  /* (the same file could be named by different literals) */
+  for (site = profile.sites[hash]; site != NULL; site = site->next)
+    if (site->line == line && (site->file == file || !strcmp(site->file, file)))
+      return site;
+
+  if ((site = calloc(1, sizeof(struct profile_site))) == NULL)
+    return NULL;
+
+  site->file = file;
+  site->line = line;
+  site->kind = kind;
+#if defined(__GLIBC__)
+  if (profile.backtraces)
+    site->nframes = backtrace(site->frames, PROFILE_FRAMES);
+#endif
+  site->next = profile.sites[hash];
+  profile.sites[hash] = site;
+  profile.nsites++;
+
+  return site;
+  /* }}} */
+}
+
+static void profile_grow(void)
+{
+  /* {{{ */
+  size_t size = profile.ptrs_size ? profile.ptrs_size * 2 : 4096;
+  struct profile_ptr **ptrs, *p, *next;
+  size_t i, hash;
+
+  if ((ptrs = calloc(size, sizeof(struct profile_ptr *))) == NULL)
+    return;
+
+  for (i = 0; i < profile.ptrs_size; i++){
+    for (p = profile.ptrs[i]; p != NULL; p = next){
+      next = p->next;
+      hash = profile_ptr_hash(p->ptr, size);
+      p->next = ptrs[hash];
+      ptrs[hash] = p;
+    }
+  }
+
+  free(profile.ptrs);
+  profile.ptrs = ptrs;
+  profile.ptrs_size = size;
+  /* }}} */
+}
+
+/* forgets the <ptr> (if it was counted), which is freed */
+static void profile_forget(void *ptr)
+{
+  /* {{{ */
+  struct profile_ptr **p, *dead;
+
+  if (ptr == NULL || profile.ptrs == NULL)
+    return;
+
+  for (p = &profile.ptrs[profile_ptr_hash(ptr, profile.ptrs_size)]; *p != NULL;
+      p = &(*p)->next){
+    if ((*p)->ptr == ptr){
+      dead = *p;
+      *p = dead->next;
+      dead->site->live -= dead->size;
+      profile.nptrs--;
+      free(dead);
+      return;
+    }
+  }
+  /* }}} */
+}
+
+/* counts the <size> bytes at <ptr> as allocated by the <kind> in the <file> at
+ * the <line> */
+static void profile_alloc(void *ptr, size_t size, const char *kind,
+    const char *file, unsigned line)
+{
+  /* {{{ */
+  struct profile_site *site;
+  struct profile_ptr *p;
+  size_t hash;
+
+  pthread_mutex_lock(&profile.lock);
+
+  if ((site = profile_site(file, line, kind)) == NULL)
+    goto out;
+
+  site->count++;
+  site->bytes += size;
+  site->live += size;
+
+  if (site->live > site->peak)
+    site->peak = site->live;
+
+  if (profile.nptrs >= profile.ptrs_size)
+    profile_grow();
+
+  if (profile.ptrs == NULL || (p = malloc(sizeof(struct profile_ptr))) == NULL)
+    goto out;
+
+  hash = profile_ptr_hash(ptr, profile.ptrs_size);
+  p->ptr = ptr;
+  p->size = size;
+  p->site = site;
+  p->next = profile.ptrs[hash];
+  profile.ptrs[hash] = p;
+  profile.nptrs++;
+
+out:
+  pthread_mutex_unlock(&profile.lock);
+  /* }}} */
+}
+
+static void profile_free(void *ptr)
+{
+  pthread_mutex_lock(&profile.lock);
+  profile_forget(ptr);
+  pthread_mutex_unlock(&profile.lock);
+}
+
+void mem_profile_start(int backtraces)
+{
+  profile.backtraces = backtraces;
+  __atomic_store_n(&profile.enabled, true, __ATOMIC_RELEASE);
+}
+
+/* the biggest allocators come first */
+static int profile_compare(const void *a, const void *b)
+{
+  /* {{{ */
+  const struct profile_site *x = *(struct profile_site * const *)a;
+  const struct profile_site *y = *(struct profile_site * const *)b;
+
+  if (x->bytes != y->bytes)
+    return x->bytes < y->bytes ? 1 : -1;
+
+  return x->count < y->count ? 1 : x->count > y->count ? -1 : 0;
+  /* }}} */
+}
+
+void mem_profile_report(FILE *fp)
+{
+  /* {{{ */
+  struct profile_site **sites, *site, *next;
+  struct profile_ptr *p, *pnext;
+  unsigned long i, n = 0;
+
+  if (!profile.enabled)
+    return;
+
+  pthread_mutex_lock(&profile.lock);
+
+  if ((sites = malloc(sizeof(struct profile_site *) * (profile.nsites + 1))) == NULL)
+    goto out;
+
+  for (i = 0; i < PROFILE_SITES; i++)
+    for (site = profile.sites[i]; site != NULL; site = site->next)
+      sites[n++] = site;
+
+  qsort(sites, n, sizeof(struct profile_site *), profile_compare);
+
+  fprintf(fp, "\nnemo: %lu allocation sites (live is what's not freed yet)\n",
+      n);
+  fprintf(fp, "\n%10s %14s %12s %12s  %-8s %s\n", "count", "bytes", "live",
+      "peak", "kind", "site");
+
+  for (i = 0; i < n; i++){
+    site = sites[i];
+
+    fprintf(fp, "%10lu %14llu %12zu %12zu  %-8s %s:%u\n", site->count,
+        (unsigned long long)site->bytes, site->live, site->peak, site->kind,
+        site->file, site->line);
+
+#if defined(__GLIBC__)
+    if (site->nframes > 0){
+      fflush(fp);
+      backtrace_symbols_fd(site->frames, site->nframes, fileno(fp));
+      fputc('\n', fp);
+    }
+#endif
+  }
+
+  free(sites);
+
+out:
+  /* it's the end of it */
+  profile.enabled = false;
+
+  for (i = 0; i < PROFILE_SITES; i++){
+    for (site = profile.sites[i]; site != NULL; site = next){
+      next = site->next;
+      free(site);
+    }
+
+    profile.sites[i] = NULL;
+  }
+
+  for (i = 0; i < profile.ptrs_size; i++){
+    for (p = profile.ptrs[i]; p != NULL; p = pnext){
+      pnext = p->next;
+      free(p);
+    }
+  }
+
+  free(profile.ptrs);
+  profile.ptrs = NULL;
+  profile.nptrs = profile.ptrs_size = profile.nsites = 0;
+
+  pthread_mutex_unlock(&profile.lock);
+  /* }}} */
+}
+
+#define PROFILING() __atomic_load_n(&profile.enabled, __ATOMIC_ACQUIRE)
+#endif /* DEBUG */
 
 void *nmalloc_(size_t size, const char *file, unsigned line)
 {
   void *ptr;
 
-  if ((ptr = malloc(size)) == NULL){
+  if ((ptr = pool_alloc(size)) == NULL && (ptr = malloc(size)) == NULL){
     fprintf(stderr, "malloc couldn't allocate %zu bytes in %s line %u\n", size, file, line);
     exit(1);
   }
 
 #if DEBUG
-  if (NM_DEBUG_GET_FLAG(NM_DEBUG_MEM)){
+  if (PROFILING())
+    profile_alloc(ptr, size, "malloc", file, line);
+
+  if (NM_ctx != NULL && NM_DEBUG_GET_FLAG(NM_DEBUG_MEM)){
     counter++;
     fprintf(stderr, "%p: (%05u) malloc %zu bytes (%s:%u)\n", ptr, counter, size, file, line);
   }
 #else /* DEBUG */
   /* suspress warnings */
-  (void)counter;
   (void)file;
   (void)line;
 #endif /* DEBUG */
@@ -48,19 +339,25 @@ void *ncalloc_(size_t number, size_t size, const char *file, unsigned line)
 {
   void *ptr;
 
-  if ((ptr = calloc(number, size)) == NULL){
+  /* (there's no overflow either way) */
+  if (number <= POOL_MAX && size <= POOL_MAX &&
+      (ptr = pool_alloc(number * size)) != NULL)
+    memset(ptr, 0, number * size);
+  else if ((ptr = calloc(number, size)) == NULL){
     fprintf(stderr, "calloc failed to allocate %zu (%zux%zu) bytes in %s line %u\n", number * size, number, size, file, line);
     exit(1);
   }
 
 #if DEBUG
-  if (NM_DEBUG_GET_FLAG(NM_DEBUG_MEM)){
+  if (PROFILING())
+    profile_alloc(ptr, number * size, "calloc", file, line);
+
+  if (NM_ctx != NULL && NM_DEBUG_GET_FLAG(NM_DEBUG_MEM)){
     counter++;
     fprintf(stderr, "%p: (%05u) calloc %zu (%zux%zu) bytes (%s:%u)\n", ptr, counter, number * size, number, size, file, line);
   }
 #else /* DEBUG */
   /* suspress warnings */
-  (void)counter;
   (void)file;
   (void)line;
 #endif /* DEBUG */
@@ -71,20 +368,40 @@ void *ncalloc_(size_t number, size_t size, const char *file, unsigned line)
 void *nrealloc_(void *ptr, size_t size, const char *file, unsigned line)
 {
   void *p;
+  size_t old;
 
-  if ((p = realloc(ptr, size)) == NULL){
+#if DEBUG
+  /* (it's counted anew, wherever it ends up) */
+  if (PROFILING())
+    profile_free(ptr);
+#endif /* DEBUG */
+
+  if ((old = pool_size(ptr)) > 0){
+    /* the pools' cells stay where they are as long as they're big enough */
+    if (size <= old)
+      p = ptr;
+    else if ((p = pool_alloc(size)) != NULL || (p = malloc(size)) != NULL){
+      memcpy(p, ptr, old);
+      pool_free(ptr);
+    }
+  } else
+    p = realloc(ptr, size);
+
+  if (p == NULL){
     fprintf(stderr, "realloc couldn't reallocate %zu bytes in %s line %u\n", size, file, line);
     exit(1);
   }
 
 #if DEBUG
-  if (NM_DEBUG_GET_FLAG(NM_DEBUG_MEM)){
+  if (PROFILING())
+    profile_alloc(p, size, "realloc", file, line);
+
+  if (NM_ctx != NULL && NM_DEBUG_GET_FLAG(NM_DEBUG_MEM)){
     counter++;
     fprintf(stderr, "%p: (%05u) realloc %zu bytes (%s:%u)\n", ptr, counter, size, file, line);
   }
 #else /* DEBUG */
   /* suspress warnings */
-  (void)counter;
   (void)file;
   (void)line;
 #endif /* DEBUG */
@@ -95,19 +412,22 @@ void *nrealloc_(void *ptr, size_t size, const char *file, unsigned line)
 void nfree_(void *ptr, const char *file, unsigned line)
 {
 #if DEBUG
-  if (NM_DEBUG_GET_FLAG(NM_DEBUG_MEM)){
+  if (PROFILING())
+    profile_free(ptr);
+
+  if (NM_ctx != NULL && NM_DEBUG_GET_FLAG(NM_DEBUG_MEM)){
     counter++;
     fprintf(stderr, "%p: (%05u) free (%s:%u)\n", ptr, counter, file, line);
   }
 #else /* DEBUG */
   /* suspress warnings */
-  (void)counter;
   (void)file;
   (void)line;
 #endif /* DEBUG */
 
   /* free what's 'under' the pointer */
-  free(ptr);
+  if (!pool_free(ptr))
+    free(ptr);
   /* 'invalidate' it */
   ptr = (unsigned char *)0x1;
 }
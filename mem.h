@@ -28,6 +28,18 @@ void *nrealloc_(void *ptr, size_t size, const char *file, unsigned line);
 #define nfree(p) nfree_(p, __FILE__, __LINE__)
 void nfree_(void *ptr, const char *file, unsigned line);
 
+/* (it's only there if config.h is included before) */
+#if DEBUG
+/*
+ * Makes every allocation (of every thread) from now on count against its site
+ * (the file and the line it was made in), along with the site's <backtraces>
+ * (where supported), until `mem_profile_report` prints the sites out, the
+ * ones which allocated the most first.
+ */
+void mem_profile_start(int backtraces);
+void mem_profile_report(FILE *fp);
+#endif /* DEBUG */
+
 #endif /* MEM_H */
 
 /*
@@ -46,17 +46,20 @@
 
 #include "ast.h"
 #include "config.h"
+#include "context.h"
 #include "debug.h"
 #include "infer.h"
+#include "jit.h"
 #include "mem.h"
+#include "opt.h"
 #include "parser.h"
+#include "profile.h"
+#include "tier.h"
 #include "version.h"
 #include "util.h"
 #include "nob.h"
 
-/* the output file in case we are compiling */
-FILE *outfile;
-/* and it's name */
+/* the name of the output file in case we are compiling */
 char outfilename[32];
 
 int main(int argc, char *argv[])
@@ -68,11 +71,22 @@ int main(int argc, char *argv[])
   int ret = 0;
   /* the top-most node created from parsing */
   struct node *root;
-  /* THE scope */
-  struct scope *_main = new_scope("main", NULL);
+  /* the most its statements keep on the argument stack */
+  unsigned stack;
+  /* the interpreter (with THE scope) */
+  struct nemo_ctx *ctx;
 
   /* are we compiling? */
   bool compile = false;
+  /* are we profiling (option `-P`)? */
+  bool profile = false;
+  /* how hard should the AST be optimized (option `-O`) */
+  unsigned opt_level = NM_OPT_DEFAULT;
+  /* the size of the frame stack, in KiB (option `-s`) */
+  unsigned long frame_stack_size = NM_FRAME_STACK_DEFAULT;
+  /* how many calls can the program make, 0 being no limit (option `-f`) */
+  unsigned long fuel = 0;
+  char *endptr;
 
   if (((locale = getenv("LC_ALL")) && *locale) ||
       ((locale = getenv("LC_CTYPE")) && *locale) ||
@@ -85,12 +99,11 @@ int main(int argc, char *argv[])
 
   setlocale(LC_ALL, "");
 
-  /* initialize the argument stack */
-  arg_stack_init();
-  /* initialize the types (which includes creating the standard types) and everything related */
-  types_init();
+  /* create the interpreter, and make it the one all of libnemo uses */
+  ctx = nemo_ctx_new();
+  nemo_ctx_enter(ctx);
 
-  while ((ch = getopt(argc, argv, "cd:v")) != -1){
+  while ((ch = getopt(argc, argv, "cd:f:vO:Ps:t:")) != -1){
     switch (ch){
       case 'c':
         compile = true;
@@ -101,12 +114,24 @@ int main(int argc, char *argv[])
           case 'a':
             NM_DEBUG_SET_FLAG(NM_DEBUG_AST);
             break;
+          case 'g':
+            NM_DEBUG_SET_FLAG(NM_DEBUG_GC);
+            break;
+          case 'G':
+            NM_DEBUG_SET_FLAG(NM_DEBUG_GC | NM_DEBUG_GC_JSON);
+            break;
           case 'l':
             NM_DEBUG_SET_FLAG(NM_DEBUG_LEXER);
             break;
           case 'm':
             NM_DEBUG_SET_FLAG(NM_DEBUG_MEM);
             break;
+          case 'M':
+            mem_profile_start(false);
+            break;
+          case 'B':
+            mem_profile_start(true);
+            break;
           case 'p':
             NM_DEBUG_SET_FLAG(NM_DEBUG_PARSER);
             break;
@@ -116,8 +141,12 @@ int main(int argc, char *argv[])
           case 'h':
             fprintf(stderr, "\nAvailable debug flags:\n");
             fprintf(stderr, "  a    AST node creation/execution\n");
+            fprintf(stderr, "  g    the garbage collector's pauses, and its stats at the end of execution\n");
+            fprintf(stderr, "  G    the same, with the stats in JSON\n");
             fprintf(stderr, "  l    lexer stuff; see what tokens were fetched\n");
             fprintf(stderr, "  m    see how much memory was malloced/freed, etc.\n");
+            fprintf(stderr, "  M    count the allocations by their sites, and list the sites at the end\n");
+            fprintf(stderr, "  B    the same, with the sites' backtraces\n");
             fprintf(stderr, "  p    parser stuff; see a primitive representation of the parsing process\n");
             fprintf(stderr, "  t    dump the object types at the end of execution\n");
             fprintf(stderr, "\n");
@@ -134,6 +163,42 @@ int main(int argc, char *argv[])
         return 1;
 #endif
         break;
+      case 'f':
+        fuel = strtoul(optarg, &endptr, 10);
+
+        if (*optarg == '\0' || *endptr != '\0' || *optarg == '-' || fuel == 0){
+          fprintf(stderr, "nemo: invalid fuel -f%s (it's the number of function"
+            " calls and loop iterations the program can make)\n", optarg);
+          return 1;
+        }
+        break;
+      case 'O':
+        if (*optarg < '0' || *optarg > '0' + NM_OPT_MAX || optarg[1] != '\0'){
+          fprintf(stderr, "nemo: invalid optimization level -O%s (the levels "
+            "are 0 through %d)\n", optarg, NM_OPT_MAX);
+          return 1;
+        }
+        opt_level = *optarg - '0';
+        break;
+      case 'P':
+        profile = true;
+        break;
+      case 't':
+        if (!tier_configure(optarg)){
+          fprintf(stderr, "nemo: invalid tiering option -t%s (it's a comma"
+            " separated list of: on, off, calls=N, loops=N, stats)\n", optarg);
+          return 1;
+        }
+        break;
+      case 's':
+        frame_stack_size = strtoul(optarg, &endptr, 10);
+
+        if (*optarg == '\0' || *endptr != '\0' || frame_stack_size == 0){
+          fprintf(stderr, "nemo: invalid frame stack size -s%s (it's the"
+            " number of KiB)\n", optarg);
+          return 1;
+        }
+        break;
       case 'v': printf("Nemo v%d.%d.%d, " __DATE__ " " __TIME__"\n",
                   NM_VERSION_MAJOR, NM_VERSION_MINOR, NM_VERSION_PATCH);
                 return 0;
@@ -145,13 +210,22 @@ int main(int argc, char *argv[])
   argc -= optind;
   argv += optind;
 
+  /* initialize the frame stack */
+  frame_stack_init(frame_stack_size);
+
+  if (fuel > 0)
+    nemo_ctx_fuel(ctx, fuel);
+
   if (argc >= 1){
-    if ((root = parse_file(argv[0], _main)) == NULL){
+    if ((root = parse_file(argv[0], ctx->main)) == NULL){
       fprintf(stderr, "nemo: execution failed :c\n");
       ret = 1;
       goto end;
     }
 
+    root = optimize(root, opt_level);
+    stack = chain_stack_depth(root);
+
     if (compile){
       char systemcall[128];
       char *noextname = strdup(argv[0]);
@@ -161,7 +235,7 @@ int main(int argc, char *argv[])
 
       snprintf(outfilename, sizeof(outfilename), "%s.asm", noextname);
 
-      if ((outfile = fopen(outfilename, "w")) == NULL){
+      if ((ctx->outfile = fopen(outfilename, "w")) == NULL){
         perror("nemo: fopen");
         exit(1);
       }
@@ -169,7 +243,7 @@ int main(int argc, char *argv[])
       /* compile the program (ie. write all the assembly out into <outfile>) */
       comp_nodes(root);
       /* close the assembly file so we can proceed and compile it */
-      fclose(outfile);
+      fclose(ctx->outfile);
 
       snprintf(systemcall, sizeof(systemcall), "nasm -g -f elf32 %s.asm -o %s.o", noextname, noextname);
       system(systemcall);
@@ -177,9 +251,40 @@ int main(int argc, char *argv[])
       snprintf(systemcall, sizeof(systemcall), "ld -o %s %s.o", noextname, noextname);
       system(systemcall);
 
+      free(noextname);
+    } else if (profile){
+      char *noextname = strdup(argv[0]);
+      char *p = strrchr(noextname, '.');
+      FILE *folded;
+      /* remove the extension from the file name */
+      if (p) *p = '\0';
+
+      snprintf(outfilename, sizeof(outfilename), "%s.folded", noextname);
+
+      if ((folded = fopen(outfilename, "w")) == NULL){
+        perror("nemo: fopen");
+        exit(1);
+      }
+
+      /* the profiler wants to see everything interpreted */
+      NM_tiering.enabled = false;
+
+      profile_start(root);
+      exec_nodes(root, stack);
+      /* the report goes to stderr, the folded stacks (for the flame graphs)
+       * into <outfilename> */
+      profile_finish(argv[0], stderr, folded);
+
+      fclose(folded);
       free(noextname);
     } else
-      exec_nodes(root);
+      exec_nodes(root, stack);
+
+    if (nemo_ctx_out_of_fuel(ctx)){
+      fprintf(stderr, "\nnemo: the program ran out of fuel (%lu function calls"
+        " and loop iterations)\n", fuel);
+      ret = 2;
+    }
 
     /* TODO clean up after the parser, lexer, etc. */
   } else {
@@ -208,16 +313,16 @@ int main(int argc, char *argv[])
         input += 3;
       }
 
-      if ((root = parse_string("stdin", input, _main)) != NULL){
+      if ((root = parse_string("stdin", input, ctx->main)) != NULL){
         if (show_type){
           printf("%s : ", input);
 
-          if ((inferred_type = infer_node_type(_main, root)) != NULL)
+          if ((inferred_type = infer_node_type(ctx->main, root)) != NULL)
             nob_print_type(inferred_type);
 
           printf("\n");
         } else {
-          exec_nodes(root);
+          exec_nodes(root, chain_stack_depth(root));
         /* TODO clean up after the parser, lexer, etc. */
         }
       }
@@ -227,12 +332,20 @@ int main(int argc, char *argv[])
   if (NM_DEBUG_GET_FLAG(NM_DEBUG_TYPES))
     dump_types();
 
+  if (NM_tiering.stats)
+    tier_stats(stderr);
+
+  if (NM_DEBUG_GET_FLAG(NM_DEBUG_GC))
+    nemo_gc_report(ctx, stderr, NM_DEBUG_GET_FLAG(NM_DEBUG_GC_JSON));
+
 end:
-  /* the order quite matters */
-  arg_stack_finish();
-  gc_finish();
-  types_finish();
-  scopes_finish();
+  nemo_ctx_enter(NULL);
+  nemo_ctx_free(ctx);
+
+#ifdef DEBUG
+  /* (whatever is still live by now got leaked) */
+  mem_profile_report(stderr);
+#endif /* DEBUG */
 
   return ret;
 }
@@ -27,9 +27,6 @@
 /* one small, quite handy, typedef */
 typedef unsigned char byte_t;
 
-/* the file into which all the assembly will go */
-extern FILE *outfile;
-
 #endif /* NEMO_H */
 
 /*
@@ -10,138 +10,1544 @@
  *
  */
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdarg.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <math.h>
+#include <time.h>
+
+#include <sys/resource.h>
+
+#include "ast.h"
+#include "debug.h"
+#include "mem.h"
+#include "nob.h"
+#include "infnum.h"
+#include "util.h"
+#include "utf8.h"
+
+/*
+ * The objects, and the values they point to, are cut off from slabs, one kind
+ * of a slab per size class (8, 16, 32 and 64 bytes), so an allocation is
+ * (mostly) a matter of moving a pointer, and the objects are close to each
+ * other. The objects themselves have slabs of their own, so that the sweep
+ * (see the old generation below) can tell them apart from the values. The
+ * cells the sweep frees are reused first.
+ */
+#define GC_MIN_CELL 8
+#define GC_CLASSES 4
+#define GC_MAX_CELL (GC_MIN_CELL << (GC_CLASSES - 1))
+/* the objects' own class, after the values' ones */
+#define GC_NOB_CLASS GC_CLASSES
+/* <size> rounded up to the smallest cell's */
+#define GC_ROUND(size) (((size) + GC_MIN_CELL - 1) & ~(size_t)(GC_MIN_CELL - 1))
+#define GC_NOB_CELL GC_ROUND(sizeof(Nob))
+#define GC_CELL_SIZE(class) \
+  ((class) == GC_NOB_CLASS ? GC_NOB_CELL : (size_t)GC_MIN_CELL << (class))
+/* in bytes, the header included */
+#define GC_SLAB_SIZE (64 << 10)
+
+struct gc_slab {
+  struct gc_slab *next;
+  /* where the next cell is cut off from, and where the slab ends */
+  char *free, *end;
+};
+
+/* the cells begin right after the header, aligned as the biggest one */
+#define GC_SLAB_CELLS(slab) \
+  ((char *)(slab) + ((sizeof(struct gc_slab) + GC_MAX_CELL - 1) & ~(size_t)(GC_MAX_CELL - 1)))
+
+/* the memory that's too big for a cell */
+struct gc_large {
+  struct gc_large *next;
+  /* (keeps the memory after it aligned), 0 once the sweep found its owner
+   * dead */
+  size_t size;
+};
+
+/*
+ * The young generation.
+ *
+ * New objects (and the values they point to) are put one after another into
+ * the pool's nursery. Once it fills up, the interpreter gets to collect it at
+ * its next safe point (see `gc_minor_begin`): the objects still reachable
+ * from the roots are copied (promoted) into the slabs, and the nursery is
+ * reused from its beginning, dropping the rest of them at no cost. Until then
+ * the new objects go straight into the slabs.
+ *
+ * The roots are the stacks, whatever `gc_protect` was given, and the places
+ * outside the nursery which were made to point into it (the remembered set,
+ * see `gc_remember`); the objects don't change once created, so they only ever
+ * point at older ones.
+ */
+#define GC_NURSERY_SIZE (256 << 10)
+/* the most a new object can take along with its value */
+#define GC_MAX_YOUNG (sizeof(Nob) + sizeof(struct nob_fun) + GC_MAX_CELL)
+
+/*
+ * The old generation.
+ *
+ * Once enough got promoted (or allocated old) since the last time, a major
+ * collection begins, right after a minor one, when the nursery is empty. The
+ * interpreter stops only to have its roots (the stacks and the globals)
+ * marked, and a thread of the collection's own marks everything reachable
+ * from there (the frames on the heap included) while the interpreter carries
+ * on.
+ *
+ * It marks whatever was reachable at the beginning (a snapshot): the
+ * interpreter hands the marker every object it overwrites in a global or in a
+ * frame on the heap (see `gc_write`), and the objects created in the meantime
+ * are born marked. The objects are marked with the collection's number (the
+ * epoch), so they never need to be unmarked.
+ *
+ * Once the marker's done, the interpreter (at its next minor collection)
+ * marks whatever it handed over last, and then sweeps the slabs of objects, a
+ * few at every minor collection, freeing the objects that didn't get marked,
+ * along with their values.
+ */
+/* the least that gets allocated in the slabs between two major collections,
+ * in bytes (it's as much as there was alive after the last one otherwise) */
+#define GC_MAJOR_MIN (4 << 20)
+/* how many of the overwritten objects the interpreter gathers before handing
+ * them to the marker */
+#define GC_SATB_CHUNK 256
+/* how many slabs of objects are swept at a time */
+#define GC_SWEEP_STEP 8
+
+enum gc_phase {
+  GC_IDLE,
+  GC_MARKING,
+  GC_SWEEPING
+};
+
+struct gc_major {
+  enum gc_phase phase;
+  /* what the live objects are marked with */
+  uint32_t epoch;
+  /* the pool the collection is of (the marker can't reach for `NM_gc`) */
+  struct gc_pool *pool;
+  pthread_t marker;
+  /* is the marker a thread of its own (it's not if one couldn't be made) */
+  bool threaded;
+  pthread_mutex_t lock;
+  /* set (atomically) by the marker when it ran out of work, and by the
+   * interpreter when it has to stop */
+  int done, stop;
+  /* the objects marked, but whose insides are not yet (the marker's) */
+  Nob **grey;
+  size_t ngrey, grey_size;
+  /* the overwritten objects handed to the marker (under the <lock>) */
+  Nob **handed;
+  size_t nhanded, handed_size;
+  /* the ones not handed over yet (the interpreter's) */
+  Nob *satb[GC_SATB_CHUNK];
+  unsigned nsatb;
+  /* the slab of objects to be swept next */
+  struct gc_slab *sweep;
+  /* how many bytes the sweep found alive */
+  size_t live;
+  /* when the collection began */
+  uint64_t began;
+};
+
+/*
+ * The frames moved to the heap (see `capture_frame` in ast.c) are cut off from
+ * the slabs of values as well, each of them after a header of its own, which
+ * it's marked and swept by like an object. They are reached through the
+ * functions which closed over them, and through the frames on the stack.
+ */
+struct gc_frame {
+  struct gc_frame *next;
+  uint32_t mark;
+  /* the frame's, in bytes */
+  uint32_t size;
+};
+
+#define GC_FRAME(frame) ((struct gc_frame *)(frame) - 1)
+
+/* the objects whose values own some memory themselves (the infnums) */
+struct gc_final {
+  Nob *ob;
+  struct gc_final *next;
+};
+
+struct gc_pool {
+  /* the slabs of every class, the one being cut from first */
+  struct gc_slab *slabs[GC_CLASSES + 1];
+  /* the cells the sweep freed, of every class (linked through their first
+   * word, or the <ptr> of the objects, whose <type> is then NULL) */
+  void *free[GC_CLASSES + 1];
+  struct gc_large *large;
+  struct gc_final *finals;
+  /* the frames on the heap */
+  struct gc_frame *frames;
+  /* the nursery, where the next object is put at <young_free> */
+  char *young, *young_free, *young_end;
+  /* the remembered set */
+  Nob ***remembered;
+  size_t nremembered, remembered_size;
+  /* how much got allocated in the slabs since the last major collection began,
+   * and how much makes the next one begin */
+  size_t allocated, major_at;
+  /* how much the pool took from the system */
+  size_t heap;
+  struct gc_major major;
+  /* when the interpreter got stopped the last time (see `gc_report`) */
+  uint64_t paused;
+};
+
+/* the garbage collector's object pool (NULL being an empty one) */
+#define NM_gc (NM_ctx->gc)
+/* the slabs of the released pools, for the new ones to reuse */
+#define NM_gc_slabs (NM_ctx->gc_slabs)
+/* the last major collection's number (every pool's) */
+#define NM_gc_epoch (NM_ctx->gc_epoch)
+/* what the collector did so far (every pool's) */
+#define NM_gc_stats (NM_ctx->gc_stats)
+
+#define IS_YOUNG(pool, p) \
+  ((char *)(p) >= (pool)->young && (char *)(p) < (pool)->young_end)
+
+void types_init(void)
+{
+  /* create the standard types */
+  T_INT    = new_type(OT_INT);          T_INT->name    = strdup("int");
+  T_INFNUM = new_type(OT_INFNUM);       T_INFNUM->name = strdup("infnum");
+  T_CHAR   = new_type(OT_CHAR);         T_CHAR->name   = strdup("char");
+  T_REAL   = new_type(OT_REAL);         T_REAL->name   = strdup("real");
+
+  T_LIST   = new_type(OT_LIST, new_type(OT_TYPE_VARIABLE)); T_LIST->name = strdup("list");
+  T_STRING = new_type(OT_STRING);      T_STRING->name = strdup("string");
+
+  T_VOID   = new_type(OT_CUSTOM, "void", NULL);
+}
+
+void types_finish(void)
+{
+  struct types_list *curr, *next;
+
+  for (curr = NM_types; curr != NULL; curr = next){
+    next = curr->next;
+
+    if (!curr->type)
+      continue;
+
+    /* anonymous types don't have a name, so there's no point of freeing it */
+    /* I know that free(NULL) is practically a NOP, but, still */
+    nfree(curr->type->name);
+
+    /* free the type itself */
+    nfree(curr->type);
+  }
+}
+
+/*
+ * "Pushes" a given <type> to the NM_types array.
+ */
+void push_type(struct nob_type *type)
+{
+  struct types_list *new = nmalloc(sizeof(struct types_list));
+
+  new->type = type;
+  new->next = NM_types;
+  NM_types  = new;
+}
+
+/* {{{ Functions related with Garbage Collector (init, finish, etc) */
+static uint64_t now(void)
+{
+  /* {{{ */
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+  /* }}} */
+}
+
+/*
+ * Counts in the <pauses> how long the interpreter was stopped (since the
+ * <pool>'s <paused>) for the <what>, and lets know about it (with the debug
+ * flag -dg).
+ */
+static void gc_report(struct gc_pool *pool, struct nemo_gc_pauses *pauses,
+    const char *what)
+{
+  /* {{{ */
+  uint64_t took = now() - pool->paused;
+  unsigned bucket = 0;
+
+  pauses->count++;
+  pauses->total += took;
+
+  if (took > pauses->longest)
+    pauses->longest = took;
+
+  while (bucket < NM_GC_HISTOGRAM - 1 && took / 1000 >= (uint64_t)1 << bucket)
+    bucket++;
+
+  pauses->histogram[bucket]++;
+
+#if DEBUG
+  /* (not with -dG, it'd end up in the middle of the JSON, see nemo.c) */
+  if (NM_DEBUG_GET_FLAG(NM_DEBUG_GC) && !NM_DEBUG_GET_FLAG(NM_DEBUG_GC_JSON))
+    fprintf(stderr, "gc: %s took %.3f ms\n", what, took / 1e6);
+#else
+  /* suspress warnings */
+  (void)what;
+#endif /* DEBUG */
+  /* }}} */
+}
+
+static void gc_major_abandon(struct gc_pool *pool);
+
+void gc_finish(void)
+{
+  struct gc_slab *slab, *next;
+
+  gc_free_pool(NM_gc);
+  NM_gc = NULL;
+
+  for (slab = NM_gc_slabs; slab != NULL; slab = next){
+    next = slab->next;
+    nfree(slab);
+  }
+
+  NM_gc_slabs = NULL;
+  nfree(NM_ctx->gc_nursery);
+  NM_ctx->gc_nursery = NULL;
+  nfree(NM_ctx->gc_work);
+  NM_ctx->gc_work = NULL;
+  nfree(NM_gc_stats);
+  NM_gc_stats = NULL;
+}
+
+/*
+ * Makes the new objects go into the <pool> (NULL being an empty one) from now
+ * on, and returns the one they went into before.
+ *
+ * A major collection of the pool that's swapped out can carry on marking, as
+ * nothing can reach its objects in the meantime.
+ */
+struct gc_pool *gc_swap_pool(struct gc_pool *pool)
+{
+  struct gc_pool *prev = NM_gc;
+
+  NM_gc = pool;
+  /* that was the other pool's nursery */
+  NM_ctx->gc_pending = false;
+
+  return prev;
+}
+
+void gc_free_pool(struct gc_pool *pool)
+{
+  /* {{{ */
+  struct gc_final *final;
+  struct gc_large *large, *next;
+  struct gc_slab *slab, *last;
+  unsigned i;
+
+  if (pool == NULL)
+    return;
+
+  gc_major_abandon(pool);
+
+  NM_gc_stats->allocated += (pool->young_free - pool->young) + pool->allocated;
+
+  for (final = pool->finals; final != NULL; final = final->next)
+    free_infnum(NOB_GET_INFNUM(final->ob));
+
+  for (large = pool->large; large != NULL; large = next){
+    next = large->next;
+    nfree(large);
+  }
+
+  /* the slabs are kept for the next pools */
+  for (i = 0; i <= GC_NOB_CLASS; i++){
+    if ((slab = pool->slabs[i]) == NULL)
+      continue;
+
+    for (last = slab; last->next != NULL; last = last->next)
+      ;
+
+    last->next = NM_gc_slabs;
+    NM_gc_slabs = slab;
+  }
+
+  /* so is the nursery (one of them, that is) */
+  if (NM_ctx->gc_nursery == NULL)
+    NM_ctx->gc_nursery = pool->young;
+  else
+    nfree(pool->young);
+
+  nfree(pool->remembered);
+  nfree(pool->major.grey);
+  nfree(pool->major.handed);
+  nfree(pool);
+  /* }}} */
+}
+
+static struct gc_pool *gc_pool(void)
+{
+  /* {{{ */
+  struct gc_pool *pool = NM_gc;
+
+  if (pool != NULL)
+    return pool;
+
+  pool = NM_gc = ncalloc(1, sizeof(struct gc_pool));
+
+  if (NM_gc_stats == NULL)
+    NM_gc_stats = ncalloc(1, sizeof(struct nemo_gc_stats));
+
+  if ((pool->young = NM_ctx->gc_nursery) != NULL)
+    NM_ctx->gc_nursery = NULL;
+  else
+    pool->young = nmalloc(GC_NURSERY_SIZE);
+
+  pool->young_free = pool->young;
+  pool->young_end = pool->young + GC_NURSERY_SIZE;
+  pool->major_at = GC_MAJOR_MIN;
+  pool->heap = GC_NURSERY_SIZE;
+
+  return pool;
+  /* }}} */
+}
+
+/* the class of the cells <size> bytes fit in (GC_CLASSES if none) */
+static inline unsigned gc_class(size_t size)
+{
+  /* {{{ */
+  unsigned class = 0;
+  size_t cell = GC_MIN_CELL;
+
+  while (cell < size && class < GC_CLASSES){
+    cell <<= 1;
+    class++;
+  }
+
+  return class;
+  /* }}} */
+}
+
+static void *gc_alloc_large(struct gc_pool *pool, size_t size)
+{
+  /* {{{ */
+  struct gc_large *large = nmalloc(sizeof(struct gc_large) + size);
+
+  large->size = size;
+  large->next = pool->large;
+  pool->large = large;
+  pool->allocated += size;
+  pool->heap += sizeof(struct gc_large) + size;
+
+  return large + 1;
+  /* }}} */
+}
+
+/* cuts a cell of the <class> off of a new slab */
+static void *gc_alloc_slow(struct gc_pool *pool, unsigned class)
+{
+  /* {{{ */
+  struct gc_slab *slab;
+  char *cell;
+
+  if ((slab = NM_gc_slabs) != NULL)
+    NM_gc_slabs = slab->next;
+  else
+    slab = nmalloc(GC_SLAB_SIZE);
+
+  pool->heap += GC_SLAB_SIZE;
+
+  slab->free = GC_SLAB_CELLS(slab);
+  slab->end = (char *)slab + GC_SLAB_SIZE;
+  slab->next = pool->slabs[class];
+  pool->slabs[class] = slab;
+
+  cell = slab->free;
+  slab->free += GC_CELL_SIZE(class);
+
+  return cell;
+  /* }}} */
+}
+
+/*
+ * Returns <size> bytes which belong to the current pool (and are there until
+ * it's released, or the sweep finds their owner dead, see `gc_release`).
+ */
+static inline void *gc_alloc(size_t size)
+{
+  /* {{{ */
+  struct gc_pool *pool = gc_pool();
+  struct gc_slab *slab;
+  unsigned class = gc_class(size);
+  char *ret;
+
+  if (class == GC_CLASSES)
+    return gc_alloc_large(pool, size);
+
+  pool->allocated += GC_CELL_SIZE(class);
+
+  if ((ret = pool->free[class]) != NULL){
+    pool->free[class] = *(void **)ret;
+    return ret;
+  }
+
+  if ((slab = pool->slabs[class]) == NULL ||
+      slab->free + GC_CELL_SIZE(class) > slab->end)
+    return gc_alloc_slow(pool, class);
+
+  ret = slab->free;
+  slab->free += GC_CELL_SIZE(class);
+
+  return ret;
+  /* }}} */
+}
+
+/* returns a cell for an old object, which is marked as a live one */
+static inline Nob *gc_alloc_nob(struct gc_pool *pool)
+{
+  /* {{{ */
+  struct gc_slab *slab;
+  Nob *ret;
+
+  pool->allocated += GC_NOB_CELL;
+
+  if ((ret = pool->free[GC_NOB_CLASS]) != NULL)
+    pool->free[GC_NOB_CLASS] = ret->ptr;
+  else if ((slab = pool->slabs[GC_NOB_CLASS]) == NULL ||
+      slab->free + GC_NOB_CELL > slab->end)
+    ret = gc_alloc_slow(pool, GC_NOB_CLASS);
+  else {
+    ret = (Nob *)slab->free;
+    slab->free += GC_NOB_CELL;
+  }
+
+  ret->mark = NM_gc_epoch;
+
+  return ret;
+  /* }}} */
+}
+
+/* gives the <size> bytes at <p> (see `gc_alloc`) back to the <pool> */
+static void gc_release(struct gc_pool *pool, void *p, size_t size)
+{
+  /* {{{ */
+  unsigned class = gc_class(size);
+
+  if (class == GC_CLASSES){
+    /* it's freed once the sweep's done (see `gc_sweep`) */
+    pool->heap -= sizeof(struct gc_large) + size;
+    ((struct gc_large *)p - 1)->size = 0;
+    return;
+  }
+
+#if DEBUG
+  memset(p, 0xdb, GC_CELL_SIZE(class));
+#endif
+
+  *(void **)p = pool->free[class];
+  pool->free[class] = p;
+  /* }}} */
+}
+/* }}} */
+
+/*
+ * Returns whether the next new object (whatever it is) goes into the nursery.
+ * If it doesn't, there's a collection waiting to happen.
+ */
+static inline bool gc_young_room(struct gc_pool *pool)
+{
+  if ((size_t)(pool->young_end - pool->young_free) >= GC_MAX_YOUNG)
+    return true;
+
+  NM_ctx->gc_pending = true;
+
+  return false;
+}
+
+/*
+ * Returns <size> bytes, in the nursery if <young> (and there was room for the
+ * object, see `gc_young_room`), in the slabs otherwise.
+ */
+static inline void *gc_new(struct gc_pool *pool, size_t size, bool young)
+{
+  /* {{{ */
+  char *ret;
+
+  if (!young || size > GC_MAX_CELL)
+    return gc_alloc(size);
+
+  ret = pool->young_free;
+  pool->young_free += GC_ROUND(size);
+
+  return ret;
+  /* }}} */
+}
+
+void gc_remember(Nob **cell)
+{
+  /* {{{ */
+  struct gc_pool *pool = NM_gc;
+
+  if (pool == NULL || !IS_YOUNG(pool, *cell))
+    return;
+
+  if (pool->nremembered == pool->remembered_size){
+    pool->remembered_size = pool->remembered_size ? pool->remembered_size * 2 : 64;
+    pool->remembered = nrealloc(pool->remembered,
+        sizeof(Nob **) * pool->remembered_size);
+  }
+
+  pool->remembered[pool->nremembered++] = cell;
+  /* }}} */
+}
+
+/* the interpreter's overwritten objects go to the marker */
+static void gc_hand_over(struct gc_major *major)
+{
+  /* {{{ */
+  pthread_mutex_lock(&major->lock);
+
+  if (major->nhanded + major->nsatb > major->handed_size){
+    major->handed_size = major->handed_size ? major->handed_size * 2 : GC_SATB_CHUNK * 4;
+    major->handed = nrealloc(major->handed, sizeof(Nob *) * major->handed_size);
+  }
+
+  memcpy(major->handed + major->nhanded, major->satb, sizeof(Nob *) * major->nsatb);
+  major->nhanded += major->nsatb;
+  major->nsatb = 0;
+
+  pthread_mutex_unlock(&major->lock);
+  /* }}} */
+}
+
+void gc_write(Nob **cell, Nob *value)
+{
+  /* {{{ */
+  struct gc_pool *pool = NM_gc;
+  struct gc_major *major;
+  Nob *old = *cell;
+
+  if (pool != NULL && pool->major.phase == GC_MARKING && old != NULL &&
+      !IS_YOUNG(pool, old)){
+    /* it could have been the only way to the <old> one */
+    major = &pool->major;
+
+    if (major->nsatb == GC_SATB_CHUNK)
+      gc_hand_over(major);
+
+    major->satb[major->nsatb++] = old;
+  }
+
+  /* the marker could be reading the cell right now */
+  __atomic_store_n(cell, value, __ATOMIC_RELEASE);
+
+  gc_remember(cell);
+  /* }}} */
+}
+
+struct frame *gc_new_frame(size_t size)
+{
+  /* {{{ */
+  struct gc_pool *pool = gc_pool();
+  struct gc_frame *frame = gc_alloc(sizeof(struct gc_frame) + size);
+
+  /* (it's born marked, see `gc_alloc_nob`) */
+  frame->mark = NM_gc_epoch;
+  frame->size = sizeof(struct gc_frame) + size;
+  frame->next = pool->frames;
+  pool->frames = frame;
+
+  return (struct frame *)(frame + 1);
+  /* }}} */
+}
+
+void gc_protect(struct gc_roots *roots, Nob **slots, unsigned n)
+{
+  roots->slots = slots;
+  roots->n = n;
+  roots->up = NM_ctx->gc_roots;
+  NM_ctx->gc_roots = roots;
+}
+
+void gc_unprotect(struct gc_roots *roots)
+{
+  assert(NM_ctx->gc_roots == roots);
+
+  NM_ctx->gc_roots = roots->up;
+}
+
+bool gc_minor_begin(void)
+{
+  /* {{{ */
+  struct gc_pool *pool = NM_gc;
+
+  NM_ctx->gc_pending = false;
+
+  if (pool == NULL || pool->young_free == pool->young)
+    return false;
+
+  pool->paused = now();
+
+  return true;
+  /* }}} */
+}
+
+/* the <ob> got promoted, and the objects it points at are yet to be */
+static void gc_minor_work(Nob *ob)
+{
+  /* {{{ */
+  if (NM_ctx->gc_nwork == NM_ctx->gc_work_size){
+    NM_ctx->gc_work_size = NM_ctx->gc_work_size ? NM_ctx->gc_work_size * 2 : 256;
+    NM_ctx->gc_work = nrealloc(NM_ctx->gc_work,
+        sizeof(Nob *) * NM_ctx->gc_work_size);
+  }
+
+  NM_ctx->gc_work[NM_ctx->gc_nwork++] = ob;
+  /* }}} */
+}
+
+void gc_evacuate(Nob **slot)
+{
+  /* {{{ */
+  struct gc_pool *pool = NM_gc;
+  Nob *ob = *slot, *copy;
+  struct nob_fun *fun, *fun_copy;
+  struct nob_tuple *tuple;
+  size_t allocated = pool->allocated, size;
+
+  if (!IS_YOUNG(pool, ob))
+    return;
+
+  /* it's been promoted already (the <slot> could be one the marker is
+   * reading, see `gc_write`) */
+  if (ob->mark){
+    __atomic_store_n(slot, ob->ptr, __ATOMIC_RELEASE);
+    return;
+  }
+
+  copy = gc_alloc_nob(pool);
+  copy->type = ob->type;
+  copy->ptr = ob->ptr;
+
+  switch (ob->type->primitive){
+    case OT_REAL:
+      if (IS_YOUNG(pool, ob->ptr)){
+        copy->ptr = gc_alloc(sizeof(double));
+        *(double *)copy->ptr = NOB_GET_REAL(ob);
+      }
+      break;
+    case OT_FUN:
+      fun = ob->ptr;
+
+      if (IS_YOUNG(pool, fun)){
+        fun_copy = gc_alloc(sizeof(struct nob_fun));
+        *fun_copy = *fun;
+
+        if (fun->argc > 0 && IS_YOUNG(pool, fun->args)){
+          fun_copy->args = gc_alloc(sizeof(Nob *) * fun->argc);
+          memcpy(fun_copy->args, fun->args, sizeof(Nob *) * fun->argc);
+        }
+
+        copy->ptr = fun_copy;
+      }
+
+      /* its arguments are yet to be promoted (see `gc_minor_end`) */
+      gc_minor_work(copy);
+      break;
+    case OT_TUPLE:
+      /* (the elements are in the nursery along with it, see `new_nob`) */
+      tuple = ob->ptr;
+      size = NOB_TUPLE_SIZE(tuple->length);
+      copy->ptr = gc_alloc(size);
+      memcpy(copy->ptr, tuple, size);
+
+      /* and so are its elements */
+      gc_minor_work(copy);
+      break;
+    case OT_STRING:
+      /* (only the short ones are young, and they have no marks, see
+       * `new_nob`) */
+      if (IS_YOUNG(pool, ob->ptr)){
+        size = NOB_STRING_SIZE(0, NOB_GET_STRING(ob)->size);
+        copy->ptr = gc_alloc(size);
+        memcpy(copy->ptr, ob->ptr, size);
+      }
+      break;
+    default:
+      /* the rest of them are either the values themselves, or are never
+       * young (see `new_nob`) */
+      break;
+  }
+
+  NM_gc_stats->promoted += pool->allocated - allocated;
+
+  /* leave a note where it went */
+  ob->mark = 1;
+  ob->ptr = copy;
+  __atomic_store_n(slot, copy, __ATOMIC_RELEASE);
+  /* }}} */
+}
+
+void gc_minor_end(void)
+{
+  /* {{{ */
+  struct gc_pool *pool = NM_gc;
+  struct gc_roots *roots;
+  struct nob_tuple *tuple;
+  struct nob_fun *fun;
+  size_t i;
+  Nob *ob;
+
+  for (i = 0; i < pool->nremembered; i++)
+    gc_evacuate(pool->remembered[i]);
+
+  for (roots = NM_ctx->gc_roots; roots != NULL; roots = roots->up)
+    for (i = 0; i < roots->n; i++)
+      gc_evacuate(&roots->slots[i]);
+
+  while (NM_ctx->gc_nwork > 0){
+    ob = NM_ctx->gc_work[--NM_ctx->gc_nwork];
+
+    if (ob->type->primitive == OT_TUPLE){
+      tuple = ob->ptr;
+
+      for (i = 0; i < tuple->length; i++)
+        if (NOB_TUPLE_KINDS(tuple)[i] == NOB_TUPLE_BOXED)
+          gc_evacuate(&tuple->elems[i].nob);
+    } else {
+      fun = ob->ptr;
+
+      for (i = 0; i < fun->argc; i++)
+        gc_evacuate(&fun->args[i]);
+    }
+  }
+
+#if DEBUG
+  /* whatever still points in there is going to be caught red-handed */
+  memset(pool->young, 0xdb, pool->young_free - pool->young);
+#endif
+
+  NM_gc_stats->allocated += pool->young_free - pool->young;
+  pool->young_free = pool->young;
+  pool->nremembered = 0;
+
+  gc_report(pool, &NM_gc_stats->minor, "minor collection");
+  /* }}} */
+}
+
+/* {{{ The old generation */
+/*
+ * Marks the <ob> (unless it's a young one, or is marked already), leaving its
+ * insides for later.
+ */
+static void gc_shade(struct gc_major *major, Nob *ob)
+{
+  /* {{{ */
+  if (ob == NULL || IS_YOUNG(major->pool, ob) || ob->mark == major->epoch)
+    return;
+
+  ob->mark = major->epoch;
+
+  if (major->ngrey == major->grey_size){
+    major->grey_size = major->grey_size ? major->grey_size * 2 : 1024;
+    major->grey = nrealloc(major->grey, sizeof(Nob *) * major->grey_size);
+  }
+
+  major->grey[major->ngrey++] = ob;
+  /* }}} */
+}
+
+/*
+ * Marks the <frame> on the heap, and the ones it links to, shading whatever
+ * is in their slots.
+ */
+static void gc_shade_frame(struct gc_major *major, struct frame *frame)
+{
+  /* {{{ */
+  unsigned i;
+
+  for (; frame != NULL; frame = frame->up){
+    if (GC_FRAME(frame)->mark == major->epoch)
+      return;
+
+    GC_FRAME(frame)->mark = major->epoch;
+
+    /* the slots can be written to in the meantime (see `gc_write`) */
+    for (i = 0; i < frame->scope->frame_size; i++)
+      gc_shade(major, __atomic_load_n(&frame->slots[i], __ATOMIC_ACQUIRE));
+  }
+  /* }}} */
+}
+
+/*
+ * Marks everything reachable from the grey objects. Returns false if it got
+ * told to stop before it was done.
+ */
+static bool gc_drain(struct gc_major *major)
+{
+  /* {{{ */
+  struct nob_tuple *tuple;
+  struct nob_list *node;
+  struct nob_rope *rope;
+  struct nob_fun *fun;
+  unsigned long n = 0;
+  unsigned i;
+  Nob *ob;
+
+  while (major->ngrey > 0){
+    ob = major->grey[--major->ngrey];
+
+    switch (ob->type->primitive){
+      case OT_FUN:
+        fun = ob->ptr;
+
+        for (i = 0; i < fun->argc; i++)
+          gc_shade(major, fun->args[i]);
+
+        gc_shade_frame(major, fun->env);
+        break;
+      case OT_TUPLE:
+        tuple = ob->ptr;
+
+        for (i = 0; i < tuple->length; i++)
+          if (NOB_TUPLE_KINDS(tuple)[i] == NOB_TUPLE_BOXED)
+            gc_shade(major, tuple->elems[i].nob);
+        break;
+      case OT_LIST:
+        /* (a leaf's elements can be getting promoted in the meantime, see
+         * `gc_evacuate`) */
+        node = ob->ptr;
+
+        for (i = 0; i < node->n; i++)
+          gc_shade(major, __atomic_load_n(&node->slots[i], __ATOMIC_ACQUIRE));
+        break;
+      case OT_STRING:
+        /* (the same goes for the strings of a rope, and its <flat> one can
+         * be getting set, see `gc_write`) */
+        rope = ob->ptr;
+
+        if (!NOB_STRING_IS_ROPE(rope))
+          break;
+
+        gc_shade(major, __atomic_load_n(&rope->left, __ATOMIC_ACQUIRE));
+        gc_shade(major, __atomic_load_n(&rope->right, __ATOMIC_ACQUIRE));
+        gc_shade(major, __atomic_load_n(&rope->flat, __ATOMIC_ACQUIRE));
+        break;
+      default:
+        break;
+    }
+
+    if (++n % 1024 == 0 && __atomic_load_n(&major->stop, __ATOMIC_RELAXED))
+      return false;
+  }
+
+  return true;
+  /* }}} */
+}
+
+static void *gc_marker(void *arg)
+{
+  /* {{{ */
+  struct gc_major *major = arg;
+  size_t i;
+
+  for (;;){
+    if (!gc_drain(major))
+      return NULL;
+
+    pthread_mutex_lock(&major->lock);
+
+    if (major->nhanded == 0){
+      /* there's nothing left (for now at least) */
+      __atomic_store_n(&major->done, 1, __ATOMIC_RELEASE);
+      pthread_mutex_unlock(&major->lock);
+      break;
+    }
+
+    for (i = 0; i < major->nhanded; i++)
+      gc_shade(major, major->handed[i]);
+
+    major->nhanded = 0;
+    pthread_mutex_unlock(&major->lock);
+  }
+
+  return NULL;
+  /* }}} */
+}
+
+bool gc_major_begin(void)
+{
+  /* {{{ */
+  struct gc_pool *pool = NM_gc;
+  struct gc_major *major;
+
+  if (pool == NULL || pool->major.phase != GC_IDLE ||
+      pool->allocated < pool->major_at)
+    return false;
+
+  pool->paused = now();
+  NM_gc_stats->allocated += pool->allocated;
+  pool->allocated = 0;
+
+  major = &pool->major;
+  major->phase = GC_MARKING;
+  /* the objects marked by the last one are as good as unmarked */
+  major->epoch = ++NM_gc_epoch;
+  major->pool = pool;
+  major->done = major->stop = 0;
+  major->ngrey = major->nhanded = major->nsatb = 0;
+  major->began = pool->paused;
+
+  return true;
+  /* }}} */
+}
+
+void gc_major_root(Nob *ob)
+{
+  gc_shade(&NM_gc->major, ob);
+}
+
+void gc_major_frame(struct frame *frame)
+{
+  gc_shade_frame(&NM_gc->major, frame);
+}
+
+void gc_major_spawn(void)
+{
+  /* {{{ */
+  struct gc_pool *pool = NM_gc;
+  struct gc_major *major = &pool->major;
+  struct gc_roots *roots;
+  unsigned i;
+
+  for (roots = NM_ctx->gc_roots; roots != NULL; roots = roots->up)
+    for (i = 0; i < roots->n; i++)
+      gc_shade(major, roots->slots[i]);
+
+  pthread_mutex_init(&major->lock, NULL);
+
+  major->threaded = pthread_create(&major->marker, NULL, gc_marker, major) == 0;
+
+  /* there's no other way than to mark everything right away */
+  if (!major->threaded)
+    gc_marker(major);
+
+  gc_report(pool, &NM_gc_stats->major, "major collection's roots");
+  /* }}} */
+}
 
-#include "mem.h"
-#include "nob.h"
-#include "infnum.h"
-#include "util.h"
-#include "utf8.h"
+/* waits for the marker to be done with the <pool> (if it isn't already) */
+static void gc_major_join(struct gc_pool *pool)
+{
+  /* {{{ */
+  struct gc_major *major = &pool->major;
 
-nchar_t next_type_var_name = L'α';
+  if (major->threaded)
+    pthread_join(major->marker, NULL);
 
-/* global variables to make the life easier, and not to have to remember the
- * pointer values */
-struct nob_type *T_VOID;
-struct nob_type *T_INT;
-struct nob_type *T_INFNUM;
-struct nob_type *T_CHAR;
-struct nob_type *T_REAL;
-struct nob_type *T_STRING;
-struct nob_type *T_LIST;
+  pthread_mutex_destroy(&major->lock);
+  /* }}} */
+}
 
-/* the head of a singly-linked list of <struct types_list> */
-struct types_list *NM_types;
+static void gc_major_abandon(struct gc_pool *pool)
+{
+  /* {{{ */
+  struct gc_major *major = &pool->major;
 
-struct gc_pool {
-  /* not a pointer! */
-  /* whenever you see a Nob *ob = new_nob(whatever), then it's a pointer to
-   * this <nob>'s address */
-  Nob nob;
-  struct gc_pool *next;
-};
-/* the garbage collector's object pool */
-/* (the head of a singly linked list of <struct gc_pool>s) */
-struct gc_pool *NM_gc;
+  if (major->phase == GC_MARKING){
+    __atomic_store_n(&major->stop, 1, __ATOMIC_RELAXED);
+    gc_major_join(pool);
+  }
 
-void types_init(void)
+  /* the objects not swept yet will be by the next one */
+  major->phase = GC_IDLE;
+  /* }}} */
+}
+
+/* how many bytes the <ob> takes (along with its value) */
+static size_t gc_nob_size(Nob *ob)
 {
-  /* create the standard types */
-  T_INT    = new_type(OT_INT);          T_INT->name    = strdup("int");
-  T_INFNUM = new_type(OT_INFNUM);       T_INFNUM->name = strdup("infnum");
-  T_CHAR   = new_type(OT_CHAR);         T_CHAR->name   = strdup("char");
-  T_REAL   = new_type(OT_REAL);         T_REAL->name   = strdup("real");
+  /* {{{ */
+  struct nob_string *str;
+  struct nob_fun *fun;
 
-  T_LIST   = new_type(OT_CUSTOM, "list", new_type(OT_TYPE_VARIABLE));
-  /* strings are lists of characters */
-  T_STRING = new_type(OT_CUSTOM, "list", T_CHAR);
+  switch (ob->type->primitive){
+    case OT_REAL:
+      return GC_NOB_CELL + sizeof(double);
+    case OT_INFNUM:
+      return GC_NOB_CELL + sizeof(struct infnum);
+    case OT_FUN:
+      fun = ob->ptr;
+      return GC_NOB_CELL + sizeof(struct nob_fun) + sizeof(Nob *) * fun->argc;
+    case OT_TUPLE:
+      return GC_NOB_CELL + NOB_TUPLE_SIZE(NOB_GET_TUPLE(ob)->length);
+    case OT_LIST:
+      return GC_NOB_CELL + NOB_LIST_SIZE(NOB_GET_LIST(ob)->height, NOB_GET_LIST(ob)->n);
+    case OT_STRING:
+      str = ob->ptr;
 
-  T_VOID   = new_type(OT_CUSTOM, "void", NULL);
+      if (NOB_STRING_IS_ROPE(str))
+        return GC_NOB_CELL + sizeof(struct nob_rope);
+
+      return GC_NOB_CELL +
+        NOB_STRING_SIZE(NOB_STRING_NMARKS(str->length, str->ascii), str->size);
+    default:
+      return GC_NOB_CELL;
+  }
+  /* }}} */
 }
 
-void types_finish(void)
+/* frees the <ob> (which wasn't marked) along with its value */
+static void gc_free_nob(struct gc_pool *pool, Nob *ob)
 {
-  struct types_list *curr, *next;
+  /* {{{ */
+  struct nob_string *str;
+  struct nob_fun *fun;
 
-  for (curr = NM_types; curr != NULL; curr = next){
-    next = curr->next;
+  switch (ob->type->primitive){
+    case OT_REAL:
+      gc_release(pool, ob->ptr, sizeof(double));
+      break;
+    case OT_INFNUM:
+      /* its digits are freed already (see `gc_remark`) */
+      gc_release(pool, ob->ptr, sizeof(struct infnum));
+      break;
+    case OT_FUN:
+      fun = ob->ptr;
 
-    if (!curr->type)
-      continue;
+      if (fun->argc > 0)
+        gc_release(pool, fun->args, sizeof(Nob *) * fun->argc);
 
-    /* anonymous types don't have a name, so there's no point of freeing it */
-    /* I know that free(NULL) is practically a NOP, but, still */
-    nfree(curr->type->name);
+      gc_release(pool, fun, sizeof(struct nob_fun));
+      break;
+    case OT_TUPLE:
+      gc_release(pool, ob->ptr, NOB_TUPLE_SIZE(NOB_GET_TUPLE(ob)->length));
+      break;
+    case OT_LIST:
+      /* (its children are objects of their own) */
+      gc_release(pool, ob->ptr,
+          NOB_LIST_SIZE(NOB_GET_LIST(ob)->height, NOB_GET_LIST(ob)->n));
+      break;
+    case OT_STRING:
+      /* (the strings a rope is made of are objects of their own) */
+      str = ob->ptr;
+      gc_release(pool, str, NOB_STRING_IS_ROPE(str) ? sizeof(struct nob_rope) :
+          NOB_STRING_SIZE(NOB_STRING_NMARKS(str->length, str->ascii), str->size));
+      break;
+    default:
+      break;
+  }
 
-    /* free the type itself */
-    nfree(curr->type);
+  ob->type = NULL;
+  ob->ptr = pool->free[GC_NOB_CLASS];
+  pool->free[GC_NOB_CLASS] = ob;
+  /* }}} */
+}
+
+/*
+ * The marker's done: marks what got overwritten since it last looked, and gets
+ * the sweep going.
+ */
+static void gc_remark(struct gc_pool *pool)
+{
+  /* {{{ */
+  struct gc_major *major = &pool->major;
+  struct gc_final **final, *dead;
+  size_t i;
+
+  gc_major_join(pool);
+
+  for (i = 0; i < major->nhanded; i++)
+    gc_shade(major, major->handed[i]);
+
+  for (i = 0; i < major->nsatb; i++)
+    gc_shade(major, major->satb[i]);
+
+  major->nhanded = major->nsatb = 0;
+  gc_drain(major);
+
+  /* the dead infnums' digits go right away */
+  for (final = &pool->finals; *final != NULL; ){
+    if ((*final)->ob->mark == major->epoch){
+      final = &(*final)->next;
+      continue;
+    }
+
+    dead = *final;
+    *final = dead->next;
+    free_infnum(NOB_GET_INFNUM(dead->ob));
+    gc_release(pool, dead, sizeof(struct gc_final));
   }
+
+  major->phase = GC_SWEEPING;
+  major->sweep = pool->slabs[GC_NOB_CLASS];
+  major->live = 0;
+  /* }}} */
 }
 
 /*
- * "Pushes" a given <type> to the NM_types array.
+ * Sweeps (at most) <n> slabs of objects. The slabs cut off since the
+ * collection began hold only the objects born marked, so they are left alone.
  */
-void push_type(struct nob_type *type)
+static void gc_sweep(struct gc_pool *pool, unsigned n)
 {
-  struct types_list *new = nmalloc(sizeof(struct types_list));
+  /* {{{ */
+  struct gc_major *major = &pool->major;
+  struct gc_frame **frame, *gone;
+  struct gc_large **large, *dead;
+  struct gc_slab *slab;
+  char *cell;
+  Nob *ob;
 
-  new->type = type;
-  new->next = NM_types;
-  NM_types  = new;
+  for (; n > 0 && (slab = major->sweep) != NULL; n--){
+    major->sweep = slab->next;
+
+    for (cell = GC_SLAB_CELLS(slab); cell < slab->free; cell += GC_NOB_CELL){
+      ob = (Nob *)cell;
+
+      /* a free one */
+      if (ob->type == NULL)
+        continue;
+
+      if (ob->mark == major->epoch)
+        major->live += gc_nob_size(ob);
+      else
+        gc_free_nob(pool, ob);
+    }
+  }
+
+  if (major->sweep != NULL)
+    return;
+
+  /* (the remembered set's empty right after a minor collection, so none of
+   * it points into them) */
+  for (frame = &pool->frames; *frame != NULL; ){
+    if ((*frame)->mark == major->epoch){
+      major->live += (*frame)->size;
+      frame = &(*frame)->next;
+      continue;
+    }
+
+    gone = *frame;
+    *frame = gone->next;
+    gc_release(pool, gone, gone->size);
+  }
+
+  for (large = &pool->large; *large != NULL; ){
+    if ((*large)->size != 0){
+      large = &(*large)->next;
+      continue;
+    }
+
+    dead = *large;
+    *large = dead->next;
+    nfree(dead);
+  }
+
+  major->phase = GC_IDLE;
+  pool->major_at = major->live > GC_MAJOR_MIN ? major->live : GC_MAJOR_MIN;
+  NM_gc_stats->live = major->live;
+  NM_gc_stats->majors++;
+  NM_gc_stats->majors_time += now() - major->began;
+
+#if DEBUG
+  if (NM_DEBUG_GET_FLAG(NM_DEBUG_GC) && !NM_DEBUG_GET_FLAG(NM_DEBUG_GC_JSON))
+    fprintf(stderr, "gc: major collection #%u is done, %zu bytes are alive\n",
+        major->epoch, major->live);
+#endif /* DEBUG */
+  /* }}} */
 }
 
-/* {{{ Functions related with Garbage Collector (init, finish, etc) */
-void gc_finish(void)
+void gc_major_step(void)
 {
-  struct gc_pool *curr, *next;
+  /* {{{ */
+  struct gc_pool *pool = NM_gc;
 
-  for (curr = NM_gc; curr != NULL; curr = next){
-    next = curr->next;
+  if (pool == NULL)
+    return;
+
+  switch (pool->major.phase){
+    case GC_IDLE:
+      break;
+    case GC_MARKING:
+      if (!__atomic_load_n(&pool->major.done, __ATOMIC_ACQUIRE))
+        break;
+
+      pool->paused = now();
+      gc_remark(pool);
+      gc_report(pool, &NM_gc_stats->major, "major collection's remark");
+      break;
+    case GC_SWEEPING:
+      pool->paused = now();
+      gc_sweep(pool, GC_SWEEP_STEP);
+      gc_report(pool, &NM_gc_stats->major, "major collection's sweep");
+      break;
+  }
+  /* }}} */
+}
+
+/* counts the <ob> in the <stats>' census */
+static void gc_census_nob(struct nemo_gc_stats *stats, Nob *ob)
+{
+  stats->objects[ob->type->primitive]++;
+  stats->retained += gc_nob_size(ob);
+}
 
-    /* free everything that is associated with the current element's Nob */
-    free_nob(&curr->nob);
+/* counts the objects in the <pool> (both of its generations) */
+static void gc_census(struct gc_pool *pool, struct nemo_gc_stats *stats)
+{
+  /* {{{ */
+  struct gc_frame *frame;
+  struct gc_slab *slab;
+  struct nob_fun *fun;
+  char *p, *end;
+  Nob *ob;
+
+  /* (the frames on the heap aren't objects, but they take their bytes) */
+  for (frame = pool->frames; frame != NULL; frame = frame->next)
+    stats->retained += frame->size;
+
+  /* the old ones (the free cells have no type, see `gc_free_nob`) */
+  for (slab = pool->slabs[GC_NOB_CLASS]; slab != NULL; slab = slab->next)
+    for (p = GC_SLAB_CELLS(slab); p < slab->free; p += GC_NOB_CELL)
+      if (((Nob *)p)->type != NULL)
+        gc_census_nob(stats, (Nob *)p);
+
+  /* the young ones, each of them followed by its value (see `new_nob`) */
+  for (p = pool->young, end = pool->young_free; p < end; ){
+    ob = (Nob *)p;
+    p += GC_NOB_CELL;
+
+    switch (ob->type->primitive){
+      case OT_REAL:
+        p += GC_ROUND(sizeof(double));
+        break;
+      case OT_FUN:
+        /* (a promoted one could have had its arguments moved already, but
+         * not their number) */
+        fun = (struct nob_fun *)p;
+        p += GC_ROUND(sizeof(struct nob_fun));
+
+        if (fun->argc > 0 && sizeof(Nob *) * fun->argc <= GC_MAX_CELL)
+          p += GC_ROUND(sizeof(Nob *) * fun->argc);
+        break;
+      case OT_TUPLE:
+        /* (only the small ones are young, see `new_nob`) */
+        p += GC_ROUND(NOB_TUPLE_SIZE(((struct nob_tuple *)p)->length));
+        break;
+      case OT_STRING:
+        /* (and so are the strings) */
+        p += GC_ROUND(NOB_STRING_SIZE(0, ((struct nob_string *)p)->size));
+        break;
+      default:
+        break;
+    }
 
-    /* free the list's element itself */
-    nfree(curr);
+    /* the promoted ones were counted with the old ones */
+    if (ob->mark == 0)
+      gc_census_nob(stats, ob);
   }
+  /* }}} */
 }
 
-/*
- * "Pushes" a given <Nob> to the NM_gc pool/array.
- */
-static Nob *push_nob(Nob *nob)
+void nemo_gc_stats(struct nemo_ctx *ctx, struct nemo_gc_stats *stats)
 {
-  struct gc_pool *new = nmalloc(sizeof(struct gc_pool));
+  /* {{{ */
+  struct nemo_ctx *prev = nemo_ctx_enter(ctx);
+  struct gc_pool *pool = NM_gc;
+  struct rusage usage;
+
+  memset(stats, 0, sizeof(struct nemo_gc_stats));
+
+  if (NM_gc_stats != NULL){
+    *stats = *NM_gc_stats;
+    /* the objects are counted anew */
+    memset(stats->objects, 0, sizeof(stats->objects));
+  }
+
+  if (pool != NULL){
+    gc_census(pool, stats);
+    stats->heap = pool->heap;
+    stats->allocated += (pool->young_free - pool->young) + pool->allocated;
+  }
+
+  /* the promotions are allocations of the objects which were there already */
+  stats->allocated -= stats->promoted;
+
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+#if defined(__APPLE__)
+    stats->peak_rss = usage.ru_maxrss;
+#else
+    stats->peak_rss = (size_t)usage.ru_maxrss * 1024;
+#endif
+
+  nemo_ctx_enter(prev);
+  /* }}} */
+}
+
+static const char *gc_type_names[OT_CUSTOM + 1] = {
+  [OT_INT] = "int",
+  [OT_REAL] = "real",
+  [OT_CHAR] = "char",
+  [OT_STRING] = "string",
+  [OT_INFNUM] = "infnum",
+  [OT_TUPLE] = "tuple",
+  [OT_LIST] = "list",
+  [OT_FUN] = "fun",
+  [OT_TYPE_VARIABLE] = "type variable",
+  [OT_CUSTOM] = "custom",
+};
+
+static void gc_report_pauses_json(FILE *fp, const char *name,
+    struct nemo_gc_pauses *pauses)
+{
+  /* {{{ */
+  unsigned i;
+
+  fprintf(fp, "  \"%s\": {\"count\": %lu, \"total_ns\": %" PRIu64 ", "
+      "\"longest_ns\": %" PRIu64 ", \"histogram_us\": [", name, pauses->count,
+      pauses->total, pauses->longest);
+
+  for (i = 0; i < NM_GC_HISTOGRAM; i++)
+    fprintf(fp, "%s%lu", i ? ", " : "", pauses->histogram[i]);
+
+  fprintf(fp, "]},\n");
+  /* }}} */
+}
+
+void nemo_gc_report(struct nemo_ctx *ctx, FILE *fp, bool json)
+{
+  /* {{{ */
+  struct nemo_gc_stats stats;
+  unsigned i;
+
+  nemo_gc_stats(ctx, &stats);
+
+  if (json){
+    fprintf(fp, "{\n  \"objects\": {");
+
+    for (i = 0; i <= OT_CUSTOM; i++)
+      fprintf(fp, "%s\"%s\": %lu", i ? ", " : "", gc_type_names[i],
+          stats.objects[i]);
+
+    fprintf(fp, "},\n");
+    fprintf(fp, "  \"retained\": %zu,\n  \"live\": %zu,\n  \"heap\": %zu,\n",
+        stats.retained, stats.live, stats.heap);
+    fprintf(fp, "  \"allocated\": %" PRIu64 ",\n  \"promoted\": %" PRIu64 ",\n",
+        stats.allocated, stats.promoted);
+    gc_report_pauses_json(fp, "minor", &stats.minor);
+    gc_report_pauses_json(fp, "major", &stats.major);
+    fprintf(fp, "  \"majors\": %lu,\n  \"majors_ns\": %" PRIu64 ",\n",
+        stats.majors, stats.majors_time);
+    fprintf(fp, "  \"peak_rss\": %zu\n}\n", stats.peak_rss);
+
+    return;
+  }
+
+  fprintf(fp, "\nnemo: the garbage collector\n\n");
+  fprintf(fp, "%14s  %s\n", "objects", "type");
+
+  for (i = 0; i <= OT_CUSTOM; i++)
+    if (stats.objects[i] > 0)
+      fprintf(fp, "%14lu  %s\n", stats.objects[i], gc_type_names[i]);
 
-  new->nob  = *nob;
-  new->next = NM_gc;
-  NM_gc     = new;
+  fprintf(fp, "\n%14zu  bytes retained\n", stats.retained);
+  fprintf(fp, "%14zu  bytes alive after the last major collection\n", stats.live);
+  fprintf(fp, "%14zu  bytes of heap\n", stats.heap);
+  fprintf(fp, "%14" PRIu64 "  bytes allocated\n", stats.allocated);
+  fprintf(fp, "%14" PRIu64 "  bytes promoted\n", stats.promoted);
+  fprintf(fp, "%14zu  bytes of peak RSS\n", stats.peak_rss);
+
+  fprintf(fp, "\n%14s %10s %10s %10s\n", "", "pauses", "total ms", "longest ms");
+  fprintf(fp, "%14s %10lu %10.3f %10.3f\n", "minor", stats.minor.count,
+      stats.minor.total / 1e6, stats.minor.longest / 1e6);
+  fprintf(fp, "%14s %10lu %10.3f %10.3f\n", "major", stats.major.count,
+      stats.major.total / 1e6, stats.major.longest / 1e6);
+  fprintf(fp, "\n%14lu  major collections, taking %.3f ms altogether\n",
+      stats.majors, stats.majors_time / 1e6);
+
+  fprintf(fp, "\n%14s %10s %10s\n", "pauses under", "minor", "major");
+
+  for (i = 0; i < NM_GC_HISTOGRAM; i++){
+    if (stats.minor.histogram[i] == 0 && stats.major.histogram[i] == 0)
+      continue;
 
-  return &new->nob;
+    if (i < NM_GC_HISTOGRAM - 1)
+      fprintf(fp, "%11lu us %10lu %10lu\n", 1ul << i, stats.minor.histogram[i],
+          stats.major.histogram[i]);
+    else
+      fprintf(fp, "%14s %10lu %10lu\n", "longer", stats.minor.histogram[i],
+          stats.major.histogram[i]);
+  }
+  /* }}} */
 }
 /* }}} */
+/* }}} */
 
 /* that's a WIP, obviously */
 Nob *new_nob(struct nob_type *type, ...)
 {
   /* {{{ */
-  va_list vl;
-  Nob new;
+  va_list vl, peek;
+  struct gc_pool *pool = gc_pool();
+  /* the infnums own their digits, so they are not the kind that die young, and
+   * neither are the nodes of the lists, which get shared between them (see
+   * list.c), nor the ropes (see str.c) for the same reason */
+  bool young = type->primitive != OT_INFNUM && type->primitive != OT_LIST &&
+    gc_young_room(pool);
+  struct gc_final *final;
+  unsigned i;
+  Nob *new;
 
   assert(type);
   va_start(vl, type);
 
+  /* neither are the tuples whose elements wouldn't fit in the nursery (see
+   * `gc_new`), they'd be left behind in the slabs once the tuple's dead */
+  if (young && type->primitive == OT_TUPLE){
+    va_copy(peek, vl);
+    young = NOB_TUPLE_SIZE(va_arg(peek, unsigned)) <= GC_MAX_CELL;
+    va_end(peek);
+  }
+
+  /* and the same goes for the strings (the short ones have no marks) */
+  if (young && type->primitive == OT_STRING){
+    va_copy(peek, vl);
+    young = va_arg(peek, char *) != NULL &&
+      NOB_STRING_SIZE(0, va_arg(peek, unsigned)) <= GC_MAX_CELL;
+    va_end(peek);
+  }
+
+  /* and for the functions with too many arguments bound */
+  if (young && type->primitive == OT_FUN){
+    va_copy(peek, vl);
+    (void)va_arg(peek, struct node *);
+    (void)va_arg(peek, struct frame *);
+    young = sizeof(Nob *) * va_arg(peek, unsigned) <= GC_MAX_CELL;
+    va_end(peek);
+  }
+
+  new = young ? gc_new(pool, sizeof(Nob), true) : gc_alloc_nob(pool);
+
   /* set up the new object with some knowns */
-  new.type = type;
-  new.ptr = NULL;
-  new.mark = 0;
+  new->type = type;
+  new->ptr = NULL;
+
+  /* (the old ones are born marked, see `gc_alloc_nob`) */
+  if (young)
+    new->mark = 0;
 
   switch (type->primitive){
     case OT_INT:
@@ -150,7 +1556,7 @@ Nob *new_nob(struct nob_type *type, ...)
       int32_t value = va_arg(vl, int32_t);
 
       /* the pointer is the actual value */
-      new.ptr = (void *)(uintptr_t)value;
+      new->ptr = (void *)(uintptr_t)value;
       /* this approach most likely needs serious help */
       /* }}} */
       break;
@@ -160,8 +1566,14 @@ Nob *new_nob(struct nob_type *type, ...)
       /* {{{ */
       struct infnum value = va_arg(vl, struct infnum);
 
-      new.ptr = nmalloc(sizeof(struct infnum));
-      *(struct infnum *)new.ptr = value;
+      new->ptr = gc_alloc(sizeof(struct infnum));
+      *(struct infnum *)new->ptr = value;
+
+      /* its digits are freed along with it (or the pool) */
+      final = gc_alloc(sizeof(struct gc_final));
+      final->ob = new;
+      final->next = NM_gc->finals;
+      NM_gc->finals = final;
       /* }}} */
       break;
     }
@@ -171,7 +1583,7 @@ Nob *new_nob(struct nob_type *type, ...)
       nchar_t value = va_arg(vl, nchar_t);
 
       /* the pointer is the actual value */
-      new.ptr = (void *)(uintptr_t)value;
+      new->ptr = (void *)(uintptr_t)value;
       /* this approach most likely needs serious help */
       /* }}} */
       break;
@@ -181,33 +1593,197 @@ Nob *new_nob(struct nob_type *type, ...)
       /* {{{ */
       double value = va_arg(vl, double);
 
-      new.ptr = nmalloc(sizeof(double));
-      *(double *)new.ptr = value;
+      new->ptr = gc_new(pool, sizeof(double), young);
+      *(double *)new->ptr = value;
       /* }}} */
       break;
     }
     case OT_TUPLE:
     {
       /* {{{ */
-      /* the list's elements themselves */
-      struct nobs_list *elems = va_arg(vl, struct nobs_list *);
+      unsigned length = va_arg(vl, unsigned);
+      Nob **elems = va_arg(vl, Nob **);
+      struct nob_tuple *value = gc_new(pool, NOB_TUPLE_SIZE(length), young);
+      unsigned char *kinds;
+
+      value->length = length;
+      kinds = NOB_TUPLE_KINDS(value);
+
+      /* the elements are copied (unboxed, if they can be), so they can be
+       * passed straight from the argument stack */
+      for (i = 0; i < length; i++){
+        kinds[i] = elems[i]->type->primitive;
+
+        switch (kinds[i]){
+          case OT_INT:
+            value->elems[i].i = NOB_GET_INT(elems[i]);
+            break;
+          case OT_CHAR:
+            value->elems[i].c = NOB_GET_CHAR(elems[i]);
+            break;
+          case OT_REAL:
+            value->elems[i].f = NOB_GET_REAL(elems[i]);
+            break;
+          default:
+            kinds[i] = NOB_TUPLE_BOXED;
+            value->elems[i].nob = elems[i];
+
+            /* an old object pointing at a young one */
+            if (!young)
+              gc_remember(&value->elems[i].nob);
+            break;
+        }
+      }
 
-      new.ptr = elems;
+      new->ptr = value;
       /* }}} */
       break;
     }
+    case OT_LIST:
+    {
+      /* {{{ */
+      unsigned height = va_arg(vl, unsigned);
+      unsigned n = va_arg(vl, unsigned);
+      Nob **slots = va_arg(vl, Nob **);
+      struct nob_list *value = gc_alloc(NOB_LIST_SIZE(height, n));
+      unsigned *sizes;
 
-    /* suspress warnings */
-    case OT_STRING:
+      assert(n <= NOB_LIST_WIDTH);
+
+      value->height = height;
+      value->n = n;
+      value->length = height > 0 ? 0 : n;
+
+      if (n > 0)
+        memcpy(value->slots, slots, sizeof(Nob *) * n);
+
+      if (height > 0){
+        sizes = NOB_LIST_SIZES(value);
+
+        for (i = 0; i < n; i++){
+          value->length += NOB_GET_LIST(slots[i])->length;
+          sizes[i] = value->length;
+        }
+      } else {
+        /* the elements can be young ones (the children never are) */
+        for (i = 0; i < n; i++)
+          gc_remember(&value->slots[i]);
+      }
+
+      new->ptr = value;
+      /* }}} */
+      break;
+    }
     case OT_FUN:
+    {
+      /* {{{ */
+      struct node *fun = va_arg(vl, struct node *);
+      struct frame *env = va_arg(vl, struct frame *);
+      unsigned argc = va_arg(vl, unsigned);
+      Nob **args = va_arg(vl, Nob **);
+      struct nob_fun *value = gc_new(pool, sizeof(struct nob_fun), young);
+
+      value->fun = fun;
+      value->env = env;
+      value->argc = argc;
+      value->args = NULL;
+
+      /* the arguments are copied, so they can be passed straight from the
+       * argument stack */
+      if (argc > 0){
+        value->args = gc_new(pool, sizeof(Nob *) * argc, young);
+        memcpy(value->args, args, sizeof(Nob *) * argc);
+
+        /* an old object pointing at the young ones */
+        if (!young)
+          for (i = 0; i < argc; i++)
+            gc_remember(&value->args[i]);
+      }
+
+      new->ptr = value;
+      /* }}} */
+      break;
+    }
+
+    case OT_STRING:
+    {
+      /* {{{ */
+      char *bytes = va_arg(vl, char *);
+      unsigned size, length = 0, nmarks, j;
+      unsigned char ascii = 1;
+      struct nob_string *value;
+      struct nob_rope *rope;
+
+      /* without the <bytes>, it's a rope of the two strings that follow */
+      if (bytes == NULL){
+        rope = gc_alloc(sizeof(struct nob_rope));
+        rope->left = va_arg(vl, Nob *);
+        rope->right = va_arg(vl, Nob *);
+        rope->flat = NULL;
+        rope->length = NOB_GET_STRING(rope->left)->length +
+          NOB_GET_STRING(rope->right)->length;
+        rope->size = NOB_GET_STRING(rope->left)->size +
+          NOB_GET_STRING(rope->right)->size;
+        rope->ascii = NOB_GET_STRING(rope->left)->ascii &&
+          NOB_GET_STRING(rope->right)->ascii;
+        rope->depth = 1 + MAX(NOB_GET_STRING(rope->left)->depth,
+            NOB_GET_STRING(rope->right)->depth);
+
+        /* (the strings can be young ones, the ropes never are) */
+        gc_remember(&rope->left);
+        gc_remember(&rope->right);
+
+        new->ptr = rope;
+        break;
+      }
+
+      size = va_arg(vl, unsigned);
+
+      /* the characters get counted first, for it to be known how many marks
+       * there are going to be (see `struct nob_string`) */
+      for (j = 0; j < size; j++){
+        if ((bytes[j] & 0xc0) != 0x80)
+          length++;
+
+        if (bytes[j] & 0x80)
+          ascii = 0;
+      }
+
+      nmarks = NOB_STRING_NMARKS(length, ascii);
+      value = gc_new(pool, NOB_STRING_SIZE(nmarks, size), young);
+      value->length = length;
+      value->size = size;
+      value->ascii = ascii;
+      value->depth = 0;
+
+      if (size > 0)
+        memcpy(NOB_STRING_BYTES(value), bytes, size);
+
+      NOB_STRING_BYTES(value)[size] = '\0';
+
+      for (i = 0, j = 0; nmarks > 0 && j < size; j++){
+        if ((bytes[j] & 0xc0) == 0x80)
+          continue;
+
+        if (i > 0 && i % NOB_STRING_STRIDE == 0)
+          value->marks[i / NOB_STRING_STRIDE - 1] = j;
+
+        i++;
+      }
+
+      new->ptr = value;
+      /* }}} */
       break;
+    }
+
+    /* suspress warnings */
     default:
       break;
   }
 
   va_end(vl);
 
-  return push_nob(&new);
+  return new;
   /* }}} */
 }
 
@@ -293,6 +1869,10 @@ struct nob_type *new_type(enum nob_primitive_type type, ...)
       new_type->size = 0;
       break;
     }
+    case OT_LIST:
+      new_type->info.list.elem = va_arg(vl, struct nob_type *);
+      new_type->size = 0;
+      break;
     case OT_FUN:
     {
       struct nob_type *return_type = va_arg(vl, struct nob_type *);
@@ -305,11 +1885,11 @@ struct nob_type *new_type(enum nob_primitive_type type, ...)
       break;
     }
 
-    /* suspress warnings */
     case OT_STRING:
-      /* FIXME */
       new_type->size = 0;
       break;
+
+    /* suspress warnings */
     default:
       break;
   }
@@ -323,51 +1903,6 @@ struct nob_type *new_type(enum nob_primitive_type type, ...)
   /* }}} */
 }
 
-/*
- * Free every 'freeable' data associated with the given <ob>.
- *
- * It does _not_ free the <ob> itself, as it was never really
- * malloc'ed - `gc_finish` takes care of 'freeing' nobs.
- */
-void free_nob(Nob *ob)
-{
-  if (!ob) return;
-
-  assert(ob->type);
-
-  switch (ob->type->primitive){
-    case OT_INFNUM:
-      free_infnum(NOB_GET_INFNUM(ob));
-      nfree(ob->ptr);
-      break;
-    case OT_REAL:
-      nfree(ob->ptr);
-      break;
-    case OT_TUPLE: {
-      struct nobs_list *curr, *next;
-
-      for (curr = (struct nobs_list *)ob->ptr; curr != NULL; curr = next){
-        next = curr->next;
-
-        free_nob(curr->nob);
-      }
-      break;
-    }
-
-    /* fall through */
-    case OT_INT:
-    case OT_CHAR:
-      /* nothing additional to free */
-      break;
-    case OT_STRING:
-    case OT_FUN:
-    case OT_TYPE_VARIABLE:
-    case OT_CUSTOM:
-      /* suspress warnings */
-      break;
-  }
-}
-
 /*
  * See if a given object is considered to be 'true'
  */
@@ -388,12 +1923,15 @@ bool nob_is_true(Nob *ob)
     /* fall through */
     case OT_REAL:
     case OT_CHAR:
-    case OT_STRING:
     case OT_TUPLE:
     case OT_FUN:
     case OT_TYPE_VARIABLE:
     case OT_CUSTOM:
       return false;
+    case OT_LIST:
+      return NOB_GET_LIST(ob)->length != 0;
+    case OT_STRING:
+      return NOB_GET_STRING(ob)->length != 0;
   }
 
   /* should never get here */
@@ -425,6 +1963,8 @@ bool nob_types_are_equal(struct nob_type *a, struct nob_type *b)
         return false;
 
     return true;
+  } else if (a->primitive == OT_LIST){
+    return nob_types_are_equal(a->info.list.elem, b->info.list.elem);
   } else if (a->primitive == OT_FUN){
     if (!nob_types_are_equal(a->info.func.return_type, b->info.func.return_type))
       return false;
@@ -529,6 +2069,10 @@ void nob_print_type(struct nob_type *type)
       printf(")");
       break;
     }
+    case OT_LIST:
+      printf("list of ");
+      nob_print_type(type->info.list.elem);
+      break;
     case OT_FUN:
     {
       nob_print_type(type->info.func.param);
@@ -546,6 +2090,9 @@ void nob_print_type(struct nob_type *type)
     case OT_REAL:
       printf("real");
       break;
+    case OT_STRING:
+      printf("string");
+      break;
     default:
       printf("#unknown:%d#nob_print_type#", type->primitive);
       break;
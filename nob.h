@@ -13,8 +13,10 @@
 #ifndef NOB_H
 #define NOB_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include "context.h"
 #include "nemo.h"
 #include "utf8.h"
 
@@ -30,6 +32,10 @@
 #define NOB_GET_INT(ob) ((int)(uintptr_t)(ob)->ptr)
 #define NOB_GET_CHAR(ob) ((nchar_t)(uintptr_t)(ob)->ptr)
 #define NOB_GET_REAL(ob) (*(double *)(ob)->ptr)
+#define NOB_GET_TUPLE(ob) ((struct nob_tuple *)(ob)->ptr)
+#define NOB_GET_LIST(ob) ((struct nob_list *)(ob)->ptr)
+#define NOB_GET_STRING(ob) ((struct nob_string *)(ob)->ptr)
+#define NOB_GET_ROPE(ob) ((struct nob_rope *)(ob)->ptr)
 
 enum nob_primitive_type {
   /* that's kind of a draft only */
@@ -39,6 +45,7 @@ enum nob_primitive_type {
   OT_STRING,
   OT_INFNUM,
   OT_TUPLE,
+  OT_LIST,
   OT_FUN,
   OT_TYPE_VARIABLE,
   /* custom as in 'user defined' */
@@ -46,14 +53,34 @@ enum nob_primitive_type {
 };
 
 typedef struct nob {
-  /* GC mark */
-  unsigned char mark;
+  /* GC mark (the number of the major collection which found it alive, see
+   * nob.c) */
+  uint32_t mark;
   /* the object's type, d'oh */
   struct nob_type *type;
   /* pointer to the object's actual value */
   void *ptr;
 } Nob;
 
+/* forward */
+struct node;
+struct frame;
+
+/* what an OT_FUN Nob's <ptr> points to */
+struct nob_fun {
+  /* the function's node (a NT_FUN) */
+  struct node *fun;
+  /* the frame of the function the closure was created in (where the variables
+   * from outside of the function's body are looked up), NULL for functions
+   * created in the global scope */
+  struct frame *env;
+  /* the number of arguments already applied (if it's less than the function's
+   * arity, it's a partial application) */
+  unsigned argc;
+  /* the arguments already applied, in order */
+  Nob **args;
+};
+
 struct nob_type {
   enum nob_primitive_type primitive;
   /* the type's size, in bytes */
@@ -82,6 +109,11 @@ struct nob_type {
       struct types_list *elems;
     } tuple;
 
+    struct {
+      /* the type of the elements */
+      struct nob_type *elem;
+    } list;
+
     struct {
       /* the return type, d'oh */
       struct nob_type *return_type;
@@ -101,12 +133,105 @@ struct types_list {
   struct types_list *next;
 };
 
-/* a singly-linked list of <struct nob>s */
-struct nobs_list {
-  struct nob *nob;
-  struct nobs_list *next;
+/*
+ * What an OT_TUPLE Nob's <ptr> points to: the elements, one after another,
+ * followed by their kinds (one byte each, see NOB_TUPLE_KINDS). The ints, the
+ * chars and the reals are stored unboxed (their kind is their primitive
+ * type), the rest of them are the objects themselves (NOB_TUPLE_BOXED).
+ */
+struct nob_tuple {
+  unsigned length;
+  union {
+    struct nob *nob;
+    int32_t i;
+    nchar_t c;
+    double f;
+  } elems[];
 };
 
+#define NOB_TUPLE_BOXED 0xff
+#define NOB_TUPLE_KINDS(tuple) ((unsigned char *)&(tuple)->elems[(tuple)->length])
+/* how many bytes a tuple of <length> elements takes */
+#define NOB_TUPLE_SIZE(length) (offsetof(struct nob_tuple, elems) + \
+    (length) * (sizeof(((struct nob_tuple *)NULL)->elems[0]) + 1))
+
+/*
+ * What an OT_LIST Nob's <ptr> points to: a node of the list's tree (see
+ * list.c), which is a list of the elements below it itself. A leaf's <slots>
+ * are the elements, the other nodes' are their children (the OT_LIST Nobs of
+ * the height one less), followed by the children's lengths, each one summed up
+ * with those before it (see NOB_LIST_SIZES).
+ */
+struct nob_list {
+  /* how many elements there are below */
+  unsigned length;
+  /* 0 for the leaves */
+  unsigned char height;
+  /* how many of the <slots> there are (at most NOB_LIST_WIDTH) */
+  unsigned char n;
+  struct nob *slots[];
+};
+
+#define NOB_LIST_WIDTH 32
+#define NOB_LIST_SIZES(node) ((unsigned *)&(node)->slots[(node)->n])
+/* how many bytes a node of the <height> and of the <n> slots takes */
+#define NOB_LIST_SIZE(height, n) (offsetof(struct nob_list, slots) + \
+    (n) * (sizeof(struct nob *) + ((height) > 0 ? sizeof(unsigned) : 0)))
+
+/*
+ * What an OT_STRING Nob's <ptr> points to, if it's a flat one: the
+ * characters, UTF-8 encoded, and NUL-terminated (so they can be handed to the
+ * C's functions as they are). The others are ropes (see `struct nob_rope`).
+ *
+ * Unless they're all ASCII, the <i>th character is not the <i>th byte, so
+ * there's where every NOB_STRING_STRIDEth character begins (but the first,
+ * see NOB_STRING_NMARKS), to start looking for it from (see str.c).
+ */
+struct nob_string {
+  /* how many characters there are */
+  unsigned length;
+  /* how many bytes they take (without the NUL) */
+  unsigned size;
+  /* non-zero if they're all ASCII */
+  unsigned char ascii;
+  /* 0 (it's the ropes' <depth>) */
+  unsigned char depth;
+  /* the offsets of the NOB_STRING_STRIDEth character's bytes, the
+   * (2 * NOB_STRING_STRIDE)th one's, and so on, followed by the bytes */
+  unsigned marks[];
+};
+
+#define NOB_STRING_STRIDE 64
+/* how many marks a string of the <length> characters has */
+#define NOB_STRING_NMARKS(length, ascii) \
+  ((ascii) || (length) == 0 ? 0 : ((length) - 1) / NOB_STRING_STRIDE)
+#define NOB_STRING_BYTES(str) \
+  ((char *)&(str)->marks[NOB_STRING_NMARKS((str)->length, (str)->ascii)])
+/* how many bytes a string of the <nmarks> marks and the <size> bytes takes */
+#define NOB_STRING_SIZE(nmarks, size) (offsetof(struct nob_string, marks) + \
+    (nmarks) * sizeof(unsigned) + (size) + 1)
+
+/*
+ * What an OT_STRING Nob's <ptr> points to, if it's the concatenation of two
+ * strings (without the characters of either one copied, see str.c). It
+ * begins the same way the `struct nob_string` does, which is how the two of
+ * them are told apart.
+ */
+struct nob_rope {
+  unsigned length;
+  unsigned size;
+  unsigned char ascii;
+  /* how far it is to the flat strings at the bottom (at least 1) */
+  unsigned char depth;
+  /* the strings it's made of */
+  struct nob *left, *right;
+  /* the flat string it got made into the first time it had to be, NULL until
+   * then */
+  struct nob *flat;
+};
+
+#define NOB_STRING_IS_ROPE(str) ((str)->depth > 0)
+
 /*
  * a list of type variables already seen in a scope (usually in a function) to
  * reuse the associated <type> upon seeing a type variable with the same name
@@ -120,7 +245,105 @@ struct type_variables_list {
 
 void types_init(void);
 void types_finish(void);
+/* an array of objects the collector should know about (see `gc_protect`) */
+struct gc_roots {
+  Nob **slots;
+  unsigned n;
+  struct gc_roots *up;
+};
+
 void gc_finish(void);
+/*
+ * Makes the <n> <slots> a root (until `gc_unprotect`), for the objects which
+ * are kept away from the stacks across a safe point. The <roots> are the
+ * caller's.
+ */
+void gc_protect(struct gc_roots *roots, Nob **slots, unsigned n);
+void gc_unprotect(struct gc_roots *roots);
+/* the <cell> (outside of the stacks) was made to point at an object */
+void gc_remember(Nob **cell);
+/*
+ * Stores the <value> in the <cell> outside of the stacks (a global, or a slot
+ * of a frame on the heap), letting the collector know.
+ */
+void gc_write(Nob **cell, Nob *value);
+/*
+ * Returns <size> bytes for a frame moved to the heap (see `capture_frame` in
+ * ast.c), which stays there for as long as a function object (or a frame on
+ * the stack, see `gc_major_frame`) can reach it.
+ */
+struct frame *gc_new_frame(size_t size);
+/*
+ * A minor collection: `gc_minor_begin` returns whether there's anything to
+ * collect, the caller then gives every slot on its stacks to `gc_evacuate`,
+ * and `gc_minor_end` takes care of the rest.
+ */
+bool gc_minor_begin(void);
+void gc_evacuate(Nob **slot);
+void gc_minor_end(void);
+/*
+ * A major collection, which begins right after a minor one: if
+ * `gc_major_begin` returns true, the caller gives every object on its stacks
+ * (and in the globals) to `gc_major_root`, every frame on the heap its stack
+ * links to to `gc_major_frame`, and `gc_major_spawn` marks the rest
+ * of them in the background. `gc_major_step`, after every minor collection,
+ * finishes it off bit by bit.
+ */
+bool gc_major_begin(void);
+void gc_major_root(Nob *ob);
+void gc_major_frame(struct frame *frame);
+void gc_major_spawn(void);
+void gc_major_step(void);
+struct gc_pool *gc_swap_pool(struct gc_pool *pool);
+void gc_free_pool(struct gc_pool *pool);
+
+/* how many buckets the histograms of the collector's pauses have */
+#define NM_GC_HISTOGRAM 16
+
+/* the collector's pauses of one kind */
+struct nemo_gc_pauses {
+  unsigned long count;
+  /* in nanoseconds */
+  uint64_t total, longest;
+  /* the nth bucket counts the pauses shorter than 2^n microseconds (which
+   * didn't fit in the buckets before it), the last one the longer ones too */
+  unsigned long histogram[NM_GC_HISTOGRAM];
+};
+
+/* what the collector of a context has to say (see `nemo_gc_stats`) */
+struct nemo_gc_stats {
+  /* the objects there are, of every `enum nob_primitive_type` (including
+   * those which are not reachable anymore, but weren't collected yet, and
+   * every node of a list's tree, see list.c) */
+  unsigned long objects[OT_CUSTOM + 1];
+  /* the bytes they take, along with their values */
+  size_t retained;
+  /* the bytes the last major collection found alive */
+  size_t live;
+  /* the bytes taken from the system for the objects (the nursery, the slabs,
+   * and the bigger values) */
+  size_t heap;
+  /* the bytes of the objects (and their values) allocated so far, and of
+   * those of them promoted to the old generation */
+  uint64_t allocated, promoted;
+  /* a minor collection is one pause, a major one is a few of them */
+  struct nemo_gc_pauses minor, major;
+  /* the major collections done, and how long they took (from the beginning
+   * to the end of the sweep), in nanoseconds */
+  unsigned long majors;
+  uint64_t majors_time;
+  /* the process's peak resident set size, in bytes */
+  size_t peak_rss;
+};
+
+/*
+ * Fills the <stats> in with what the <ctx>'s collector did so far, and what
+ * there is in the pool the <ctx> allocates in (the objects of the prepared
+ * programs are in pools of their own, see prog.c).
+ */
+void nemo_gc_stats(struct nemo_ctx *ctx, struct nemo_gc_stats *stats);
+/* prints the <ctx>'s stats to the <fp>, as JSON if <json> */
+void nemo_gc_report(struct nemo_ctx *ctx, FILE *fp, bool json);
 
 Nob *new_nob(struct nob_type *type, ...);
 struct nob_type *new_type(enum nob_primitive_type type, ...);
@@ -135,21 +358,21 @@ bool nob_is_true(Nob *ob);
 bool is_type_variable(struct nob_type *type);
 bool is_type_operator(struct nob_type *type);
 bool nob_types_are_equal(struct nob_type *, struct nob_type *);
-void free_nob(Nob *ob);
-
-/* defined in nob.c */
-extern struct nob_type *T_VOID;
-extern struct nob_type *T_INT;
-extern struct nob_type *T_INFNUM;
-extern struct nob_type *T_CHAR;
-extern struct nob_type *T_REAL;
-extern struct nob_type *T_STRING;
-extern struct nob_type *T_LIST;
-/* lexer, for instance, could use this */
-extern struct types_list *NM_types;
-
-/* defined in nob.c */
-extern nchar_t next_type_var_name;
+
+/* the standard types, to make the life easier, and not to have to remember the
+ * pointer values (see `types_init`) */
+#define T_VOID   (NM_ctx->t_void)
+#define T_INT    (NM_ctx->t_int)
+#define T_INFNUM (NM_ctx->t_infnum)
+#define T_CHAR   (NM_ctx->t_char)
+#define T_REAL   (NM_ctx->t_real)
+#define T_STRING (NM_ctx->t_string)
+#define T_LIST   (NM_ctx->t_list)
+/* the head of a singly-linked list of <struct types_list> (lexer, for
+ * instance, could use this) */
+#define NM_types (NM_ctx->types)
+
+#define next_type_var_name (NM_ctx->next_type_var_name)
 
 #endif /* NOB_H */
 
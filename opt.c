@@ -0,0 +1,752 @@
+/*
+ *
+ * opt.c
+ *
+ * Created at:  Mon Oct 19 10:12:31 2026 10:12:31
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+/*
+ * The AST optimizer.
+ *
+ * All of the passes here work on the tree as the parser left it (after the
+ * types were inferred), so both the interpreter and the compiler take
+ * advantage of them.
+ *
+ *   -O0  nothing
+ *   -O1  constant folding, dead branch elimination, quickening (swapping the
+ *        interpreter's generic handlers for ones specialized for the
+ *        inferred types)
+ *   -O2  the above, plus common subexpression elimination and removal of
+ *        unused immutable declarations
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "ast.h"
+#include "debug.h"
+#include "infer.h"
+#include "mem.h"
+#include "nob.h"
+#include "opt.h"
+#include "scope.h"
+#include "util.h"
+
+/* {{{ tree walking helpers */
+struct walker {
+  visit_t visit;
+  void *data;
+};
+
+static void walk(struct node **slot, visit_t visit, void *data);
+
+static void walk_slot(struct node **slot, void *data)
+{
+  struct walker *w = data;
+
+  walk(slot, w->visit, w->data);
+}
+
+/*
+ * Post-order walk over the whole tree under the <slot>, <slot> included.
+ */
+static void walk(struct node **slot, visit_t visit, void *data)
+{
+  struct walker w = { visit, data };
+
+  if (*slot == NULL)
+    return;
+
+  for_each_child(*slot, walk_slot, &w);
+  visit(slot, data);
+}
+
+struct chain_visitor {
+  void (*fn)(struct node **head, void *data);
+  void *data;
+};
+
+static void for_each_chain(struct node **head, void (*fn)(struct node **, void *), void *data);
+
+static void chains_slot(struct node **slot, void *data)
+{
+  struct chain_visitor *cv = data;
+
+  if ((*slot)->type == NT_FUN){
+    if ((*slot)->in.fun.body != NULL)
+      for_each_chain(&(*slot)->in.fun.body, cv->fn, cv->data);
+  } else {
+    for_each_child(*slot, chains_slot, cv);
+  }
+}
+
+/*
+ * Calls <fn> on the execution chain starting at <head>, and then on the body
+ * of every function found in it (recursively).
+ */
+static void for_each_chain(struct node **head, void (*fn)(struct node **, void *), void *data)
+{
+  struct chain_visitor cv = { fn, data };
+  struct node **e;
+
+  fn(head, data);
+
+  for (e = head; *e != NULL; e = &(*e)->next)
+    chains_slot(e, &cv);
+}
+/* }}} */
+
+/* {{{ predicates */
+/*
+ * Does evaluating the <nd> have no side effects (printing, calling functions
+ * and such)? Division by a value which is not known at compile time is not
+ * considered pure, as it can blow up.
+ */
+static bool is_pure(struct node *nd)
+{
+  /* {{{ */
+  struct nodes_list *l;
+
+  if (nd == NULL)
+    return true;
+
+  switch (nd->type){
+    case NT_NOP:
+    case NT_INTEGER:
+    case NT_REAL:
+    case NT_STRING:
+    case NT_CHAR:
+    case NT_NAME:
+    case NT_FUN:
+      return true;
+    case NT_TUPLE:
+    case NT_LIST:
+      for (l = nd->in.tuple.elems; l != NULL; l = l->next)
+        if (!is_pure(l->node))
+          return false;
+      return true;
+    case NT_UNOP:
+      switch (nd->in.unop.type){
+        case UNARY_PLUS:
+        case UNARY_MINUS:
+        case UNARY_LOGNEG:
+        case UNARY_BITNEG:
+          return is_pure(nd->in.unop.target);
+        default:
+          return false;
+      }
+    case NT_BINOP:
+      switch (nd->in.binop.type){
+        case BINARY_DIV:
+        case BINARY_MOD:
+          if (nd->in.binop.right == NULL ||
+              nd->in.binop.right->type != NT_INTEGER ||
+              nd->in.binop.right->in.i == 0)
+            return false;
+          /* fall through */
+        case BINARY_GT:
+        case BINARY_LT:
+        case BINARY_GE:
+        case BINARY_LE:
+        case BINARY_EQ:
+        case BINARY_NE:
+        case BINARY_ADD:
+        case BINARY_SUB:
+        case BINARY_MUL:
+        case BINARY_SHL:
+        case BINARY_SHR:
+        case BINARY_BITAND:
+        case BINARY_BITXOR:
+        case BINARY_BITOR:
+        case BINARY_LOGAND:
+        case BINARY_LOGOR:
+        case BINARY_COMMA:
+          return is_pure(nd->in.binop.left) && is_pure(nd->in.binop.right);
+        default:
+          return false;
+      }
+    case NT_TERNOP:
+      return is_pure(nd->in.ternop.predicate) &&
+             is_pure(nd->in.ternop.yes) &&
+             is_pure(nd->in.ternop.no);
+
+    /* fall through */
+    case NT_IF:
+    case NT_WHILE:
+    case NT_DECL:
+    case NT_CALL:
+    case NT_BLOCK:
+    case NT_USE:
+    case NT_PRINT:
+      return false;
+  }
+
+  return false;
+  /* }}} */
+}
+
+/*
+ * Are the two (pure) expressions guaranteed to evaluate to the same value?
+ */
+static bool same_expr(struct node *a, struct node *b)
+{
+  /* {{{ */
+  struct var *va, *vb;
+
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  if (a->type != b->type)
+    return false;
+
+  switch (a->type){
+    case NT_INTEGER:
+      return a->in.i == b->in.i;
+    case NT_CHAR:
+      return a->in.c == b->in.c;
+    case NT_NAME:
+      va = var_lookup(a->in.s, a->scope);
+      vb = var_lookup(b->in.s, b->scope);
+
+      return va != NULL && va == vb && !(va->flags & NOB_FLAG_MUTABLE);
+    case NT_UNOP:
+      return a->in.unop.type == b->in.unop.type &&
+             same_expr(a->in.unop.target, b->in.unop.target);
+    case NT_BINOP:
+      return a->in.binop.type == b->in.binop.type &&
+             same_expr(a->in.binop.left, b->in.binop.left) &&
+             same_expr(a->in.binop.right, b->in.binop.right);
+    default:
+      /* reals are left out on purpose (NaN != NaN) */
+      return false;
+  }
+  /* }}} */
+}
+/* }}} */
+
+/* {{{ constant folding */
+static void fold_unop(struct node *nd)
+{
+  /* {{{ */
+  struct node *target = nd->in.unop.target;
+
+  if (target->type == NT_INTEGER){
+    switch (nd->in.unop.type){
+      case UNARY_PLUS:
+        node_to_int(nd, target->in.i);
+        break;
+      case UNARY_MINUS:
+        node_to_int(nd, (int)(0u - (uint32_t)target->in.i));
+        break;
+      case UNARY_LOGNEG:
+        node_to_int(nd, target->in.i == 0);
+        break;
+      case UNARY_BITNEG:
+        node_to_int(nd, ~target->in.i);
+        break;
+      default: /* ++ and -- need an lvalue */;
+    }
+  } else if (target->type == NT_REAL){
+    switch (nd->in.unop.type){
+      case UNARY_PLUS:
+        node_to_real(nd, target->in.f);
+        break;
+      case UNARY_MINUS:
+        node_to_real(nd, -target->in.f);
+        break;
+      default: /* meh */;
+    }
+  }
+  /* }}} */
+}
+
+static void fold_int_binop(struct node *nd, int32_t l, int32_t r)
+{
+  /* {{{ */
+  /* the arithmetic is done on unsigned values, as the wraparound is what the
+   * compiled code does as well (and signed overflow in C is undefined) */
+  uint32_t ul = (uint32_t)l, ur = (uint32_t)r;
+
+  switch (nd->in.binop.type){
+    case BINARY_ADD:    node_to_int(nd, (int32_t)(ul + ur)); break;
+    case BINARY_SUB:    node_to_int(nd, (int32_t)(ul - ur)); break;
+    case BINARY_MUL:    node_to_int(nd, (int32_t)(ul * ur)); break;
+    case BINARY_DIV:
+    case BINARY_MOD:
+      /* leave those for the runtime to blow up */
+      if (r == 0 || (l == INT32_MIN && r == -1))
+        return;
+
+      node_to_int(nd, nd->in.binop.type == BINARY_DIV ? l / r : l % r);
+      break;
+    case BINARY_SHL:    node_to_int(nd, (int32_t)(ul << (ur & 0x1f))); break;
+    case BINARY_SHR:    node_to_int(nd, (int32_t)(ul >> (ur & 0x1f))); break;
+    case BINARY_BITAND: node_to_int(nd, l & r); break;
+    case BINARY_BITXOR: node_to_int(nd, l ^ r); break;
+    case BINARY_BITOR:  node_to_int(nd, l | r); break;
+    case BINARY_GT:     node_to_int(nd, l >  r); break;
+    case BINARY_LT:     node_to_int(nd, l <  r); break;
+    case BINARY_GE:     node_to_int(nd, l >= r); break;
+    case BINARY_LE:     node_to_int(nd, l <= r); break;
+    case BINARY_EQ:     node_to_int(nd, l == r); break;
+    case BINARY_NE:     node_to_int(nd, l != r); break;
+    case BINARY_LOGAND: node_to_int(nd, l && r); break;
+    case BINARY_LOGOR:  node_to_int(nd, l || r); break;
+    case BINARY_COMMA:  node_to_int(nd, r); break;
+    default: /* assignments */;
+  }
+  /* }}} */
+}
+
+static void fold_real_binop(struct node *nd, double l, double r)
+{
+  /* {{{ */
+  switch (nd->in.binop.type){
+    case BINARY_ADD: node_to_real(nd, l + r); break;
+    case BINARY_SUB: node_to_real(nd, l - r); break;
+    case BINARY_MUL: node_to_real(nd, l * r); break;
+    case BINARY_DIV:
+      if (r != 0.0)
+        node_to_real(nd, l / r);
+      break;
+    case BINARY_GT:  node_to_int(nd, l >  r); break;
+    case BINARY_LT:  node_to_int(nd, l <  r); break;
+    case BINARY_GE:  node_to_int(nd, l >= r); break;
+    case BINARY_LE:  node_to_int(nd, l <= r); break;
+    case BINARY_EQ:  node_to_int(nd, l == r); break;
+    case BINARY_NE:  node_to_int(nd, l != r); break;
+    default: /* meh */;
+  }
+  /* }}} */
+}
+
+static void visit_fold(struct node **slot, void *data)
+{
+  /* {{{ */
+  struct node *nd = *slot;
+  struct node *left, *right;
+
+  (void)data;
+
+  if (nd->type == NT_UNOP && nd->in.unop.target != NULL){
+    fold_unop(nd);
+  } else if (nd->type == NT_BINOP){
+    left = nd->in.binop.left;
+    right = nd->in.binop.right;
+
+    if (left == NULL || right == NULL)
+      return;
+
+    if (left->type == NT_INTEGER && right->type == NT_INTEGER)
+      fold_int_binop(nd, left->in.i, right->in.i);
+    else if (left->type == NT_REAL && right->type == NT_REAL)
+      fold_real_binop(nd, left->in.f, right->in.f);
+  }
+  /* }}} */
+}
+
+static struct node *pass_fold(struct node *root)
+{
+  struct node **e;
+
+  for (e = &root; *e != NULL; e = &(*e)->next)
+    walk(e, visit_fold, NULL);
+
+  return root;
+}
+/* }}} */
+
+/* {{{ dead branch elimination */
+/*
+ * Puts the <branch> where the <nd> was, preserving the <nd>'s place in the
+ * execution chain.
+ */
+static void replace_node(struct node *nd, struct node *branch)
+{
+  struct node *next = nd->next;
+
+  *nd = *branch;
+  nd->next = next;
+}
+
+static void visit_branches(struct node **slot, void *data)
+{
+  /* {{{ */
+  struct node *nd = *slot;
+  struct node *guard;
+  bool taken;
+
+  (void)data;
+
+  if (nd->type == NT_IF){
+    guard = nd->in.iff.guard;
+
+    if (guard->type != NT_INTEGER)
+      return;
+
+    taken = (guard->in.i != 0) != nd->in.iff.unless;
+
+    if (taken)
+      replace_node(nd, nd->in.iff.body);
+    else if (nd->in.iff.elsee != NULL)
+      replace_node(nd, nd->in.iff.elsee);
+  } else if (nd->type == NT_TERNOP){
+    guard = nd->in.ternop.predicate;
+
+    if (guard->type != NT_INTEGER)
+      return;
+
+    replace_node(nd, guard->in.i ? nd->in.ternop.yes : nd->in.ternop.no);
+  }
+  /* }}} */
+}
+
+static struct node *pass_branches(struct node *root)
+{
+  struct node **e;
+
+  for (e = &root; *e != NULL; e = &(*e)->next)
+    walk(e, visit_branches, NULL);
+
+  return root;
+}
+/* }}} */
+
+/* {{{ common subexpression elimination */
+/* the maximum number of subexpressions considered in a single expression */
+#define MAX_CSE_CANDIDATES 256
+
+struct cse_state {
+  struct node **cands[MAX_CSE_CANDIDATES];
+  unsigned num;
+};
+
+/* used to generate the names for the temporary variables */
+#define cse_id (NM_ctx->cse_id)
+
+/*
+ * Collects the pure subexpressions which are always evaluated when the <nd>
+ * is (that is, not the ones in branches of a ternary operator, or the right
+ * hand side of a logical 'and', or in another function's body).
+ */
+static void cse_collect(struct node **slot, struct cse_state *state)
+{
+  /* {{{ */
+  struct node *nd = *slot;
+  struct nodes_list *l;
+
+  if (nd == NULL)
+    return;
+
+  switch (nd->type){
+    case NT_TUPLE:
+    case NT_LIST:
+      for (l = nd->in.tuple.elems; l != NULL; l = l->next)
+        cse_collect(&l->node, state);
+      break;
+    case NT_UNOP:
+      cse_collect(&nd->in.unop.target, state);
+      break;
+    case NT_BINOP:
+      switch (nd->in.binop.type){
+        case BINARY_LOGAND:
+        case BINARY_LOGOR:
+          cse_collect(&nd->in.binop.left, state);
+          break;
+        default:
+          cse_collect(&nd->in.binop.left, state);
+          cse_collect(&nd->in.binop.right, state);
+          break;
+      }
+      break;
+    case NT_TERNOP:
+      cse_collect(&nd->in.ternop.predicate, state);
+      break;
+    case NT_IF:
+      cse_collect(&nd->in.iff.guard, state);
+      break;
+    case NT_DECL:
+      cse_collect(&nd->in.decl.var->value, state);
+      break;
+    case NT_CALL:
+      for (l = nd->in.call.args; l != NULL; l = l->next)
+        cse_collect(&l->node, state);
+      break;
+    case NT_PRINT:
+      for (l = nd->in.print.exprs; l != NULL; l = l->next)
+        cse_collect(&l->node, state);
+      break;
+    default: /* nothing to look into */;
+  }
+
+  if ((nd->type == NT_BINOP || nd->type == NT_UNOP) && is_pure(nd))
+    if (state->num < MAX_CSE_CANDIDATES)
+      state->cands[state->num++] = slot;
+  /* }}} */
+}
+
+static unsigned expr_size(struct node *nd)
+{
+  if (nd == NULL)
+    return 0;
+
+  switch (nd->type){
+    case NT_UNOP:
+      return 1 + expr_size(nd->in.unop.target);
+    case NT_BINOP:
+      return 1 + expr_size(nd->in.binop.left) + expr_size(nd->in.binop.right);
+    default:
+      return 1;
+  }
+}
+
+/*
+ * Looks for the biggest subexpression of the expression at <*link> which is
+ * computed more than once, and if there is one, it's computed once into
+ * a temporary variable declared right before the expression, and every
+ * occurrence of it is replaced with the variable.
+ *
+ * Returns <true> if anything was replaced.
+ */
+static bool cse_hoist(struct node **link)
+{
+  /* {{{ */
+  struct cse_state state;
+  struct node *stmt = *link;
+  struct node *value, *decl, *name_node;
+  struct nob_type *type;
+  struct var *var;
+  unsigned i, j, best = 0, best_size = 0, size;
+  char name[32];
+
+  state.num = 0;
+  cse_collect(link, &state);
+
+  /* find the biggest expression that has a twin */
+  for (i = 0; i < state.num; i++){
+    size = expr_size(*state.cands[i]);
+
+    if (size <= best_size)
+      continue;
+
+    for (j = 0; j < state.num; j++)
+      if (j != i && same_expr(*state.cands[i], *state.cands[j])){
+        best = i;
+        best_size = size;
+        break;
+      }
+  }
+
+  if (best_size == 0)
+    return false;
+
+  value = *state.cands[best];
+
+  if ((type = infer_node_type(value->scope, value)) == NULL)
+    return false;
+
+  snprintf(name, sizeof(name), "$cse%u", cse_id++);
+
+  var = new_var(name, 0x0, value, type, stmt->scope, false, 0);
+  decl = new_decl(NULL, NULL, var);
+  decl->scope = stmt->scope;
+  decl->result_type = type;
+  var->decl = decl;
+
+  /* replace every occurrence (the first one including) with the variable */
+  for (i = 0; i < state.num; i++){
+    /* equal expressions are of the same size, so the occurrences can't be
+     * nested in each other */
+    if (!same_expr(value, *state.cands[i]))
+      continue;
+
+    name_node = new_name(NULL, NULL, name);
+    name_node->scope = (*state.cands[i])->scope;
+    name_node->result_type = type;
+    name_node->lvalue = false;
+    *state.cands[i] = name_node;
+  }
+
+  /* put the declaration right before the statement */
+  decl->next = stmt;
+  *link = decl;
+
+  return true;
+  /* }}} */
+}
+
+static void cse_chain(struct node **head, void *data)
+{
+  struct node **link;
+
+  (void)data;
+
+  for (link = head; *link != NULL; link = &(*link)->next)
+    while (cse_hoist(link))
+      ;
+}
+
+static struct node *pass_cse(struct node *root)
+{
+  for_each_chain(&root, cse_chain, NULL);
+
+  return root;
+}
+/* }}} */
+
+/* {{{ unused declarations removal */
+static void visit_count_uses(struct node **slot, void *data)
+{
+  struct var *var;
+
+  (void)data;
+
+  if ((*slot)->type == NT_NAME)
+    if ((var = var_lookup((*slot)->in.s, (*slot)->scope)) != NULL)
+      var->uses++;
+}
+
+static void decls_chain(struct node **head, void *data)
+{
+  /* {{{ */
+  bool *removed = data;
+  struct node **link = head;
+  struct var *var;
+
+  while (*link != NULL){
+    var = (*link)->type == NT_DECL ? (*link)->in.decl.var : NULL;
+
+    /* the last expression is the chain's value, so it has to stay */
+    if (var != NULL && (*link)->next != NULL &&
+        var->uses == 0 &&
+        !(var->flags & NOB_FLAG_MUTABLE) &&
+        is_pure(var->value)){
+      *link = (*link)->next;
+      *removed = true;
+    } else {
+      link = &(*link)->next;
+    }
+  }
+  /* }}} */
+}
+
+static struct node *pass_decls(struct node *root)
+{
+  /* {{{ */
+  struct scopes_list *s;
+  struct vars_list *v;
+  struct node **e;
+  bool removed;
+
+  do {
+    removed = false;
+
+    for (s = NM_scopes; s != NULL; s = s->next)
+      for (v = s->scope->vars; v != NULL; v = v->next)
+        v->var->uses = 0;
+
+    for (e = &root; *e != NULL; e = &(*e)->next)
+      walk(e, visit_count_uses, NULL);
+
+    for_each_chain(&root, decls_chain, &removed);
+  } while (removed);
+
+  return root;
+  /* }}} */
+}
+/* }}} */
+
+/* {{{ quickening */
+static void visit_quicken(struct node **slot, void *data)
+{
+  (void)data;
+
+  quicken(*slot);
+}
+
+static struct node *pass_quicken(struct node *root)
+{
+  struct node **e;
+
+  for (e = &root; *e != NULL; e = &(*e)->next)
+    walk(e, visit_quicken, NULL);
+
+  return root;
+}
+/* }}} */
+
+/* {{{ the stack depths */
+/* the functions' bodies got rewritten, so what they take has changed */
+static void visit_stack(struct node **slot, void *data)
+{
+  (void)data;
+
+  if ((*slot)->type == NT_FUN)
+    (*slot)->in.fun.max_stack = chain_stack_depth((*slot)->in.fun.body);
+}
+
+static struct node *pass_stack(struct node *root)
+{
+  struct node **e;
+
+  for (e = &root; *e != NULL; e = &(*e)->next)
+    walk(e, visit_stack, NULL);
+
+  return root;
+}
+/* }}} */
+
+/* {{{ the pass manager */
+struct pass {
+  const char *name;
+  /* the lowest optimization level at which the pass is run */
+  unsigned level;
+  struct node *(*run)(struct node *root);
+};
+
+/* the order quite matters */
+static const struct pass passes[] = {
+  { "fold",     1, pass_fold     },
+  { "branches", 1, pass_branches },
+  { "cse",      2, pass_cse      },
+  { "decls",    2, pass_decls    },
+  { "quicken",  1, pass_quicken  },
+  /* (the last one, once nothing gets rewritten anymore) */
+  { "stack",    1, pass_stack    },
+  { NULL,       0, NULL          }
+};
+
+struct node *optimize(struct node *root, unsigned level)
+{
+  const struct pass *pass;
+
+  for (pass = passes; pass->name != NULL; pass++){
+    if (root == NULL)
+      break;
+
+    if (pass->level > level)
+      continue;
+
+    root = pass->run(root);
+  }
+
+  if (level > 0){
+    dump_nodes(root);
+  }
+
+  return root;
+}
+/* }}} */
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
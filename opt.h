@@ -0,0 +1,37 @@
+/*
+ *
+ * opt.h
+ *
+ * Created at:  Mon Oct 19 10:12:31 2026 10:12:31
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+#ifndef OPT_H
+#define OPT_H
+
+#include "ast.h"
+
+/* the optimization level used when no `-O` option was given */
+#define NM_OPT_DEFAULT 1
+/* the highest optimization level there is (`-O2`) */
+#define NM_OPT_MAX 2
+
+/*
+ * Runs every optimization pass that is enabled at the given <level> over the
+ * program starting at <root>.
+ *
+ * The nodes are modified in place, but the head of the program can change (eg.
+ * if the first expression gets removed), so the new head is returned.
+ */
+struct node *optimize(struct node *root, unsigned level);
+
+#endif /* OPT_H */
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
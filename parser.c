@@ -107,6 +107,12 @@ static struct nob_type *type(struct parser *parser, struct lexer *lex)
         /* the 'custom' type is unparametrized */
         ret = typ;
       }
+    } else if (typ->primitive == OT_LIST){
+      /* the same as above, the type of the elements is optional */
+      if (accept_keyword(parser, lex, "of"))
+        ret = new_type(OT_LIST, type(parser, lex));
+      else
+        ret = new_type(OT_LIST, new_type(OT_TYPE_VARIABLE));
     } else {
       /* it's just a "basic" type (like an int) */
       ret = typ;
@@ -197,11 +203,12 @@ static struct node *function(struct parser *parser, struct lexer *lex, struct no
 {
   /* {{{ */
   struct scope *prev_scope, *functions_scope;
-  struct node *ret, *body;
+  struct node *ret, *body, *expr;
   struct nob_type *inferred_type;
 
-  struct params_info pinfo;
-  unsigned idx;
+  struct params_info pinfo = { PARAMS_INFO_BITMAP, 0x0 };
+  struct var **params = NULL;
+  unsigned arity, idx;
   char param_name[8];
 
   if (NM_DEBUG_GET_FLAG(NM_DEBUG_PARSER))
@@ -214,7 +221,35 @@ static struct node *function(struct parser *parser, struct lexer *lex, struct no
   /* all the expressions here will 'use' the new scope */
   body = expr_list(parser, lex);
 
-  pinfo = count_params(body, NULL);
+  for (expr = body; expr != NULL; expr = expr->next)
+    count_params(expr, &pinfo);
+
+  /* the function takes every param up to the highest one used, so given
+   * { %1 + %3 } it takes three (%2 being unused) */
+  for (arity = 32; arity > 0; arity--)
+    if (pinfo.value & (1U << (arity - 1)))
+      break;
+
+  /* the function is built as a single n-ary one (rather than <arity> nested
+   * unary ones), so that a call which supplies all the arguments is just one
+   * call; the params get laid out in order, %1 first */
+  if (arity > 0){
+    params = nmalloc(sizeof(struct var *) * arity);
+
+    for (idx = 0; idx < arity; idx++){
+      snprintf(param_name, 8, "%%%u", idx + 1);
+      params[idx] = var_lookup(param_name, functions_scope);
+
+      /* the unused ones (and the ones used only by the nested functions) */
+      if (params[idx] == NULL || params[idx]->scope != functions_scope)
+        params[idx] = new_var(param_name, 0, NULL, new_type(OT_TYPE_VARIABLE),
+            functions_scope, true /* a param */, 0);
+
+      /* every param is 4 bytes wide, %1 being the closest to the return
+       * address */
+      params[idx]->offset = 8 + idx * 4;
+    }
+  }
 
   /* restore the parser's former scope */
   parser->curr_scope = prev_scope;
@@ -223,18 +258,9 @@ static struct node *function(struct parser *parser, struct lexer *lex, struct no
   if (NM_DEBUG_GET_FLAG(NM_DEBUG_PARSER))
     printf("}\n");
 
-  ret = new_fun(parser, lex, NULL, "%1", body, NULL, false);
+  ret = new_fun(parser, lex, NULL, arity, params, body, NULL, false);
   ret->scope = functions_scope;
 
-  for (idx = 1; idx < 32; idx++){
-    if (pinfo.value & (1 << idx)){
-      snprintf(param_name, 8, "%%%d", idx + 1);
-
-      ret = new_fun(parser, lex, NULL, param_name, ret, NULL, false);
-      ret->scope = functions_scope;
-    }
-  }
-
   inferred_type = infer_node_type(parser->curr_scope, ret);
 
   if (prototype){
@@ -333,6 +359,39 @@ static struct node *primary_expr(struct parser *parser, struct lexer *lex)
     if (NM_DEBUG_GET_FLAG(NM_DEBUG_PARSER))
       printf(")\n");
     /* }}} */
+  } else if (accept(parser, lex, TOK_LBRACKET)){
+    /* {{{ A LIST */
+    struct nodes_list *elems = NULL;
+    struct nodes_list *elem;
+    struct node *node;
+
+    if (NM_DEBUG_GET_FLAG(NM_DEBUG_PARSER))
+      printf("[");
+
+    /* (it can be an empty one) */
+    if ((node = no_comma_expr(parser, lex)) != NULL){
+      do {
+        elem = nmalloc(sizeof(struct nodes_list));
+        elem->node = node;
+        elem->next = elems;
+        elems = elem;
+
+        if (!accept(parser, lex, TOK_COMMA))
+          break;
+
+        if (NM_DEBUG_GET_FLAG(NM_DEBUG_PARSER))
+          printf(", ");
+      } while ((node = no_comma_expr(parser, lex)) != NULL);
+    }
+
+    force(parser, lex, TOK_RBRACKET);
+
+    if (NM_DEBUG_GET_FLAG(NM_DEBUG_PARSER))
+      printf("]");
+
+    ret = new_list(parser, lex, reverse_nodes_list(elems));
+    ret->lvalue = false;
+    /* }}} */
   } else if (accept(parser, lex, TOK_LMUSTASHE)){
     /* {{{ A FUNCTION */
     /* as adversited */
@@ -358,23 +417,11 @@ static struct node *primary_expr(struct parser *parser, struct lexer *lex)
     /* }}} */
   } else if (accept(parser, lex, TOK_STRING)){
     /* {{{ STRING LITERAL */
-    struct nodes_list *chars = NULL;
-    struct nodes_list *new;
-    char *p = lex->curr_tok.value.sp;
-
     if (NM_DEBUG_GET_FLAG(NM_DEBUG_PARSER))
       printf("\"%s\" ", lex->curr_tok.value.sp);
 
-    while (*p){
-      new = nmalloc(sizeof(struct nodes_list));
-      new->node = new_char(parser, lex, u8_fetch_char(&p));
-      new->next = chars;
-      chars = new;
-    }
-
-    /* TODO create that list of chars */
-    ret = new_int(parser, lex, 789456 /* that's kind of magic, greppable */);
-    ret->result_type = T_STRING;
+    ret = new_string(parser, lex, lex->curr_tok.value.sp);
+    ret->lvalue = false;
     /* }}} */
   } else if (accept(parser, lex, TOK_CHAR)){
     /* {{{ CHARACTER LITERAL */
@@ -400,18 +447,21 @@ static struct node *primary_expr(struct parser *parser, struct lexer *lex)
     /* }}} */
   } else if (accept(parser, lex, TOK_ACCUMULATOR)){
     /* {{{ AN ACCUMULATOR */
+    struct var *var;
+
     if (NM_DEBUG_GET_FLAG(NM_DEBUG_PARSER))
       printf("%%%s ", lex->curr_tok.value.s);
 
-    /* fetch the numerical value after the % sign */
-    /*int num = atoi(lex->curr_tok.value.s + 1);*/
+    /* the params are created as they are seen, so the expressions in the
+     * function's body can refer to them straight away (their order and offsets
+     * are sorted out in `function`) */
+    var = var_lookup(lex->curr_tok.value.s, parser->curr_scope);
 
-    /* right now it's assumed that every param is sizeof 4 bytes, which is
-     * prooobably wrong */
-#if 0
-    new_var(lex->curr_tok.value.s, 0x0 /* TODO */, NULL, NULL,
-        parser->curr_scope, true /* a param */, (num - 1) * 4 /* FIXME */);
-#endif
+    if (parser->curr_scope->parent != NULL &&
+        (var == NULL || var->scope != parser->curr_scope)){
+      new_var(lex->curr_tok.value.s, 0x0, NULL, new_type(OT_TYPE_VARIABLE),
+          parser->curr_scope, true /* a param */, 0);
+    }
 
     ret = new_name(parser, lex, lex->curr_tok.value.s);
     ret->lvalue = true;
@@ -427,9 +477,57 @@ static struct node *postfix_expr(struct parser *parser, struct lexer *lex)
   /* {{{ */
   struct node *target, *ret;
   struct node *arg = NULL;
+  struct nodes_list *args = NULL, *new;
 
   target = ret = primary_expr(parser, lex);
 
+  /* the lists' elements (`xs[i]`, `xs[i][j]`), and slices (`xs[i:j]`) */
+  while (ret != NULL && accept(parser, lex, TOK_LBRACKET)){
+    struct node *from, *to;
+
+    if (NM_DEBUG_GET_FLAG(NM_DEBUG_PARSER))
+      printf(" index[");
+
+    if ((from = no_comma_expr(parser, lex)) == NULL){
+      err(parser, lex, "expected an index of the list's element");
+      return NULL;
+    }
+
+    if (accept(parser, lex, TOK_COLON)){
+      if (NM_DEBUG_GET_FLAG(NM_DEBUG_PARSER))
+        printf(":");
+
+      if ((to = no_comma_expr(parser, lex)) == NULL){
+        err(parser, lex, "expected the end of the list's slice");
+        return NULL;
+      }
+
+      /* the two bounds make a tuple (see `list_binop` in ast.c) */
+      new = nmalloc(sizeof(struct nodes_list));
+      new->node = to;
+      new->next = NULL;
+      args = nmalloc(sizeof(struct nodes_list));
+      args->node = from;
+      args->next = new;
+
+      ret = new_binop(parser, lex, BINARY_SLICE, ret,
+          new_tuple(parser, lex, args));
+      ret->lvalue = false;
+      args = NULL;
+    } else {
+      ret = new_binop(parser, lex, BINARY_INDEX, ret, from);
+      /* the element of a list in a variable can be assigned (see
+       * `exec_assign` in ast.c) */
+      ret->lvalue = ret->in.binop.left->type == NT_NAME;
+    }
+
+    force(parser, lex, TOK_RBRACKET);
+    if (NM_DEBUG_GET_FLAG(NM_DEBUG_PARSER))
+      printf("] ");
+
+    target = ret;
+  }
+
   if (peek(parser, lex, TOK_PLUS_2) ||
       peek(parser, lex, TOK_MINUS_2) ||
       peek(parser, lex, TOK_LPAREN)){
@@ -451,8 +549,17 @@ static struct node *postfix_expr(struct parser *parser, struct lexer *lex)
       if (NM_DEBUG_GET_FLAG(NM_DEBUG_PARSER))
         printf(" fcall(");
 
+      /* yup, that's not the best way to test functionness */
+      if (target == NULL ||
+          (target->type != NT_NAME && target->type != NT_FUN && target->type != NT_CALL)){
+        err(parser, lex, "trying to apply a function call on a non-function");
+        return NULL;
+      }
+
       do {
-        arg = no_comma_expr(parser, lex);
+        if ((arg = no_comma_expr(parser, lex)) == NULL)
+          /* no arguments at all, eg. `f()` */
+          break;
 
         if (NM_DEBUG_GET_FLAG(NM_DEBUG_PARSER))
           printf(", ");
@@ -460,18 +567,30 @@ static struct node *postfix_expr(struct parser *parser, struct lexer *lex)
         /* TODO: check whether the type of supplied argument matches
          * the target function's prototype */
 
-        /* yup, that's not the best way to test functionness */
-        if (target->type == NT_NAME || target->type == NT_FUN || target->type == NT_CALL){
-          ret = new_call(parser, lex, target, arg, NULL);
-          ret->lvalue = false; /* hmm.. */
-        } else {
-          err(parser, lex, "trying to apply a function call on a non-function");
-          return NULL;
-        }
-
-        target = ret;
+        new = nmalloc(sizeof(struct nodes_list));
+        new->node = arg;
+        new->next = args;
+        args = new;
       } while (accept(parser, lex, TOK_COMMA));
 
+      args = reverse_nodes_list(args);
+
+      /* uncurry `(f(a))(b)` into `f(a, b)`; a call without any arguments is
+       * left alone, as it's an application of void rather than of <a> */
+      if (target->type == NT_CALL && target->in.call.args != NULL && args != NULL){
+        struct nodes_list *last;
+
+        for (last = target->in.call.args; last->next != NULL; last = last->next)
+          ;
+
+        last->next = args;
+        args = target->in.call.args;
+        target = target->in.call.fun;
+      }
+
+      ret = new_call(parser, lex, target, args, NULL);
+      ret->lvalue = false; /* hmm.. */
+
       force(parser, lex, TOK_RPAREN);
       if (NM_DEBUG_GET_FLAG(NM_DEBUG_PARSER))
         printf(") ");
@@ -1185,6 +1304,11 @@ static struct node *expr(struct parser *parser, struct lexer *lex)
       return NULL;
     }
 
+    /* declare the variable in the current scope up front, so that a function
+     * can refer to (ie. call) itself; its type is not known just yet */
+    struct var *var = new_var(name, flags, NULL, new_type(OT_TYPE_VARIABLE),
+        parser->curr_scope, false /* not a param */, 0);
+
     /* my [type] name = expr... */
     /* the variable's initial value */
     if ((value = expr(parser, lex)) == NULL){
@@ -1202,9 +1326,8 @@ static struct node *expr(struct parser *parser, struct lexer *lex)
     if (type_annotation)
       unify(inferred_type, type_annotation);
 
-    /* declare the variable in the current scope */
-    struct var *var = new_var(name, flags, value, inferred_type, parser->curr_scope,
-        false /* not a param */, 0);
+    var->value = value;
+    var->type = inferred_type;
     ret = new_decl(parser, lex, var);
     var->decl = ret;
     ret->lvalue = false; /* hmm.. */
@@ -1299,7 +1422,7 @@ static struct node *expr(struct parser *parser, struct lexer *lex)
             return NULL;
           }
 
-          value = new_fun(parser, lex, ctor_name, "%1", NULL, NULL, false);
+          value = new_fun(parser, lex, ctor_name, 1, NULL, NULL, NULL, false);
           value->result_type = new_type(OT_FUN, custom_type, param);
         } else {
           /* hmr.. it probably doesn't matter what kind of node it actually is
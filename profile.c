@@ -0,0 +1,518 @@
+/*
+ *
+ * profile.c
+ *
+ * Created at:  Mon Oct 19 19:02:31 2026 19:02:31
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+/*
+ * The execution profiler (option `-P`).
+ *
+ * Every node of the program gets its `execf` swapped for one which counts how
+ * many times the node got executed, and how long it took: inclusive of the
+ * nodes it executed (only the outermost execution counts if it's recursive),
+ * and exclusive of them.
+ *
+ * The interpreter reports entering and leaving the functions' bodies, which
+ * builds a tree of the stacks of functions the program went through, each one
+ * with the time spent in it exclusively; the per-function numbers, and the
+ * folded stacks for the flame graphs, come from there.
+ *
+ * The nodes remember only where they end in the source (see `struct node`), so
+ * that's the line their time gets attributed to.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ast.h"
+#include "mem.h"
+#include "profile.h"
+
+/* how many of the hottest nodes get listed in the report */
+#define NM_PROFILE_HOTTEST 10
+
+struct fun_prof {
+  struct node *fun;
+  unsigned long calls;
+  /* in nanoseconds */
+  uint64_t incl, excl;
+  /* how many times the function is on the stack at the moment, and since when
+   * it's been there */
+  unsigned active;
+  uint64_t since;
+  struct fun_prof *next;
+};
+
+struct node_prof {
+  struct node *node;
+  /* the node's own execf */
+  execf_t execf;
+  unsigned long count;
+  /* in nanoseconds */
+  uint64_t incl, excl;
+  unsigned active;
+  /* set if the node is a function which got called */
+  struct fun_prof *fun;
+};
+
+/* a stack of functions the program went through, from the top-level code to
+ * <fun> */
+struct stack_prof {
+  /* NULL for the top-level code */
+  struct fun_prof *fun;
+  /* the time spent in the function with exactly this stack below it */
+  uint64_t self;
+  struct stack_prof *up;
+  struct stack_prof *children;
+  struct stack_prof *sibling;
+};
+
+/* the profile of the program being executed (see `NM_ctx`) */
+struct profile {
+  /* indexed by the nodes' ids */
+  struct node_prof *nodes;
+  unsigned nodes_size;
+  struct fun_prof *funs;
+
+  struct stack_prof root_stack;
+  struct stack_prof *curr_stack;
+
+  /* when the profiling started, and when the stack last changed */
+  uint64_t started, last_switch;
+  /* the time spent executing the children of the node being executed */
+  uint64_t in_children;
+};
+
+#define nodes       (NM_ctx->profile->nodes)
+#define nodes_size  (NM_ctx->profile->nodes_size)
+#define funs        (NM_ctx->profile->funs)
+#define root_stack  (NM_ctx->profile->root_stack)
+#define curr_stack  (NM_ctx->profile->curr_stack)
+#define started     (NM_ctx->profile->started)
+#define last_switch (NM_ctx->profile->last_switch)
+#define in_children (NM_ctx->profile->in_children)
+
+static uint64_t now(void)
+{
+  /* {{{ */
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+  /* }}} */
+}
+
+static double msecs(uint64_t nsecs)
+{
+  return nsecs / 1e6;
+}
+
+static struct node *exec_profiled(struct node *nd)
+{
+  /* {{{ */
+  struct node_prof *prof = &nodes[nd->id];
+  uint64_t outer = in_children;
+  uint64_t start, took;
+  struct node *next;
+
+  in_children = 0;
+  prof->active++;
+
+  start = now();
+  next = prof->execf(nd);
+  took = now() - start;
+
+  prof->active--;
+  prof->count++;
+  prof->excl += took - in_children;
+
+  if (prof->active == 0)
+    prof->incl += took;
+
+  in_children = outer + took;
+
+  return next;
+  /* }}} */
+}
+
+static void wrap(struct node **slot, void *data)
+{
+  /* {{{ */
+  struct node *nd = *slot;
+  unsigned old_size = nodes_size;
+
+  if (nd->id >= nodes_size){
+    while (nd->id >= nodes_size)
+      nodes_size = nodes_size ? nodes_size * 2 : 256;
+
+    nodes = nrealloc(nodes, sizeof(struct node_prof) * nodes_size);
+    memset(nodes + old_size, 0, sizeof(struct node_prof) * (nodes_size - old_size));
+  }
+
+  /* it can be reached in more than one way */
+  if (nodes[nd->id].node != NULL)
+    return;
+
+  nodes[nd->id].node = nd;
+  nodes[nd->id].execf = nd->execf;
+  nd->execf = exec_profiled;
+
+  for_each_child(nd, wrap, data);
+  /* }}} */
+}
+
+void profile_start(struct node *root)
+{
+  /* {{{ */
+  struct node *nd;
+
+  NM_ctx->profile = ncalloc(1, sizeof(struct profile));
+  curr_stack = &root_stack;
+
+  for (nd = root; nd != NULL; nd = nd->next)
+    wrap(&nd, NULL);
+
+  NM_profiling = true;
+  started = last_switch = now();
+  /* }}} */
+}
+
+/* {{{ the stacks of functions */
+static struct fun_prof *fun_prof_of(struct node *fun)
+{
+  /* {{{ */
+  struct node_prof *prof;
+
+  /* the function could be created after the profiling started (a type's
+   * constructor, for instance) */
+  if (fun->id >= nodes_size || nodes[fun->id].node == NULL)
+    wrap(&fun, NULL);
+
+  prof = &nodes[fun->id];
+
+  if (prof->fun == NULL){
+    prof->fun = ncalloc(1, sizeof(struct fun_prof));
+    prof->fun->fun = fun;
+    prof->fun->next = funs;
+    funs = prof->fun;
+  }
+
+  return prof->fun;
+  /* }}} */
+}
+
+/* attributes the time since the stack last changed to the current one */
+static uint64_t switch_stack(void)
+{
+  /* {{{ */
+  uint64_t at = now();
+
+  curr_stack->self += at - last_switch;
+  last_switch = at;
+
+  return at;
+  /* }}} */
+}
+
+void profile_enter(struct node *fun)
+{
+  /* {{{ */
+  struct fun_prof *prof = fun_prof_of(fun);
+  struct stack_prof *stack;
+  uint64_t at = switch_stack();
+
+  for (stack = curr_stack->children; stack != NULL; stack = stack->sibling)
+    if (stack->fun == prof)
+      break;
+
+  if (stack == NULL){
+    stack = ncalloc(1, sizeof(struct stack_prof));
+    stack->fun = prof;
+    stack->up = curr_stack;
+    stack->sibling = curr_stack->children;
+    curr_stack->children = stack;
+  }
+
+  curr_stack = stack;
+
+  prof->calls++;
+
+  if (prof->active++ == 0)
+    prof->since = at;
+  /* }}} */
+}
+
+void profile_leave(void)
+{
+  /* {{{ */
+  struct fun_prof *prof = curr_stack->fun;
+  uint64_t at = switch_stack();
+
+  assert(prof != NULL);
+
+  if (--prof->active == 0)
+    prof->incl += at - prof->since;
+
+  curr_stack = curr_stack->up;
+  /* }}} */
+}
+/* }}} */
+
+/* {{{ the report */
+static const char *fun_name(struct fun_prof *prof, char *buf, size_t size)
+{
+  /* {{{ */
+  struct node *fun;
+
+  if (prof == NULL)
+    return "main";
+
+  fun = prof->fun;
+
+  snprintf(buf, size, "%s@%u", fun->in.fun.name ? fun->in.fun.name :
+      fun->in.fun.execute ? "block" : "lambda", fun->line);
+
+  return buf;
+  /* }}} */
+}
+
+/* sums up the functions' exclusive times, and writes out the folded stacks */
+static void fold(struct stack_prof *stack, char *path, size_t len,
+    size_t size, FILE *folded)
+{
+  /* {{{ */
+  struct stack_prof *child;
+  char name[128];
+  int n;
+
+  n = snprintf(path + len, size - len, "%s%s", len ? ";" : "",
+      fun_name(stack->fun, name, sizeof(name)));
+
+  /* a stack too deep to be written out gets cut at its limit */
+  if (n < 0 || (size_t)n >= size - len)
+    n = size - len - 1;
+
+  if (stack->fun)
+    stack->fun->excl += stack->self;
+
+  if (folded && stack->self >= 1000)
+    fprintf(folded, "%s %llu\n", path, (unsigned long long)(stack->self / 1000));
+
+  for (child = stack->children; child != NULL; child = child->sibling)
+    fold(child, path, len + n, size, folded);
+
+  path[len] = '\0';
+  /* }}} */
+}
+
+static int by_fun_excl(const void *a, const void *b)
+{
+  const struct fun_prof *one = *(struct fun_prof **)a, *two = *(struct fun_prof **)b;
+
+  return (one->excl < two->excl) - (one->excl > two->excl);
+}
+
+static int by_node_excl(const void *a, const void *b)
+{
+  const struct node_prof *one = *(struct node_prof **)a, *two = *(struct node_prof **)b;
+
+  return (one->excl < two->excl) - (one->excl > two->excl);
+}
+
+static void report_funs(FILE *report)
+{
+  /* {{{ */
+  struct fun_prof **sorted;
+  struct fun_prof *prof;
+  unsigned nfuns = 0, i;
+  char name[128];
+
+  for (prof = funs; prof != NULL; prof = prof->next)
+    nfuns++;
+
+  sorted = ncalloc(nfuns + 1, sizeof(struct fun_prof *));
+
+  for (prof = funs, i = 0; prof != NULL; prof = prof->next)
+    sorted[i++] = prof;
+
+  qsort(sorted, nfuns, sizeof(struct fun_prof *), by_fun_excl);
+
+  fprintf(report, "\n%10s %12s %12s  %s\n", "calls", "total ms", "self ms", "function");
+  fprintf(report, "%10u %12.3f %12.3f  %s\n", 1, msecs(last_switch - started),
+      msecs(root_stack.self), "main");
+
+  for (i = 0; i < nfuns; i++)
+    fprintf(report, "%10lu %12.3f %12.3f  %s\n", sorted[i]->calls,
+        msecs(sorted[i]->incl), msecs(sorted[i]->excl),
+        fun_name(sorted[i], name, sizeof(name)));
+
+  nfree(sorted);
+  /* }}} */
+}
+
+static void report_nodes(FILE *report)
+{
+  /* {{{ */
+  struct node_prof **sorted;
+  struct node *nd;
+  unsigned nnodes = 0, i;
+
+  sorted = ncalloc(nodes_size + 1, sizeof(struct node_prof *));
+
+  for (i = 0; i < nodes_size; i++)
+    if (nodes[i].node != NULL && nodes[i].count > 0)
+      sorted[nnodes++] = &nodes[i];
+
+  qsort(sorted, nnodes, sizeof(struct node_prof *), by_node_excl);
+
+  fprintf(report, "\n%10s %12s %12s  %s\n", "count", "total ms", "self ms", "node");
+
+  for (i = 0; i < nnodes && i < NM_PROFILE_HOTTEST; i++){
+    nd = sorted[i]->node;
+
+    fprintf(report, "%10lu %12.3f %12.3f  #%u %s", sorted[i]->count,
+        msecs(sorted[i]->incl), msecs(sorted[i]->excl), nd->id,
+        nodetype_to_s(nd->type));
+
+    if (nd->type == NT_BINOP)
+      fprintf(report, " '%s'", binop_to_s(nd->in.binop.type));
+
+    fprintf(report, " at %u.%u\n", nd->line, nd->col);
+  }
+
+  nfree(sorted);
+  /* }}} */
+}
+
+static void report_source(const char *fname, FILE *report)
+{
+  /* {{{ */
+  /* per line: the most times any of its nodes got executed, and their
+   * exclusive times summed up */
+  unsigned long *counts;
+  uint64_t *times;
+  unsigned nlines = 0, line = 1, i;
+  bool at_start = true;
+  char buf[512];
+  size_t len;
+  FILE *fp;
+
+  if ((fp = fopen(fname, "r")) == NULL){
+    fprintf(report, "\nnemo: couldn't open '%s' to annotate it\n", fname);
+    return;
+  }
+
+  for (i = 0; i < nodes_size; i++)
+    if (nodes[i].node != NULL && nodes[i].node->line > nlines)
+      nlines = nodes[i].node->line;
+
+  counts = ncalloc(nlines + 1, sizeof(unsigned long));
+  times = ncalloc(nlines + 1, sizeof(uint64_t));
+
+  for (i = 0; i < nodes_size; i++){
+    if (nodes[i].node == NULL)
+      continue;
+
+    line = nodes[i].node->line;
+    times[line] += nodes[i].excl;
+
+    if (nodes[i].count > counts[line])
+      counts[line] = nodes[i].count;
+  }
+
+  fprintf(report, "\n%10s %12s  %s\n", "count", "self ms", fname);
+
+  for (line = 1; fgets(buf, sizeof(buf), fp) != NULL; ){
+    if (at_start){
+      if (line <= nlines && counts[line] > 0)
+        fprintf(report, "%10lu %12.3f  %4u| ", counts[line], msecs(times[line]), line);
+      else
+        fprintf(report, "%10s %12s  %4u| ", "", "", line);
+    }
+
+    fputs(buf, report);
+
+    len = strlen(buf);
+    at_start = len > 0 && buf[len - 1] == '\n';
+
+    if (at_start)
+      line++;
+  }
+
+  if (!at_start)
+    fputc('\n', report);
+
+  fclose(fp);
+  nfree(counts);
+  nfree(times);
+  /* }}} */
+}
+
+static void free_stacks(struct stack_prof *stack)
+{
+  /* {{{ */
+  struct stack_prof *sibling;
+
+  for (; stack != NULL; stack = sibling){
+    sibling = stack->sibling;
+    free_stacks(stack->children);
+    nfree(stack);
+  }
+  /* }}} */
+}
+
+void profile_finish(const char *fname, FILE *report, FILE *folded)
+{
+  /* {{{ */
+  struct fun_prof *prof;
+  char path[4096];
+  unsigned i;
+
+  switch_stack();
+  NM_profiling = false;
+
+  path[0] = '\0';
+  fold(&root_stack, path, 0, sizeof(path), folded);
+
+  fprintf(report, "\nnemo: profile of '%s'\n", fname);
+  report_funs(report);
+  report_nodes(report);
+  report_source(fname, report);
+
+  /* put the nodes back the way they were */
+  for (i = 0; i < nodes_size; i++)
+    if (nodes[i].node != NULL)
+      nodes[i].node->execf = nodes[i].execf;
+
+  while (funs != NULL){
+    prof = funs->next;
+    nfree(funs);
+    funs = prof;
+  }
+
+  free_stacks(root_stack.children);
+
+  nfree(nodes);
+  nfree(NM_ctx->profile);
+  NM_ctx->profile = NULL;
+  /* }}} */
+}
+/* }}} */
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
@@ -0,0 +1,47 @@
+/*
+ *
+ * profile.h
+ *
+ * Created at:  Mon Oct 19 19:02:31 2026 19:02:31
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+
+#include "ast.h"
+
+/* is the program being profiled (option `-P`)? */
+#define NM_profiling (NM_ctx->profiling)
+
+/*
+ * Makes every node of the program starting at <root> count its executions and
+ * the time they take. Has to be done after the program got optimized, right
+ * before it's executed.
+ */
+void profile_start(struct node *root);
+
+/* the interpreter entered / left the body of a function */
+void profile_enter(struct node *fun);
+void profile_leave(void);
+
+/*
+ * Writes the report (the functions, the hottest nodes, and the source of
+ * <fname> annotated line by line) into <report>, and the time spent in every
+ * distinct stack of functions, in the "folded" format the flame graph tools
+ * take, into <folded> (unless it's NULL).
+ */
+void profile_finish(const char *fname, FILE *report, FILE *folded);
+
+#endif /* PROFILE_H */
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
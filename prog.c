@@ -0,0 +1,239 @@
+/*
+ *
+ * prog.c
+ *
+ * Created at:  Mon Oct 19 22:37:05 2026 22:37:05
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+/*
+ * Prepared programs.
+ *
+ * All the parsing, the type inference and the optimizing is done once, in
+ * `nemo_prog_prepare`, so an execution is only a matter of running the nodes.
+ * The functions keep what the interpreter learns about them (the quickened
+ * operations, the tiering counters, the machine code) from one execution to
+ * the next.
+ *
+ * The inputs are global variables without a declaration, whose values are
+ * kept by the program itself (and never change while it's executed).
+ *
+ * Everything an execution allocates (the objects and the frames the closures
+ * keep) goes into the program's own pool, which is freed at the start of the
+ * next one, so the executions don't pile the garbage up in the context.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ast.h"
+#include "mem.h"
+#include "opt.h"
+#include "parser.h"
+#include "prog.h"
+#include "scope.h"
+
+struct nemo_prog {
+  struct nemo_ctx *ctx;
+  /* the program's global scope */
+  struct scope *scope;
+  struct node *root;
+  /* the most the <root>'s statements keep on the argument stack (found once
+   * they're optimized, see `chain_stack_depth`) */
+  unsigned stack;
+  /* the objects (and the heap frames) of the last execution */
+  struct gc_pool *gc;
+  unsigned ninputs;
+  struct {
+    struct var *var;
+    Nob nob;
+    /* the value of a real (the nob points at it) */
+    double real;
+    bool bound;
+  } inputs[];
+};
+
+struct nemo_prog *nemo_prog_prepare(struct nemo_ctx *ctx, const char *name,
+    char *source, const struct nemo_input *inputs, unsigned ninputs,
+    unsigned opt_level)
+{
+  /* {{{ */
+  struct nemo_ctx *prev = nemo_ctx_enter(ctx);
+  struct nemo_prog *prog;
+  struct nob_type *type;
+  unsigned i;
+
+  if (ninputs > NM_PROG_MAX_INPUTS){
+    fprintf(stderr, "nemo: program '%s' has too many inputs (%u, the most is"
+        " %u)\n", name, ninputs, NM_PROG_MAX_INPUTS);
+    nemo_ctx_enter(prev);
+    return NULL;
+  }
+
+  prog = ncalloc(1, sizeof(struct nemo_prog) + ninputs * sizeof(prog->inputs[0]));
+  prog->ctx = ctx;
+  prog->scope = new_scope((char *)name, NULL);
+  prog->ninputs = ninputs;
+
+  for (i = 0; i < ninputs; i++){
+    if (!strcmp(inputs[i].type, "int"))
+      type = T_INT;
+    else if (!strcmp(inputs[i].type, "char"))
+      type = T_CHAR;
+    else if (!strcmp(inputs[i].type, "real"))
+      type = T_REAL;
+    else {
+      fprintf(stderr, "nemo: input '%s' of program '%s' is of an unsupported"
+          " type '%s'\n", inputs[i].name, name, inputs[i].type);
+      goto fail;
+    }
+
+    if (var_lookup((char *)inputs[i].name, prog->scope) != NULL){
+      fprintf(stderr, "nemo: input '%s' of program '%s' is given twice\n",
+          inputs[i].name, name);
+      goto fail;
+    }
+
+    /* no value and no declaration, the program can only read it */
+    prog->inputs[i].var = new_var((char *)inputs[i].name, 0x0, NULL, type,
+        prog->scope, false, 0);
+    prog->inputs[i].nob.type = type;
+  }
+
+  if ((prog->root = parse_string((char *)name, source, prog->scope)) == NULL)
+    goto fail;
+
+  prog->root = optimize(prog->root, opt_level);
+  prog->stack = chain_stack_depth(prog->root);
+
+  nemo_ctx_enter(prev);
+
+  return prog;
+
+fail:
+  nfree(prog);
+  nemo_ctx_enter(prev);
+
+  return NULL;
+  /* }}} */
+}
+
+static bool bind(struct nemo_prog *prog, unsigned input, enum nob_primitive_type primitive)
+{
+  /* {{{ */
+  assert(input < prog->ninputs);
+
+  if (prog->inputs[input].nob.type->primitive != primitive)
+    return false;
+
+  prog->inputs[input].bound = true;
+  prog->inputs[input].var->nob = &prog->inputs[input].nob;
+
+  return true;
+  /* }}} */
+}
+
+bool nemo_prog_bind_int(struct nemo_prog *prog, unsigned input, int32_t value)
+{
+  if (!bind(prog, input, OT_INT))
+    return false;
+
+  prog->inputs[input].nob.ptr = (void *)(uintptr_t)value;
+
+  return true;
+}
+
+bool nemo_prog_bind_char(struct nemo_prog *prog, unsigned input, nchar_t value)
+{
+  if (!bind(prog, input, OT_CHAR))
+    return false;
+
+  prog->inputs[input].nob.ptr = (void *)(uintptr_t)value;
+
+  return true;
+}
+
+bool nemo_prog_bind_real(struct nemo_prog *prog, unsigned input, double value)
+{
+  if (!bind(prog, input, OT_REAL))
+    return false;
+
+  prog->inputs[input].real = value;
+  prog->inputs[input].nob.ptr = &prog->inputs[input].real;
+
+  return true;
+}
+
+/* gets rid of whatever the last execution left */
+static void reset(struct nemo_prog *prog)
+{
+  /* {{{ */
+  struct vars_list *v;
+
+  gc_free_pool(prog->gc);
+  prog->gc = NULL;
+
+  /* the globals it declares are declared anew */
+  for (v = prog->scope->vars; v != NULL; v = v->next)
+    if (v->var->decl != NULL)
+      v->var->nob = NULL;
+  /* }}} */
+}
+
+Nob *nemo_prog_exec(struct nemo_prog *prog)
+{
+  /* {{{ */
+  struct nemo_ctx *prev = nemo_ctx_enter(prog->ctx);
+  struct gc_pool *gc;
+  unsigned i;
+  Nob *ret;
+
+  for (i = 0; i < prog->ninputs; i++){
+    if (!prog->inputs[i].bound){
+      fprintf(stderr, "nemo: input '%s' of program '%s' is not bound\n",
+          prog->inputs[i].var->name, prog->scope->name);
+      exit(1);
+    }
+  }
+
+  reset(prog);
+
+  gc = gc_swap_pool(NULL);
+
+  ret = exec_nodes(prog->root, prog->stack);
+
+  prog->gc = gc_swap_pool(gc);
+
+  nemo_ctx_enter(prev);
+
+  return ret;
+  /* }}} */
+}
+
+void nemo_prog_free(struct nemo_prog *prog)
+{
+  /* {{{ */
+  struct nemo_ctx *prev = nemo_ctx_enter(prog->ctx);
+  unsigned i;
+
+  reset(prog);
+
+  /* the scope itself stays with the context (as do the nodes) */
+  for (i = 0; i < prog->ninputs; i++)
+    prog->inputs[i].var->nob = NULL;
+
+  nfree(prog);
+
+  nemo_ctx_enter(prev);
+  /* }}} */
+}
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
@@ -0,0 +1,74 @@
+/*
+ *
+ * prog.h
+ *
+ * Created at:  Mon Oct 19 22:37:05 2026 22:37:05
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+#ifndef PROG_H
+#define PROG_H
+
+#include <stdint.h>
+
+#include "context.h"
+#include "nob.h"
+
+/* the most inputs a program can have */
+#define NM_PROG_MAX_INPUTS 32
+
+/* an input of a prepared program, a global variable the program can use */
+struct nemo_input {
+  const char *name;
+  /* "int", "char" or "real" */
+  const char *type;
+};
+
+/*
+ * A program which got parsed, type-checked and optimized once, and can be
+ * executed any number of times (with different inputs). It belongs to the
+ * context it was prepared in.
+ */
+struct nemo_prog;
+
+/*
+ * Prepares the <source> (whose name is <name>) for the execution in the <ctx>.
+ * The program has its own global scope, which has the <ninputs> <inputs> in
+ * it, and nothing else.
+ *
+ * Returns NULL if the source couldn't be parsed, or the inputs are no good.
+ */
+struct nemo_prog *nemo_prog_prepare(struct nemo_ctx *ctx, const char *name,
+    char *source, const struct nemo_input *inputs, unsigned ninputs,
+    unsigned opt_level);
+
+/*
+ * Set the value of the <input>th input (as in the order they were given to
+ * `nemo_prog_prepare`), which it has for every execution from then on.
+ *
+ * Return false if the input is not of the type.
+ */
+bool nemo_prog_bind_int(struct nemo_prog *prog, unsigned input, int32_t value);
+bool nemo_prog_bind_char(struct nemo_prog *prog, unsigned input, nchar_t value);
+bool nemo_prog_bind_real(struct nemo_prog *prog, unsigned input, double value);
+
+/*
+ * Executes the <prog>, whose inputs all have to be bound.
+ *
+ * Returns the value of its last statement (NULL if it has none), which is
+ * there until the <prog> is executed again, or freed.
+ */
+Nob *nemo_prog_exec(struct nemo_prog *prog);
+
+void nemo_prog_free(struct nemo_prog *prog);
+
+#endif /* PROG_H */
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
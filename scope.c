@@ -19,14 +19,10 @@
 #include "scope.h"
 #include "util.h"
 
-/* a list of all the scopes ever declared */
-struct scopes_list *NM_scopes = NULL;
-
 struct scope *new_scope(char *name, struct scope *parent)
 {
   struct scope *scope = nmalloc(sizeof(struct scope));
   struct scopes_list *list = nmalloc(sizeof(struct scopes_list));
-  struct scope *p;
 
   if (name != NULL)
     scope->name = strdup(name);
@@ -36,13 +32,10 @@ struct scope *new_scope(char *name, struct scope *parent)
   scope->parent = parent;
   scope->vars   = NULL;
   scope->accs   = accs_new_list();
-  scope->curr_var_offset = -4;
   scope->curr_param_offset = 8;
-  scope->base_offset = 0;
-
-  for (p = scope; p != NULL; p = p->parent){
-    scope->base_offset += size_of_vars(p);
-  }
+  scope->frame_size = 0;
+  scope->frame_bytes = 0;
+  scope->laid_out = false;
 
   list->scope = scope;
   /* append to the `NM_scopes' list */
@@ -96,9 +89,16 @@ struct var *new_var(char *name, uint8_t flags, struct node *value,
   var->value = value;
   var->type = type;
   var->param = param;
+  var->decl = NULL;
+  var->nob = NULL;
+  var->uses = 0;
 
   assert(scope);
 
+  /* interpreter stuff */
+  var->scope = scope;
+  var->slot = scope->frame_size++;
+
   /* assembly stuff */
   if (param){
     if (offset != 0)
@@ -112,13 +112,9 @@ struct var *new_var(char *name, uint8_t flags, struct node *value,
         scope->curr_param_offset += 4;
     }
   } else {
-    if (offset != 0)
-      var->offset = offset - 4;
-    else {
-      var->offset = scope->curr_var_offset;
-
-      scope->curr_var_offset -= type->size;
-    }
+    /* the variables get their places once their types are all known (see
+     * `layout_frame`) */
+    var->offset = 0;
   }
 
   /*printf("created new variable (%d) called %s at offset %d (orig %d)\n", param, name, var->offset, offset);*/
@@ -161,27 +157,6 @@ struct nob_type *vars_type_lookup(char *name, struct scope *scope, struct ng *no
   return NULL;
 }
 
-unsigned size_of_vars(struct scope *scope)
-{
-  struct vars_list *v;
-  unsigned size = 0;
-
-  assert(scope);
-
-  for (v = scope->vars; v != NULL; v = v->next){
-    if (v->var->param)
-      continue;
-
-    /* FIXME FIXME */
-    if (v->var->type)
-      size += v->var->type->size;
-    else
-      size += 4;
-  }
-
-  return size;
-}
-
 struct accs_list *accs_new_list(void)
 {
   struct accs_list *head = NULL;
@@ -45,6 +45,10 @@ struct var {
   struct node *decl; /* reference to the declaration that did the variable */
   struct nob_type *type;
   unsigned offset; /* the var's place on the stack */
+  struct scope *scope; /* the scope the variable was declared in */
+  unsigned slot; /* the var's place in the interpreter's frame */
+  Nob *nob; /* the value of a global variable (the rest live in the frames) */
+  unsigned uses; /* number of references to the variable (see opt.c) */
 };
 
 struct vars_list {
@@ -59,12 +63,15 @@ struct scope {
   struct scope *parent;
   /* head of the variables list */
   struct vars_list *vars;
-  /* base offset the variables are from (increases along with "nestiness") */
-  unsigned base_offset;
-  /* offset the next variable will get */
-  int curr_var_offset;
   /* offset the next parameter will get (FIXME?) */
   int curr_param_offset;
+  /* number of slots the variables (params included) take in an interpreter's
+   * frame (unused when compiling) */
+  unsigned frame_size;
+  /* number of bytes the variables (params excluded) take in a compiled
+   * function's frame, once <laid_out> (see layout.c) */
+  unsigned frame_bytes;
+  bool laid_out;
   /* head of the accumulators list */
   struct accs_list *accs;
 };
@@ -84,10 +91,9 @@ struct var *new_var(char *name, uint8_t flags, struct node *value,
 struct var *var_lookup(char *name, struct scope *scope);
 struct nob_type *vars_type_lookup(char *name, struct scope *scope, struct ng *nongen);
 
-unsigned size_of_vars(struct scope *scope);
 
 /* a list of global scopes */
-extern struct scopes_list *NM_scopes;
+#define NM_scopes (NM_ctx->scopes)
 
 #endif /* SCOPE_H */
 
@@ -0,0 +1,311 @@
+/*
+ *
+ * str.c
+ *
+ * Created at:  Mon Oct 19 04:12:37 2026 04:12:37
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+/*
+ * The strings (see str.h).
+ *
+ * A string keeps its characters UTF-8 encoded, one after another (see
+ * `struct nob_string`), which takes a quarter of what a list of the
+ * characters would for the ASCII ones, and a lot less than that once the
+ * list's nodes are counted in.
+ *
+ * The price is that the <i>th character is somewhere at or after the <i>th
+ * byte, not necessarily right there. It is, if they're all ASCII (which is
+ * known, and checked first), and otherwise it's looked for starting at the
+ * nearest one of the marks before it, so it takes going over at most
+ * NOB_STRING_STRIDE of the characters (see `str_offset`).
+ *
+ * Copying both of the strings every time two of them get concatenated would
+ * make building a long one out of many pieces take time quadratic in its
+ * length, so only the short ones are (see STR_LEAF). The others make a rope
+ * (see `struct nob_rope`), which points to the two, and the ropes are kept
+ * balanced the way AVL trees are, so that they are never much deeper than the
+ * logarithm of the number of the pieces (see `str_join`). A rope gets
+ * flattened (and remembers the flat string) the first time its characters
+ * are looked at, except for printing it, which goes over its pieces one by
+ * one.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "mem.h"
+#include "nob.h"
+#include "str.h"
+#include "util.h"
+
+/* the concatenations of at most as many bytes are flat strings */
+#define STR_LEAF 128
+
+/* returns where the <i>th character (or the NUL, for the length) of the
+ * <str> begins */
+static unsigned str_offset(struct nob_string *str, unsigned i)
+{
+  /* {{{ */
+  char *bytes = NOB_STRING_BYTES(str);
+  unsigned ret = 0;
+
+  if (str->ascii)
+    return i;
+
+  if (i == str->length)
+    return str->size;
+
+  if (i >= NOB_STRING_STRIDE){
+    ret = str->marks[i / NOB_STRING_STRIDE - 1];
+    i %= NOB_STRING_STRIDE;
+  }
+
+  /* skip over the <i> characters, each one a byte which doesn't begin with
+   * 10, and the ones after it which do */
+  for (; i > 0; i--)
+    while ((bytes[++ret] & 0xc0) == 0x80)
+      ;
+
+  return ret;
+  /* }}} */
+}
+
+/* copies the <ob>'s characters (without the NUL) to the <to> */
+static void str_copy(Nob *ob, char *to)
+{
+  /* {{{ */
+  struct nob_string *str = NOB_GET_STRING(ob);
+  struct nob_rope *rope;
+
+  while (NOB_STRING_IS_ROPE(str)){
+    rope = NOB_GET_ROPE(ob);
+
+    if (rope->flat != NULL){
+      ob = rope->flat;
+      str = NOB_GET_STRING(ob);
+      break;
+    }
+
+    str_copy(rope->left, to);
+    to += NOB_GET_STRING(rope->left)->size;
+    ob = rope->right;
+    str = NOB_GET_STRING(ob);
+  }
+
+  memcpy(to, NOB_STRING_BYTES(str), str->size);
+  /* }}} */
+}
+
+/* returns the flat string of the <ob>'s characters (the <ob>, if it is one) */
+static struct nob_string *str_flat(Nob *ob)
+{
+  /* {{{ */
+  struct nob_rope *rope = NOB_GET_ROPE(ob);
+  char *bytes;
+
+  if (!NOB_STRING_IS_ROPE(rope))
+    return NOB_GET_STRING(ob);
+
+  if (rope->flat == NULL){
+    bytes = nmalloc(rope->size);
+    str_copy(ob, bytes);
+    /* (the marker could be looking at the rope, see `gc_drain`) */
+    gc_write(&rope->flat, new_nob(ob->type, bytes, rope->size));
+    nfree(bytes);
+  }
+
+  return NOB_GET_STRING(rope->flat);
+  /* }}} */
+}
+
+nchar_t str_get(Nob *ob, unsigned i)
+{
+  /* {{{ */
+  struct nob_string *str = str_flat(ob);
+  char *p;
+
+  assert(i < str->length);
+
+  if (str->ascii)
+    return NOB_STRING_BYTES(str)[i];
+
+  p = NOB_STRING_BYTES(str) + str_offset(str, i);
+
+  return u8_fetch_char(&p);
+  /* }}} */
+}
+
+/* returns a flat string of the <left>'s characters followed by the <right>'s */
+static Nob *str_append(Nob *left, Nob *right)
+{
+  /* {{{ */
+  unsigned size = NOB_GET_STRING(left)->size;
+  char *bytes = nmalloc(size + NOB_GET_STRING(right)->size);
+  Nob *ret;
+
+  /* (`new_nob` doesn't collect, so the strings stay where they are) */
+  str_copy(left, bytes);
+  str_copy(right, bytes + size);
+
+  ret = new_nob(left->type, bytes, size + NOB_GET_STRING(right)->size);
+  nfree(bytes);
+
+  return ret;
+  /* }}} */
+}
+
+#define str_depth(ob) (NOB_GET_STRING(ob)->depth)
+#define str_rope(left, right) new_nob((left)->type, NULL, (left), (right))
+
+/*
+ * Returns a rope of the <left> and the <right> (balanced, given they both
+ * are).
+ *
+ * The halves of a balanced rope differ in depth by at most one, so if the
+ * <left> and the <right> one do by more than that, the shallower one is
+ * joined with the nearer half of the deeper one instead, and the rope that
+ * makes is rotated if it's grown too deep to go next to the other half, the
+ * way it's done when joining AVL trees. It takes time proportional to the
+ * difference.
+ */
+static Nob *str_join(Nob *left, Nob *right)
+{
+  /* {{{ */
+  struct nob_rope *rope, *sub;
+  Nob *t;
+
+  if (str_depth(left) > str_depth(right) + 1){
+    rope = NOB_GET_ROPE(left);
+    t = str_join(rope->right, right);
+
+    if (str_depth(t) <= str_depth(rope->left) + 1)
+      return str_rope(rope->left, t);
+
+    /* the <t> is two deeper than the <rope->left> */
+    sub = NOB_GET_ROPE(t);
+
+    if (str_depth(sub->right) > str_depth(rope->left))
+      return str_rope(str_rope(rope->left, sub->left), sub->right);
+
+    return str_rope(
+        str_rope(rope->left, NOB_GET_ROPE(sub->left)->left),
+        str_rope(NOB_GET_ROPE(sub->left)->right, sub->right));
+  }
+
+  if (str_depth(right) > str_depth(left) + 1){
+    rope = NOB_GET_ROPE(right);
+    t = str_join(left, rope->left);
+
+    if (str_depth(t) <= str_depth(rope->right) + 1)
+      return str_rope(t, rope->right);
+
+    /* the <t> is two deeper than the <rope->right> */
+    sub = NOB_GET_ROPE(t);
+
+    if (str_depth(sub->left) > str_depth(rope->right))
+      return str_rope(sub->left, str_rope(sub->right, rope->right));
+
+    return str_rope(
+        str_rope(sub->left, NOB_GET_ROPE(sub->right)->left),
+        str_rope(NOB_GET_ROPE(sub->right)->right, rope->right));
+  }
+
+  return str_rope(left, right);
+  /* }}} */
+}
+
+Nob *str_concat(Nob *left, Nob *right)
+{
+  /* {{{ */
+  struct nob_string *l = NOB_GET_STRING(left), *r = NOB_GET_STRING(right);
+  struct nob_rope *rope;
+
+  if (l->length == 0)
+    return right;
+
+  if (r->length == 0)
+    return left;
+
+  if (l->size + r->size <= STR_LEAF)
+    return str_append(left, right);
+
+  /* appending a short piece to a rope which ends with a short one makes the
+   * two of them one (so that appending the characters one by one doesn't make
+   * a rope of as many flat strings) */
+  if (NOB_STRING_IS_ROPE(l) && !NOB_STRING_IS_ROPE(r)){
+    rope = NOB_GET_ROPE(left);
+
+    if (NOB_GET_STRING(rope->right)->size + r->size <= STR_LEAF)
+      return str_join(rope->left, str_append(rope->right, right));
+  }
+
+  return str_join(left, right);
+  /* }}} */
+}
+
+Nob *str_slice(Nob *ob, unsigned from, unsigned to)
+{
+  /* {{{ */
+  struct nob_string *str = str_flat(ob);
+  unsigned first, last;
+
+  assert(from <= to && to <= str->length);
+
+  if (from == 0 && to == str->length)
+    return ob;
+
+  first = str_offset(str, from);
+  last = str_offset(str, to);
+
+  return new_nob(ob->type, NOB_STRING_BYTES(str) + first, last - first);
+  /* }}} */
+}
+
+int str_compare(Nob *a, Nob *b)
+{
+  /* {{{ */
+  struct nob_string *x = str_flat(a), *y = str_flat(b);
+  int ret;
+
+  /* (UTF-8 sorts the same byte by byte as it does code point by code point) */
+  if ((ret = memcmp(NOB_STRING_BYTES(x), NOB_STRING_BYTES(y),
+          MIN(x->size, y->size))) != 0)
+    return ret;
+
+  return (x->size > y->size) - (x->size < y->size);
+  /* }}} */
+}
+
+void str_print(Nob *ob, FILE *fp)
+{
+  /* {{{ */
+  struct nob_string *str = NOB_GET_STRING(ob);
+  struct nob_rope *rope;
+
+  /* a rope goes out piece by piece, as they are */
+  while (NOB_STRING_IS_ROPE(str)){
+    rope = NOB_GET_ROPE(ob);
+
+    if (rope->flat != NULL){
+      str = NOB_GET_STRING(rope->flat);
+      break;
+    }
+
+    str_print(rope->left, fp);
+    ob = rope->right;
+    str = NOB_GET_STRING(ob);
+  }
+
+  fwrite(NOB_STRING_BYTES(str), 1, str->size, fp);
+  /* }}} */
+}
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
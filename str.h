@@ -0,0 +1,49 @@
+/*
+ *
+ * str.h
+ *
+ * Created at:  Mon Oct 19 04:12:37 2026 04:12:37
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+#ifndef STR_H
+#define STR_H
+
+#include <stdio.h>
+
+#include "nob.h"
+
+/*
+ * The strings never change once they're created, just like the lists (see
+ * list.h): every function below which returns one returns a new one.
+ */
+
+/* the number of characters in the <str> (an OT_STRING Nob) */
+#define str_length(str) (NOB_GET_STRING(str)->length)
+
+/* returns the <i>th character of the <str> (which has to be there) */
+nchar_t str_get(Nob *str, unsigned i);
+/* returns the <left> string followed by the <right> one (a rope of the two,
+ * unless they're short) */
+Nob *str_concat(Nob *left, Nob *right);
+/* returns the characters of the <str> from the <from>th one up to (but not
+ * including) the <to>th one (from <= to <= length) */
+Nob *str_slice(Nob *str, unsigned from, unsigned to);
+/* returns less than, equal to, or greater than zero if the <a> comes before,
+ * is the same as, or comes after the <b> (comparing the characters' code
+ * points) */
+int str_compare(Nob *a, Nob *b);
+/* writes the <str>'s characters to the <fp> (a rope's straight from the
+ * pieces it's made of) */
+void str_print(Nob *str, FILE *fp);
+
+#endif /* STR_H */
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
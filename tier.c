@@ -0,0 +1,185 @@
+/*
+ *
+ * tier.c
+ *
+ * Created at:  Mon Oct 19 21:03:44 2026 21:03:44
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+/*
+ * Tiered execution.
+ *
+ * Every function starts out in the interpreter, which counts its calls and the
+ * iterations of its loops (a loop being a call in a tail position, which
+ * `call_saturated` makes in place of the function that made it). Once either
+ * of them crosses its threshold the function gets promoted to the next tier;
+ * the counters are only kept while the function is interpreted.
+ *
+ * The promotion is a matter of swapping pointers: the function gets its
+ * `native`, which `call_saturated` goes to from then on (even in the middle of
+ * a loop), and the calls which know the function swap their `execf`s for one
+ * that calls it directly. The nodes themselves stay where they are, so
+ * `exec_nodes` runs whatever tier they're at without knowing.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "jit.h"
+#include "mem.h"
+#include "tier.h"
+
+/* the functions that got counted, for the stats */
+#define counted (NM_ctx->tier_counted)
+
+static enum tier tier_of(struct node *fun)
+{
+  return fun->in.fun.native != NULL ? TIER_NATIVE : TIER_INTERP;
+}
+
+static const char *tier_to_s(enum tier tier)
+{
+  switch (tier){
+    case TIER_INTERP: return "interpreter";
+    case TIER_NATIVE: return "native";
+    default: return "#unknown#tier_to_s#";
+  }
+}
+
+void tier_count(struct node *fun, bool back_edge)
+{
+  /* {{{ */
+  struct nodes_list *new;
+
+  assert(fun->type == NT_FUN);
+
+  if (fun->in.fun.calls == 0 && fun->in.fun.loops == 0){
+    new = nmalloc(sizeof(struct nodes_list));
+    new->node = fun;
+    new->next = counted;
+    counted = new;
+  }
+
+  if (back_edge)
+    fun->in.fun.loops++;
+  else
+    fun->in.fun.calls++;
+
+  /* it's as far as it gets */
+  if (fun->in.fun.nojit)
+    return;
+
+  if (fun->in.fun.calls >= NM_tiering.calls ||
+      fun->in.fun.loops >= NM_tiering.loops)
+    jit_compile(fun);
+  /* }}} */
+}
+
+/* parses the N in "<name>=N" */
+static bool threshold(const char *value, size_t len, unsigned long *out)
+{
+  /* {{{ */
+  char buf[32];
+  char *endptr;
+
+  if (len == 0 || len >= sizeof(buf))
+    return false;
+
+  memcpy(buf, value, len);
+  buf[len] = '\0';
+
+  errno = 0;
+  *out = strtoul(buf, &endptr, 10);
+
+  return *endptr == '\0' && errno == 0 && *out > 0 && buf[0] != '-';
+  /* }}} */
+}
+
+bool tier_configure(const char *spec)
+{
+  /* {{{ */
+  const char *end;
+  size_t len;
+
+  for (; *spec != '\0'; spec = *end ? end + 1 : end){
+    if ((end = strchr(spec, ',')) == NULL)
+      end = spec + strlen(spec);
+
+    len = end - spec;
+
+    if (len == 2 && !strncmp(spec, "on", 2))
+      NM_tiering.enabled = true;
+    else if (len == 3 && !strncmp(spec, "off", 3))
+      NM_tiering.enabled = false;
+    else if (len == 5 && !strncmp(spec, "stats", 5))
+      NM_tiering.stats = true;
+    else if (len > 6 && !strncmp(spec, "calls=", 6)){
+      if (!threshold(spec + 6, len - 6, &NM_tiering.calls))
+        return false;
+    } else if (len > 6 && !strncmp(spec, "loops=", 6)){
+      if (!threshold(spec + 6, len - 6, &NM_tiering.loops))
+        return false;
+    } else
+      return false;
+  }
+
+  return true;
+  /* }}} */
+}
+
+void tier_stats(FILE *fp)
+{
+  /* {{{ */
+  struct nodes_list *l;
+  struct node *fun, *why;
+  char name[128], nojit[64];
+
+  fprintf(fp, "\nnemo: tiering is %s (promoting after %lu calls or %lu loop"
+      " iterations)\n", NM_tiering.enabled ? "on" : "off", NM_tiering.calls,
+      NM_tiering.loops);
+  fprintf(fp, "\n%10s %10s  %-12s %s\n", "calls", "loops", "tier", "function");
+
+  for (l = counted; l != NULL; l = l->next){
+    fun = l->node;
+
+    snprintf(name, sizeof(name), "%s@%u", fun->in.fun.name ? fun->in.fun.name :
+        fun->in.fun.execute ? "block" : "lambda", fun->line);
+
+    /* whatever the JIT turned down first (see jit.c) */
+    if ((why = fun->in.fun.rejected) != NULL)
+      snprintf(nojit, sizeof(nojit), " (can't compile the %s at %u.%u)",
+          nodetype_to_s(why->type), why->line, why->col);
+    else
+      snprintf(nojit, sizeof(nojit), "%s",
+          fun->in.fun.nojit ? " (can't be compiled)" : "");
+
+    fprintf(fp, "%10lu %10lu  %-12s %s%s\n", fun->in.fun.calls,
+        fun->in.fun.loops, tier_to_s(tier_of(fun)), name, nojit);
+  }
+  /* }}} */
+}
+
+void tier_finish(void)
+{
+  /* {{{ */
+  struct nodes_list *next;
+
+  for (; counted != NULL; counted = next){
+    next = counted->next;
+    nfree(counted);
+  }
+  /* }}} */
+}
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+
@@ -0,0 +1,71 @@
+/*
+ *
+ * tier.h
+ *
+ * Created at:  Mon Oct 19 21:03:44 2026 21:03:44
+ *
+ * Author:  Szymon Urbaś <szymon.urbas@aol.com>
+ *
+ * License:  please visit the LICENSE file for details.
+ *
+ */
+
+#ifndef TIER_H
+#define TIER_H
+
+#include <stdio.h>
+
+#include "nemo.h"
+
+struct node;
+
+/* the default thresholds (see `struct tiering`) */
+#define NM_TIER_CALLS_DEFAULT 1000
+#define NM_TIER_LOOPS_DEFAULT 10000
+
+enum tier {
+  /* the AST interpreter */
+  TIER_INTERP,
+  /* the machine code (see jit.c) */
+  TIER_NATIVE
+};
+
+/* the settings of the tiering (option `-t`) */
+struct tiering {
+  /* do the functions ever leave the interpreter? */
+  bool enabled;
+  /* how many calls, or iterations of its loops (calls in tail positions back
+   * into the function), it takes for a function to get promoted */
+  unsigned long calls;
+  unsigned long loops;
+  /* print the counters at the end of the execution */
+  bool stats;
+};
+
+#define NM_tiering (NM_ctx->tiering)
+
+/*
+ * Counts a call to the <fun> (or an iteration of a loop, if <back_edge>), and
+ * promotes it if it's hot enough.
+ */
+void tier_count(struct node *fun, bool back_edge);
+
+/*
+ * Sets the tiering up according to the <spec> (a comma-separated list of
+ * "on", "off", "calls=N", "loops=N" and "stats").
+ *
+ * Returns false if it's not a valid one.
+ */
+bool tier_configure(const char *spec);
+
+/* prints every function's counters, and the tier it ended up in */
+void tier_stats(FILE *fp);
+
+void tier_finish(void);
+
+#endif /* TIER_H */
+
+/*
+ * vi: ft=c:ts=2:sw=2:expandtab
+ */
+